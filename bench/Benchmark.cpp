@@ -0,0 +1,84 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Benchmark.h"
+#include <cstdio>
+
+Benchmark::Benchmark(std::ostream& output, std::chrono::duration<double> minTime, const std::string& filter)
+	:	m_output(output),
+		m_minTime(minTime),
+		m_filter(filter)
+{
+}
+
+bool Benchmark::IsSelected(const std::string& name) const
+{
+	return m_filter.empty() || name.find(m_filter) != std::string::npos;
+}
+
+void Benchmark::Run(const std::string& name, size_t catalogSize, const Case& benchmarkCase)
+{
+	if (!IsSelected(name))
+	{
+		return;
+	}
+
+	benchmarkCase();		// warm up caches and lazily built state
+
+	size_t operations = 0;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::chrono::duration<double> elapsed{0};
+	do
+	{
+		operations += benchmarkCase();
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+	while (elapsed < m_minTime);
+
+	Report(name, catalogSize, operations, elapsed.count());
+}
+
+void Benchmark::Run(const std::string& name, size_t catalogSize, size_t operationsPerCall, const MeasuredCase& benchmarkCase)
+{
+	if (!IsSelected(name))
+	{
+		return;
+	}
+
+	benchmarkCase();
+
+	size_t operations = 0;
+	double seconds = 0.0;
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	do
+	{
+		seconds += benchmarkCase();
+		operations += operationsPerCall;
+	}
+	while (std::chrono::steady_clock::now() - start < m_minTime);
+
+	Report(name, catalogSize, operations, seconds);
+}
+
+void Benchmark::Report(const std::string& name, size_t catalogSize, size_t operations, double seconds, const std::string& extra)
+{
+	char line[512];
+	snprintf(line, sizeof(line), "{\"benchmark\":\"%s\",\"catalog_size\":%zu,\"operations\":%zu,\"seconds\":%.6f,\"ns_per_op\":%.1f,\"ops_per_second\":%.1f%s}",
+		name.c_str(), catalogSize, operations, seconds,
+		operations > 0 ? seconds * 1e9 / operations : 0.0,
+		seconds > 0.0 ? operations / seconds : 0.0,
+		extra.c_str());
+	m_output << line << std::endl;
+}
@@ -0,0 +1,47 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+
+// Times a benchmark case and reports it as one JSON object per line
+class Benchmark
+{
+	public:
+		// Called repeatedly until the minimum time has passed, returns the number of operations it performed
+		using Case = std::function<size_t()>;
+		// For cases with setup that mustn't be timed, returns the seconds of its own measured part
+		using MeasuredCase = std::function<double()>;
+
+		Benchmark(std::ostream& output, std::chrono::duration<double> minTime, const std::string& filter);
+
+		bool IsSelected(const std::string& name) const;
+		void Run(const std::string& name, size_t catalogSize, const Case& benchmarkCase);
+		void Run(const std::string& name, size_t catalogSize, size_t operationsPerCall, const MeasuredCase& benchmarkCase);
+		void Report(const std::string& name, size_t catalogSize, size_t operations, double seconds, const std::string& extra = "");	// extra is appended to the JSON object, e.g. ",\"dropped\":3"
+
+	private:
+		std::ostream& m_output;
+		std::chrono::duration<double> m_minTime;
+		std::string m_filter;
+};
+
+#endif // BENCHMARK_H
@@ -0,0 +1,73 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "SyntheticCatalog.h"
+#include <cstdio>
+#include <random>
+
+const std::vector<std::string>& GetSyntheticWords()
+{
+	static const std::vector<std::string> words =
+	{
+		"Beat", "Saber", "Super", "Hot", "Walking", "Dead", "Blade", "Sorcery", "Pistol", "Whip", "Moss", "Red", "Matter",
+		"Echo", "Arena", "Space", "Pirate", "Trainer", "Racing", "Legends", "Tower", "Defense", "Zombie", "Escape", "Room",
+		"Golf", "Tennis", "Table", "Soccer", "Climb", "Island", "Ocean", "Rift", "Dungeon", "Knight", "Wizard", "Galaxy",
+		"Robot", "Rhythm", "Fitness", "Puzzle", "Cube", "Shadow", "Light", "Storm", "Farm", "City", "Builder", "Simulator", "Tales"
+	};
+	return words;
+}
+
+std::vector<std::string> GenerateGameListRows(size_t count, unsigned int seed)
+{
+	const std::vector<std::string>& words = GetSyntheticWords();
+	std::mt19937 random(seed);
+	std::uniform_int_distribution<size_t> wordDistribution(0, words.size() - 1);
+	std::uniform_int_distribution<int> wordCountDistribution(1, 4);
+	std::uniform_int_distribution<int> versionDistribution(1, 2000);
+	std::uniform_int_distribution<int> sizeDistribution(50, 30000);
+	std::uniform_int_distribution<int> yearDistribution(2019, 2025);
+	std::uniform_int_distribution<int> monthDistribution(1, 12);
+	std::uniform_int_distribution<int> dayDistribution(1, 28);
+	std::uniform_real_distribution<float> downloadsDistribution(0.0f, 100.0f);
+	std::uniform_real_distribution<float> ratingDistribution(0.0f, 100.0f);
+	std::uniform_int_distribution<int> ratingCountDistribution(0, 50000);
+
+	std::vector<std::string> rows;
+	rows.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		std::string name;
+		std::string package = "com.";
+		const int wordCount = wordCountDistribution(random);
+		for (int w = 0; w < wordCount; ++w)
+		{
+			const std::string& word = words[wordDistribution(random)];
+			name += (w > 0 ? " " : "") + word;
+			package += word;
+		}
+		name += " " + std::to_string(i);		// the catalog keeps one title per name
+		package += "." + std::to_string(i);
+
+		const int version = versionDistribution(random);
+		char row[512];
+		snprintf(row, sizeof(row), "%s;%s v%d+1.0 -VRP;%s;%d;%04d-%02d-%02d 12:00 UTC;%d;%.3f;%.2f;%d",
+			name.c_str(), name.c_str(), version, package.c_str(), version,
+			yearDistribution(random), monthDistribution(random), dayDistribution(random),
+			sizeDistribution(random), downloadsDistribution(random), ratingDistribution(random), ratingCountDistribution(random));
+		rows.emplace_back(row);
+	}
+
+	return rows;
+}
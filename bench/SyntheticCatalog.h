@@ -0,0 +1,29 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef SYNTHETIC_CATALOG_H
+#define SYNTHETIC_CATALOG_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Rows in the format of VRP-GameList.txt, without the header line, with unique game names. The same size and seed always give the same rows
+std::vector<std::string> GenerateGameListRows(size_t count, unsigned int seed = 42);
+
+// Words the generated game names are made of, usable as search and filter terms
+const std::vector<std::string>& GetSyntheticWords();
+
+#endif // SYNTHETIC_CATALOG_H
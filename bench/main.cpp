@@ -0,0 +1,340 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Benchmarks of the libmloader hot paths on synthetic catalogs. Needs no network, tools or devices.
+// Every result is printed as one JSON object per line:
+//   mloader-bench [--sizes 1000,10000,100000] [--min-time seconds] [--filter name]
+
+#include "Benchmark.h"
+#include "SyntheticCatalog.h"
+#include <mloader/AppContext.h>
+#include "CatalogContext.h"
+#include "GameCatalog.h"
+#include "Logger.h"
+#include "SearchIndex.h"
+#include "StatusStrings.h"
+#include "VRPManager.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static constexpr size_t STATUS_UPDATES_PER_CALL = 1024;
+static constexpr size_t STATUS_STRINGS_PER_CALL = 1024;
+static constexpr size_t LOG_RECORDS = 200000;
+static constexpr int SEARCH_MAX_RESULTS = 50;
+
+static volatile size_t g_sink;		// keeps results of the measured code alive
+
+static double SecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::shared_ptr<const mloader::GameCatalog> BuildCatalog(const std::vector<std::string>& rows)
+{
+	std::vector<std::pair<mloader::GameInfo, AppStatus>> games;
+	games.reserve(rows.size());
+	for (const std::string& row : rows)
+	{
+		games.emplace_back(mloader::VRPManager::ParseGameListRow(row), AppStatus::NoInfo);
+	}
+	return std::make_shared<const mloader::GameCatalog>(std::move(games));
+}
+
+static void OnStatusBatch(AppContext*, VrpApp**, int num, void*)
+{
+	g_sink = g_sink + num;
+}
+
+static void RunCatalogBenchmarks(Benchmark& benchmark, size_t size)
+{
+	const std::vector<std::string> rows = GenerateGameListRows(size);
+	const std::shared_ptr<const mloader::GameCatalog> catalog = BuildCatalog(rows);
+
+	benchmark.Run("csv_parse", size, [&rows]()
+	{
+		size_t sizeMB = 0;
+		for (const std::string& row : rows)
+		{
+			sizeMB += mloader::VRPManager::ParseGameListRow(row).SizeMB;
+		}
+		g_sink = sizeMB;
+		return rows.size();
+	});
+
+	benchmark.Run("catalog_build", size, [&rows]()
+	{
+		g_sink = BuildCatalog(rows)->GetSize();
+		return rows.size();
+	});
+
+	// release names in random order, with one in ten missing from the catalog
+	std::vector<std::string> lookups;
+	lookups.reserve(catalog->GetSize());
+	for (size_t i = 0; i < catalog->GetSize(); ++i)
+	{
+		lookups.push_back(catalog->GetGame(i).ReleaseName + (i % 10 == 0 ? " missing" : ""));
+	}
+	std::shuffle(lookups.begin(), lookups.end(), std::mt19937(7));
+
+	benchmark.Run("catalog_find", size, [&catalog, &lookups]()
+	{
+		size_t found = 0;
+		for (const std::string& releaseName : lookups)
+		{
+			found += catalog->Find(releaseName) != nullptr;
+		}
+		g_sink = found;
+		return lookups.size();
+	});
+
+	// materializes every app of a context which hasn't handed out any yet
+	benchmark.Run("app_list", size, size, [&catalog]()
+	{
+		AppContext* context = CreateCatalogContext(catalog);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		int num = 0;
+		g_sink = GetAppList(context, &num) != NULL;
+		const double seconds = SecondsSince(start);
+		DestroyLoaderContext(context);
+		return seconds;
+	});
+
+	// status changes of materialized apps with an event subscriber and a batch handler, including draining the subscriber
+	if (benchmark.IsSelected("status_fanout"))
+	{
+		AppContext* context = CreateCatalogContext(catalog);
+		int num = 0;
+		GetAppList(context, &num);
+		MLoaderSetAppStatusBatchChangedCallback(context, OnStatusBatch, 0, NULL);
+		MLoaderEventSubscription* subscription = MLoaderSubscribeEvents(context, 0, STATUS_UPDATES_PER_CALL);
+		std::vector<MLoaderEvent> events(STATUS_UPDATES_PER_CALL);
+		size_t next = 0;
+
+		benchmark.Run("status_fanout", size, [&]()
+		{
+			for (size_t i = 0; i < STATUS_UPDATES_PER_CALL; ++i, ++next)
+			{
+				OnGameInfoStatusChanged(context, catalog->GetGame(next % catalog->GetSize()), AppStatus::Downloading, static_cast<int>(next % 101));
+			}
+			g_sink = MLoaderDrainEvents(subscription, events.data(), static_cast<int>(events.size()));
+			return STATUS_UPDATES_PER_CALL;
+		});
+
+		MLoaderClearAppStatusBatchChangedCallback(context);
+		MLoaderUnsubscribeEvents(context, subscription);
+		DestroyLoaderContext(context);
+	}
+
+	AppQuery filtered;
+	MLoaderInitAppQuery(&filtered);
+	filtered.NameContains = "saber";
+	filtered.MinRating = 20.0f;
+	filtered.SortOrder[0] = AppSortOrder{ AppSortPopularity, true };
+	filtered.SortOrder[1] = AppSortOrder{ AppSortName, false };
+	filtered.NumSortKeys = 2;
+
+	// the first query of a catalog builds the sorted permutations
+	benchmark.Run("query_first", size, 1, [&catalog, &filtered]()
+	{
+		AppContext* context = CreateCatalogContext(catalog);
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		AppQueryResult* result = MLoaderQueryApps(context, &filtered);
+		const double seconds = SecondsSince(start);
+		MLoaderFreeQueryResult(result);
+		DestroyLoaderContext(context);
+		return seconds;
+	});
+
+	if (benchmark.IsSelected("query_"))
+	{
+		AppContext* context = CreateCatalogContext(catalog);
+		std::vector<VrpApp*> page(100);
+
+		benchmark.Run("query_filtered", size, [context, &filtered, &page]()
+		{
+			AppQueryResult* result = MLoaderQueryApps(context, &filtered);
+			g_sink = MLoaderGetQueryResultPage(result, 0, static_cast<int>(page.size()), page.data());
+			MLoaderFreeQueryResult(result);
+			return size_t(1);
+		});
+
+		benchmark.Run("query_all", size, [context]()
+		{
+			AppQueryResult* result = MLoaderQueryApps(context, NULL);
+			g_sink = MLoaderGetQueryResultCount(result);
+			MLoaderFreeQueryResult(result);
+			return size_t(1);
+		});
+
+		DestroyLoaderContext(context);
+	}
+
+	benchmark.Run("search_index_build", size, [&catalog]()
+	{
+		g_sink = mloader::SearchIndex(catalog, nullptr).GetMemoryUsage();
+		return size_t(1);
+	});
+
+	if (benchmark.IsSelected("search"))
+	{
+		const mloader::SearchIndex searchIndex(catalog, nullptr);
+		const std::array<std::string, 6> queries = { "saber", "walking dead", "zombi towr", "walki", "com.pistol", "Super Hot Racing Legends" };
+
+		benchmark.Run("search", size, [&searchIndex, &queries]()
+		{
+			size_t hits = 0;
+			for (const std::string& query : queries)
+			{
+				hits += searchIndex.Search(query, SEARCH_MAX_RESULTS).size();
+			}
+			g_sink = hits;
+			return queries.size();
+		});
+	}
+}
+
+// table lookup of the library against the asprintf and free it replaced
+static void RunStatusStringBenchmarks(Benchmark& benchmark)
+{
+	benchmark.Run("status_string_table", 0, []()
+	{
+		size_t length = 0;
+		for (size_t i = 0; i < STATUS_STRINGS_PER_CALL; ++i)
+		{
+			length += mloader::GetAppStatusString(AppStatus::Downloading, static_cast<int>(i % 101))[0];
+		}
+		g_sink = length;
+		return STATUS_STRINGS_PER_CALL;
+	});
+
+	benchmark.Run("status_string_asprintf", 0, []()
+	{
+		size_t length = 0;
+		for (size_t i = 0; i < STATUS_STRINGS_PER_CALL; ++i)
+		{
+			char* status = NULL;
+			if (asprintf(&status, "%s (%d%%)", "Downloading", static_cast<int>(i % 101)) >= 0)
+			{
+				length += status[0];
+				free(status);
+			}
+		}
+		g_sink = length;
+		return STATUS_STRINGS_PER_CALL;
+	});
+}
+
+// time for the callers to hand over the records, and until all of them are written
+static void RunLoggerBenchmark(Benchmark& benchmark, const fs::path& directory)
+{
+	if (!benchmark.IsSelected("logger"))
+	{
+		return;
+	}
+
+	mloader::Logger* logger = new mloader::Logger(directory / "bench.log");
+	mloader::LogFields fields;
+	fields.Event = "download_progress";
+	fields.Job = "Synthetic Game v1+1.0 -VRP";
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < LOG_RECORDS; ++i)
+	{
+		fields.Bytes = static_cast<int64_t>(i);
+		logger->Log(mloader::LogLevel::Info, "Bench", "Downloaded a part of the archive", fields);
+	}
+	const double enqueueSeconds = SecondsSince(start);
+	const uint64_t dropped = logger->GetDroppedRecordCount();
+	delete logger;
+	const double writtenSeconds = SecondsSince(start);
+
+	const std::string extra = ",\"dropped\":" + std::to_string(dropped);
+	benchmark.Report("logger_enqueue", 0, LOG_RECORDS, enqueueSeconds, extra);
+	benchmark.Report("logger_written", 0, LOG_RECORDS - dropped, writtenSeconds, extra);
+}
+
+static std::vector<size_t> ParseSizes(const std::string& text)
+{
+	std::vector<size_t> sizes;
+	std::stringstream ss(text);
+	std::string item;
+	while (std::getline(ss, item, ','))
+	{
+		sizes.push_back(std::stoul(item));
+	}
+	return sizes;
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<size_t> sizes = { 1000, 10000, 100000 };
+	double minTime = 0.5;
+	std::string filter;
+
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			if (arg == "--sizes" && i + 1 < argc)
+			{
+				sizes = ParseSizes(argv[++i]);
+			}
+			else if (arg == "--min-time" && i + 1 < argc)
+			{
+				minTime = std::stod(argv[++i]);
+			}
+			else if (arg == "--filter" && i + 1 < argc)
+			{
+				filter = argv[++i];
+			}
+			else
+			{
+				std::cerr << "Usage: " << argv[0] << " [--sizes 1000,10000,100000] [--min-time seconds] [--filter name]" << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Invalid argument: " << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const fs::path directory = fs::temp_directory_path() / "mloader-bench";
+	fs::create_directories(directory);
+
+	Benchmark benchmark(std::cout, std::chrono::duration<double>(minTime), filter);
+	for (const size_t size : sizes)
+	{
+		RunCatalogBenchmarks(benchmark, size);
+	}
+	RunStatusStringBenchmarks(benchmark);
+	RunLoggerBenchmark(benchmark, directory);
+
+	fs::remove_all(directory);
+	return EXIT_SUCCESS;
+}
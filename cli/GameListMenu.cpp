@@ -15,7 +15,6 @@
 
 #include "GameListMenu.h"
 #include <mloader/AppContext.h>
-#include <map>
 
 GameListMenu::GameListMenu(AppContext* appContext)
 	: m_appContext(appContext)
@@ -25,9 +24,9 @@ GameListMenu::GameListMenu(AppContext* appContext)
 
 GameListMenu::~GameListMenu()
 {
-	if (m_appList != nullptr)
+	if (m_queryResult != nullptr)
 	{
-		// FreeAppList(m_appList);
+		MLoaderFreeQueryResult(m_queryResult);
 	}
 }
 
@@ -47,7 +46,7 @@ ExecuteActionResult GameListMenu::ExecuteAction(uint32_t actionIndex)
 	else
 	{
 		// Download game (this should be try catched)
-		DownloadApp(m_appContext, m_optionsIndexToApp.at(actionIndex));
+		DownloadApp(m_appContext, m_apps.at(actionIndex));
 	}
 
 	return ExecuteActionResult{ .Result = ActionResult::Success };
@@ -64,18 +63,25 @@ ExecuteActionResult GameListMenu::ExecuteCancelAction()
 
 const StringList& GameListMenu::GetOptions()
 {
-	m_options.clear();
-	m_optionsIndexToApp.clear();
-
-	if (m_appList == nullptr)
+	// called on every key press, the list is only built once
+	if (m_queryResult != nullptr)
 	{
-		m_appList = GetAppList(m_appContext, &m_numApps);
+		return m_options;
 	}
 
-	for(int i = 0; i < m_numApps; ++i)
+	AppQuery query;
+	MLoaderInitAppQuery(&query);
+	query.NumSortKeys = 1;
+	query.SortOrder[0] = { AppSortPopularity, true };
+	m_queryResult = MLoaderQueryApps(m_appContext, &query);
+
+	m_apps.resize(MLoaderGetQueryResultCount(m_queryResult));
+	MLoaderGetQueryResultPage(m_queryResult, 0, static_cast<int>(m_apps.size()), m_apps.data());
+
+	m_options.clear();
+	for (const VrpApp* app : m_apps)
 	{
-		m_options.emplace_back(m_appList[i]->GameName);
-		m_optionsIndexToApp.emplace((uint32_t)i, m_appList[i]);
+		m_options.emplace_back(app->GameName);
 	}
 
 	m_options.emplace_back("Return to main menu");
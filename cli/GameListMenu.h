@@ -16,8 +16,9 @@
 #pragma once
 
 #include "Menu.h"
-#include <unordered_map>
+#include <mloader/AppQuery.h>
 #include <mloader/VrpApp.h>
+#include <vector>
 
 class GameListMenu : public Menu
 {
@@ -34,7 +35,6 @@ class GameListMenu : public Menu
 		StringList m_options;
 		AppContext* m_appContext;
 
-		VrpApp** m_appList = nullptr;
-		int m_numApps = 0;
-		std::unordered_map<uint32_t, VrpApp*> m_optionsIndexToApp;
+		AppQueryResult* m_queryResult = nullptr;
+		std::vector<VrpApp*> m_apps;		// in option order, most popular first
 };
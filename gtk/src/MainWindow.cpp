@@ -17,6 +17,7 @@
 #include "AboutWindow.h"
 #include "GtkGeneric.h"
 #include <functional>
+#include <glib-unix.h>
 #include <map>
 #include <mloader/AppContext.h>
 #include <mloader/VrpApp.h>
@@ -63,21 +64,70 @@ static void button_install_clicked(GtkWidget* widget, gpointer data)
 	mainWindow->OnInstallButtonClicked();
 }
 
-static gboolean app_changed_callback_event(gpointer data)
+static gboolean library_events_ready(gint fd, GIOCondition condition, gpointer data)
 {
-	std::pair<MainWindow*, VrpApp*>* params = static_cast<std::pair<MainWindow*, VrpApp*>*>(data);
-	params->first->OnAppStatusChanged(params->second);
-	delete params;
+	MainWindow* mainWindow = static_cast<MainWindow*>(data);
+	mainWindow->OnLibraryEventsReady();
+	return G_SOURCE_CONTINUE;
+}
+
+struct DevicePropertyRequest
+{
+	MainWindow* Window;
+	std::string Serial;
+	GtkLabel* Label;
+	std::string Value;
+};
+
+static gboolean device_property_loaded_event(gpointer data)
+{
+	DevicePropertyRequest* request = static_cast<DevicePropertyRequest*>(data);
+	request->Window->OnDevicePropertyLoaded(request->Serial, request->Label, request->Value);
+	delete request;
 	return false;
 }
 
-static gboolean device_list_changed_callback_event(gpointer data)
+// Runs on a library thread, the handle is already released by the caller so the value is copied out here
+static void device_property_completed(MLoaderOperation* operation, void* data)
 {
-	MainWindow* mainWindow = static_cast<MainWindow*>(data);
-	mainWindow->OnAdbDeviceListChanged();
+	DevicePropertyRequest* request = static_cast<DevicePropertyRequest*>(data);
+	const char* value = MLoaderGetOperationResult(operation);
+	request->Value = value != NULL ? value : "";
+	g_idle_add(device_property_loaded_event, request);
+}
+
+struct AppThumbRequest
+{
+	MainWindow* Window;
+	VrpApp* App;
+	GdkPixbuf* Pixbuf;
+};
+
+static gboolean app_thumb_loaded_event(gpointer data)
+{
+	AppThumbRequest* request = static_cast<AppThumbRequest*>(data);
+	request->Window->OnAppThumbLoaded(request->App, request->Pixbuf);
+	delete request;
 	return false;
 }
 
+// Runs on a library thread, the image is decoded here as well to keep file access off the main thread
+static void app_thumb_completed(MLoaderOperation* operation, void* data)
+{
+	AppThumbRequest* request = static_cast<AppThumbRequest*>(data);
+	const char* imagePath = MLoaderGetOperationResult(operation);
+	if (imagePath != NULL)
+	{
+		GError* err = NULL;
+		request->Pixbuf = gdk_pixbuf_new_from_file_at_scale(imagePath, 262, 150, true, &err);
+		if (err != NULL)
+		{
+			g_error_free(err);
+		}
+	}
+	g_idle_add(app_thumb_loaded_event, request);
+}
+
 MainWindow::MainWindow(AppContext* appContext)
 	: 	m_appContext(appContext),
 		m_adbDeviceList(nullptr),
@@ -90,6 +140,18 @@ MainWindow::~MainWindow()
 {
 	m_adbDeviceList = nullptr;
 
+	if (m_eventSourceId != 0)
+	{
+		g_source_remove(m_eventSourceId);
+		m_eventSourceId = 0;
+	}
+
+	if (m_eventSubscription)
+	{
+		MLoaderUnsubscribeEvents(m_appContext, m_eventSubscription);
+		m_eventSubscription = nullptr;
+	}
+
 	if (m_window)
 	{
 		gtk_widget_destroy(m_window);
@@ -118,41 +180,43 @@ MainWindow::~MainWindow()
 
 void MainWindow::OnAppFilterChanged()
 {
-	gtk_tree_model_filter_refilter(m_appTreeModelFilter);
-}
-
-gboolean MainWindow::OnFilterFunction(GtkTreeModel *model, GtkTreeIter *iter)
-{
+	// the search runs once per keystroke against the library's index, the filter function only looks up the result
 	const gchar *searchText = gtk_entry_get_text(GTK_ENTRY(m_entryFilter));
-	const size_t searchLen = strlen(searchText);
-	if (searchLen == 0)
-	{
-		return true;
-	}
-
-	gchar* value;	// value is application name
-	gtk_tree_model_get(model, iter, 0, &value, -1);
+	m_searchActive = searchText[0] != '\0';
+	m_searchMatches.assign(m_numApps, false);
 
-	if (value == NULL)
+	if (m_searchActive)
 	{
-		return true;
-	}
+		AppQueryResult* result = MLoaderSearchApps(m_appContext, searchText, 0);
+		std::vector<VrpApp*> hits(MLoaderGetQueryResultCount(result));
+		MLoaderGetQueryResultPage(result, 0, static_cast<int>(hits.size()), hits.data());
+		MLoaderFreeQueryResult(result);
 
-	// First try doing a simple search, if that doesn't work try strcasestr
-	if (strncasecmp(searchText, value, searchLen) == 0)
-	{
-		g_free(value);
-		return true;
+		for (VrpApp* app : hits)
+		{
+			auto it = m_appRows.find(app);
+			if (it != m_appRows.end())
+			{
+				m_searchMatches[it->second] = true;
+			}
+		}
 	}
 
-	if (strcasestr(value, searchText) != NULL)
+	gtk_tree_model_filter_refilter(m_appTreeModelFilter);
+}
+
+gboolean MainWindow::OnFilterFunction(GtkTreeModel *model, GtkTreeIter *iter)
+{
+	if (!m_searchActive)
 	{
-		g_free(value);
 		return true;
 	}
 
-	g_free(value);
-	return false;
+	GtkTreePath* path = gtk_tree_model_get_path(model, iter);
+	const int row = gtk_tree_path_get_indices(path)[0];
+	gtk_tree_path_free(path);
+
+	return row < static_cast<int>(m_searchMatches.size()) && m_searchMatches[row];
 }
 
 void MainWindow::InitializeLayout()
@@ -208,17 +272,69 @@ void MainWindow::InitializeLayout()
 
 void MainWindow::SetupCallbackEvents()
 {
-	// Important: App status changed can be called from a background thread. It's important to use g_idle_add to do any UI updates from the main thread
-	SetAppStatusChangedCallback(m_appContext, [](AppContext* context, VrpApp* app, void* usrdata){
-		std::pair<MainWindow*, VrpApp*>* params = new std::pair<MainWindow*, VrpApp*>(static_cast<MainWindow*>(usrdata), app);
-		g_idle_add(app_changed_callback_event, params);
-	}, this);
+	// App status and ADB device changes are produced on background threads. They are queued by the library and picked up
+	// on the main loop when the subscription's descriptor turns readable, a whole batch at a time
+	m_eventSubscription = MLoaderSubscribeEvents(m_appContext, MLOADER_EVENT_MASK(MLoaderEventAppStatusChanged) | MLOADER_EVENT_MASK(MLoaderEventAdbDeviceListChanged) | MLOADER_EVENT_MASK(MLoaderEventAppListChanged), EVENT_QUEUE_CAPACITY);
+	if (m_eventSubscription)
+	{
+		m_eventSourceId = g_unix_fd_add(MLoaderGetEventFd(m_eventSubscription), G_IO_IN, library_events_ready, this);
+	}
+}
+
+void MainWindow::OnLibraryEventsReady()
+{
+	std::vector<VrpApp*> changedApps;
+	std::unordered_set<const VrpApp*> seenApps;
+	bool deviceListChanged = false;
+	bool appListChanged = false;
+
+	int count;
+	do
+	{
+		count = MLoaderDrainEvents(m_eventSubscription, m_eventBuffer.data(), static_cast<int>(m_eventBuffer.size()));
+		for (int i = 0; i < count; ++i)
+		{
+			const MLoaderEvent& event = m_eventBuffer[i];
+			if (event.Type == MLoaderEventAdbDeviceListChanged)
+			{
+				deviceListChanged = true;
+			}
+			else if (event.Type == MLoaderEventAppListChanged)
+			{
+				appListChanged = true;
+			}
+			else if (event.Type == MLoaderEventAppStatusChanged && seenApps.insert(event.App).second)
+			{
+				changedApps.push_back(event.App);
+			}
+		}
+	} while (count == static_cast<int>(m_eventBuffer.size()));
 
-	// Important: ADB device changes can be called from a background thread. It's important to use g_idle_add to do any UI updates from the main thread
-	SetADBDeviceListChangedCallback(m_appContext, [](AppContext* context, void* usrData)
+	// events were lost to a full queue, every status and the device list are read again instead
+	const unsigned long long droppedEvents = MLoaderGetDroppedEventCount(m_eventSubscription);
+	if (droppedEvents != m_droppedEventCount)
 	{
-		g_idle_add(device_list_changed_callback_event, usrData);
-	}, this);
+		m_droppedEventCount = droppedEvents;
+		deviceListChanged = true;
+		changedApps.assign(m_appList, m_appList + m_numApps);
+	}
+
+	if (appListChanged)
+	{
+		// the new list shows the current statuses, the filter the user typed is kept
+		const std::string filter = gtk_entry_get_text(m_entryFilter);
+		RefreshAppList();
+		gtk_entry_set_text(m_entryFilter, filter.c_str());
+	}
+	else if (!changedApps.empty())
+	{
+		OnAppStatusBatchChanged(changedApps);
+	}
+
+	if (deviceListChanged)
+	{
+		OnAdbDeviceListChanged();
+	}
 }
 
 void MainWindow::SetupMenuBarEvents()
@@ -266,6 +382,7 @@ void MainWindow::RefreshAppList()
 	m_selectedApp = nullptr;
 
 	m_appList = GetAppList(m_appContext, &m_numApps);
+	m_appRows.clear();
 	GtkTreeIter iter;
 
 	for(int i = 0; i < m_numApps; ++i)
@@ -282,6 +399,7 @@ void MainWindow::RefreshAppList()
 			6, m_appList[i]->SizeMB,
 			7, m_appList[i]->Downloads,
 		-1);
+		m_appRows[m_appList[i]] = i;
 	}
 }
 
@@ -344,7 +462,7 @@ void MainWindow::OnAdbDeviceSelectionChanged()
 	{
 		m_selectedAdbDevice = m_adbDeviceList[index];
 	}
-	MLoaderSetSelectedAdbDevice(m_appContext, m_selectedAdbDevice);
+	MLoaderReleaseOperation(MLoaderSetSelectedAdbDeviceAsync(m_appContext, m_selectedAdbDevice, NULL, NULL));
 	RefreshInstallDownloadButtons();
 	RefreshDeviceDetailsPane();
 }
@@ -393,25 +511,26 @@ void MainWindow::RefreshAppDetailsPane()
 	gtk_label_set_text(m_appNoteLabel, m_selectedApp->Note);
 	gtk_widget_set_visible(GTK_WIDGET(m_imageNotePlaceholder), strlen(m_selectedApp->Note) == 0);
 
-	char* imagePath = GetAppThumbImage(m_appContext, m_selectedApp);
+	AppThumbRequest* request = new AppThumbRequest{ this, m_selectedApp, nullptr };
+	MLoaderReleaseOperation(MLoaderGetAppThumbImageAsync(m_appContext, m_selectedApp, app_thumb_completed, request));
+}
 
-	if (imagePath != NULL)
+void MainWindow::OnAppThumbLoaded(VrpApp* app, GdkPixbuf* pixbuf)
+{
+	if (pixbuf == NULL)
 	{
-		ClearPixBuffer();
-		GError* err = NULL;
-		m_imageThumbBuffer = gdk_pixbuf_new_from_file_at_scale(imagePath, 262, 150, true, &err);
-		if (m_imageThumbBuffer == NULL)
-		{
-			// Log this
-			free(err);
-		}
-		else
-		{
-			gtk_image_set_from_pixbuf(m_imageThumbPreview, m_imageThumbBuffer);
-		}
+		return;
+	}
 
-		free(imagePath);
+	if (app != m_selectedApp)	// the selection moved on while the image was loading
+	{
+		g_object_unref(pixbuf);
+		return;
 	}
+
+	ClearPixBuffer();
+	m_imageThumbBuffer = pixbuf;
+	gtk_image_set_from_pixbuf(m_imageThumbPreview, m_imageThumbBuffer);
 }
 
 void MainWindow::RefreshDeviceDetailsPane()
@@ -428,19 +547,21 @@ void MainWindow::RefreshDeviceDetailsPane()
 
 	for (DeviceDetails& detail : m_detailsObjects)
 	{
-		char* value = MLoaderGetDeviceProperty(m_appContext, m_selectedAdbDevice, detail.PropertyName);
-		if (strlen(value) > 0)
-		{
-			gtk_label_set_text(detail.UILabel, value);
-		}
-		else
-		{
-			gtk_label_set_text(detail.UILabel, "N/A");
-		}
-		free(value);
+		DevicePropertyRequest* request = new DevicePropertyRequest{ this, m_selectedAdbDevice->DeviceId, detail.UILabel, "" };
+		MLoaderReleaseOperation(MLoaderGetDevicePropertyAsync(m_appContext, m_selectedAdbDevice, detail.PropertyName, device_property_completed, request));
 	}
 }
 
+void MainWindow::OnDevicePropertyLoaded(const std::string& serial, GtkLabel* label, const std::string& value)
+{
+	if (m_selectedAdbDevice == nullptr || serial != m_selectedAdbDevice->DeviceId)
+	{
+		return;
+	}
+
+	gtk_label_set_text(label, value.empty() ? "N/A" : value.c_str());
+}
+
 void MainWindow::RefreshInstallDownloadButtons()
 {
 	// this function enables/disables download and install buttons depending on conditions
@@ -452,7 +573,8 @@ void MainWindow::RefreshInstallDownloadButtons()
 	}
 
 	gtk_widget_set_sensitive(GTK_WIDGET(m_downloadBtn), m_selectedApp->Status == AppStatus::NoInfo);
-	gtk_widget_set_sensitive(GTK_WIDGET(m_installBtn), m_selectedApp->Status == AppStatus::Downloaded && m_selectedAdbDevice != nullptr && m_selectedAdbDevice->DeviceStatus == AdbDeviceStatus::OK);
+	const bool installable = m_selectedApp->Status == AppStatus::Downloaded || m_selectedApp->Status == AppStatus::UpdateAvailable;
+	gtk_widget_set_sensitive(GTK_WIDGET(m_installBtn), installable && m_selectedAdbDevice != nullptr && m_selectedAdbDevice->DeviceStatus == AdbDeviceStatus::OK);
 }
 
 void MainWindow::OnDownloadButtonClicked()
@@ -466,38 +588,23 @@ void MainWindow::OnDownloadButtonClicked()
 void MainWindow::OnInstallButtonClicked()
 {
 	if (!m_selectedApp) { return; } // This shouldn't occur, but just in case
-	MLoaderInstallApp(m_appContext, m_selectedApp, m_selectedAdbDevice);
+	// updates of titles which aren't downloaded are streamed from the archive
+	MLoaderInstallAppToDevices(m_appContext, m_selectedApp, &m_selectedAdbDevice, 1);
 }
 
-void MainWindow::OnAppStatusChanged(VrpApp* app)
+void MainWindow::OnAppStatusBatchChanged(const std::vector<VrpApp*>& apps)
 {
-	GtkTreeIter iter;
-	gboolean iterValid;
-	gboolean found = false;
-	iterValid = gtk_tree_model_get_iter_first(GTK_TREE_MODEL(m_mainAppTreeListStore), &iter);
-
-	while(iterValid)
+	for (VrpApp* app : apps)
 	{
-		gchar* valueReleaseName;
-
-		gtk_tree_model_get(GTK_TREE_MODEL(m_mainAppTreeListStore), &iter, 2, &valueReleaseName, -1);
-
-		if (g_strcmp0(valueReleaseName, app->ReleaseName) == 0)
+		auto it = m_appRows.find(app);
+		GtkTreeIter iter;
+		if (it == m_appRows.end() || !gtk_tree_model_iter_nth_child(GTK_TREE_MODEL(m_mainAppTreeListStore), &iter, NULL, it->second))
 		{
-			free(valueReleaseName);
-			found = true;
-			break;
+			continue;
 		}
-		free(valueReleaseName);
-		iterValid = gtk_tree_model_iter_next(GTK_TREE_MODEL(m_mainAppTreeListStore), &iter);
-	}
 
-	if (found)
-	{
+		// gtk_list_store_set emits row-changed itself
 		gtk_list_store_set(m_mainAppTreeListStore, &iter, 1, app->StatusCStr, -1);
-		GtkTreePath *path = gtk_tree_model_get_path(GTK_TREE_MODEL(m_mainAppTreeListStore), &iter);
-		gtk_tree_model_row_changed(GTK_TREE_MODEL(m_mainAppTreeListStore), path, &iter);
-		gtk_tree_path_free(path);
 	}
 
 	RefreshInstallDownloadButtons();
@@ -510,9 +617,9 @@ void MainWindow::OnMenuBarClearDownloadsClicked()
 	{
 		for (int i = 0; i < m_numApps; ++i)
 		{
-			if (m_appList[i]->Status == AppStatus::Downloaded)
+			if (m_appList[i]->Status == AppStatus::Downloaded || m_appList[i]->Status == AppStatus::UpdateAvailable)
 			{
-				MLoaderDeleteApp(m_appContext, m_appList[i]);
+				MLoaderReleaseOperation(MLoaderDeleteAppAsync(m_appContext, m_appList[i], NULL, NULL));
 			}
 		}
 	}
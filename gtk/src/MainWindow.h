@@ -18,8 +18,12 @@
 #include "model/DeviceDetails.h"
 #include <mloader/VrpApp.h>
 #include <mloader/AdbDevice.h>
+#include <mloader/Event.h>
 #include <gtk/gtk.h>
+#include <array>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 struct AppContext;
@@ -38,8 +42,11 @@ class MainWindow
 		void OnAppSelectionChanged();
 		void OnDownloadButtonClicked();
 		void OnInstallButtonClicked();
-		void OnAppStatusChanged(VrpApp* app);
+		void OnLibraryEventsReady();
+		void OnAppStatusBatchChanged(const std::vector<VrpApp*>& apps);
 		void OnMenuBarClearDownloadsClicked();
+		void OnDevicePropertyLoaded(const std::string& serial, GtkLabel* label, const std::string& value);
+		void OnAppThumbLoaded(VrpApp* app, GdkPixbuf* pixbuf);
 
 	private:
 		void InitializeLayout();
@@ -54,9 +61,21 @@ class MainWindow
 		void ClearPixBuffer();
 
 	private:
+		static constexpr size_t EVENT_BATCH_SIZE = 256;
+		static constexpr int EVENT_QUEUE_CAPACITY = 32768;		// room for a status change of every title, selecting a device changes most of them at once
+
 		AppContext* m_appContext;
 		VrpApp** m_appList = nullptr;
 		int m_numApps = 0;
+		std::unordered_map<const VrpApp*, int> m_appRows;	// list store row of each app
+		std::vector<bool> m_searchMatches;					// by list store row
+		bool m_searchActive = false;
+
+		MLoaderEventSubscription* m_eventSubscription = nullptr;
+		guint m_eventSourceId = 0;
+		unsigned long long m_droppedEventCount = 0;
+		std::array<MLoaderEvent, EVENT_BATCH_SIZE> m_eventBuffer;
+
 		VrpApp* m_selectedApp = nullptr;
 		AdbDevice** m_adbDeviceList = nullptr;
 		AdbDevice* m_selectedAdbDevice = nullptr;
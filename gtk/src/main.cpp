@@ -31,8 +31,9 @@ SAContext* standaloneContext = nullptr;
 
 // Callback function to be called when mloader reports a new status
 gboolean OnMLoaderAppContextCreateStatusCallbackMainThread(gpointer data) {
-	const char* status = (const char*)data;
+	char* status = (char*)data;
 	splashWindow->UpdateStatusLabelText(status);
+	g_free(status);
 
 	return false;	// Return FALSE to remove this function from the idle list
 }
@@ -80,7 +81,8 @@ gboolean OnMLoaderSAContextCreateStatusCompletedMainThread(gpointer data) {
 
 void MloaderAppContextCreateStatusCallback(const char* status)
 {
-	g_idle_add(OnMLoaderAppContextCreateStatusCallbackMainThread, (gpointer)status);
+	// status is only valid during the callback
+	g_idle_add(OnMLoaderAppContextCreateStatusCallbackMainThread, g_strdup(status));
 }
 
 void MloaderAppContextCreateCompletedCallback(AppContext* context)
@@ -111,7 +113,11 @@ int main(int argc, char* argv[])
 	}
 	else
 	{
-		CreateLoaderContextAsync(MloaderAppContextCreateCompletedCallback, MloaderAppContextCreateStatusCallback, "", "");
+		// The catalog of the previous run is shown right away, the main window reloads the list once new metadata is in
+		LoaderContextOptions options;
+		MLoaderInitContextOptions(&options);
+		options.WarmStart = true;
+		MLoaderCreateLoaderContextWithOptionsAsync(MloaderAppContextCreateCompletedCallback, MloaderAppContextCreateStatusCallback, &options);
 	}
 
 	gtk_main();
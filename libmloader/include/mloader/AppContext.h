@@ -18,6 +18,15 @@
 
 #include "VrpApp.h"
 #include "AdbDevice.h"
+#include "AppInstallProgress.h"
+#include "TraceSummary.h"
+#include "CacheUsage.h"
+#include "AppQuery.h"
+#include "Operation.h"
+#include "Event.h"
+#include "ContextOptions.h"
+#include "Log.h"
+#include "Stats.h"
 #include <stddef.h>
 
 typedef struct AppContext AppContext;
@@ -28,31 +37,89 @@ typedef void (* RefreshMetadataAsyncCompletedCallback)(AppContext*);
 typedef void (* RefreshMetadataAsyncFailedCallback)(AppContext*);
 typedef void (* ADBDeviceListChangedCallback)(AppContext*, void*);
 typedef void (* AppStatusChangedCallback)(AppContext*, VrpApp*, void*);
+typedef void (* AppStatusBatchChangedCallback)(AppContext*, VrpApp** apps, int num, void*);
+typedef void (* AppDeviceStatusChangedCallback)(AppContext*, VrpApp*, const char* deviceId, AppStatus status, void*);
 
 #ifdef __cplusplus
 extern "C"
 {
 #endif
-	AppContext* CreateLoaderContext(CreateLoaderContextStatusCallback callback, const char* customCacheDir, const char* customDownloadDir);
+	AppContext* CreateLoaderContext(CreateLoaderContextStatusCallback callback, const char* customCacheDir, const char* customDownloadDir);	// startup phases run concurrently, status messages come from several threads (one at a time) and are only valid during the callback
 	void CreateLoaderContextAsync(CreateLoaderContextAsyncCompletedCallback completedCallback, CreateLoaderContextStatusCallback callback, const char* customCacheDir, const char* customDownloadDir);
+	void MLoaderInitContextOptions(LoaderContextOptions* options);																	// default directories, cold start
+	AppContext* MLoaderCreateLoaderContextWithOptions(const LoaderContextOptions* options, CreateLoaderContextStatusCallback callback);	// with WarmStart the app list changes once new metadata is in, see MLoaderEventAppListChanged
+	void MLoaderCreateLoaderContextWithOptionsAsync(CreateLoaderContextAsyncCompletedCallback completedCallback, CreateLoaderContextStatusCallback callback, const LoaderContextOptions* options);	// options are copied
 	void DestroyLoaderContext(AppContext* context);
 
 	bool RefreshMetadata(AppContext* context);
 	void RefreshMetadataAsync(RefreshMetadataAsyncCompletedCallback completedCallback, RefreshMetadataAsyncFailedCallback failedCallback, AppContext* context);
 	VrpApp** GetAppList(AppContext* context, int* num);
+	void MLoaderInitAppQuery(AppQuery* query);		// no filters, catalog order
+	AppQueryResult* MLoaderQueryApps(AppContext* context, const AppQuery* query);	// NULL query matches everything. Statuses are matched as of the call, free the result with MLoaderFreeQueryResult
+	int MLoaderGetQueryResultCount(AppQueryResult* result);
+	int MLoaderGetQueryResultPage(AppQueryResult* result, int offset, int limit, VrpApp** apps);	// fills apps with up to limit entries starting at offset and returns how many were written. Only these apps are created, GetAppList creates all of them
+	AppQueryResult* MLoaderSearchApps(AppContext* context, const char* text, int maxResults);	// ranked fuzzy search over names, package names and notes, best hits first. maxResults <= 0 returns every hit
+	void MLoaderFreeQueryResult(AppQueryResult* result);
 	int DownloadApp(AppContext* context, VrpApp* app);
 	int MLoaderInstallApp(AppContext* context, VrpApp* app, AdbDevice* device);
+	int MLoaderDownloadAndInstallApp(AppContext* context, VrpApp* app, AdbDevice* device);	// installs straight from the downloaded archive, without extracting it to the download directory
+	int MLoaderInstallAppToDevices(AppContext* context, VrpApp* app, AdbDevice** devices, int num);	// installs to every device concurrently, titles which aren't downloaded yet are streamed from the archive
+	AppStatus MLoaderGetAppDeviceStatus(AppContext* context, VrpApp* app, AdbDevice* device);	// install status of the app on a single device, Status of VrpApp summarizes all devices
+	bool MLoaderGetAppDeviceProgress(AppContext* context, VrpApp* app, AdbDevice* device, AppInstallProgress* progress);
 	void MLoaderDeleteApp(AppContext* context, VrpApp* app);
 	AdbDevice** GetDeviceList(AppContext* context, int* num);
-	char* MLoaderGetDeviceProperty(AppContext* context, AdbDevice* device, const char* propertyName);
+	char* MLoaderGetDeviceProperty(AppContext* context, AdbDevice* device, const char* propertyName);	// served from a property snapshot taken once per device connection
+	void MLoaderRefreshDeviceProperties(AppContext* context, AdbDevice* device);	// discards the snapshot and reads the properties again
 	void MLoaderSetSelectedAdbDevice(AppContext* context, AdbDevice* device);
 	void SetADBDeviceListChangedCallback(AppContext* context, ADBDeviceListChangedCallback callback, void* userData);
 	void ClearADBDeviceListChangedCallback(AppContext* context);
 	void SetAppStatusChangedCallback(AppContext* context, AppStatusChangedCallback callback, void* userData);
 	void ClearAppStatusChangedCallback(AppContext* context);
+	void MLoaderSetAppStatusBatchChangedCallback(AppContext* context, AppStatusBatchChangedCallback callback, int intervalMs, void* userData);	// changes are merged per app and delivered at most once per interval, intervalMs <= 0 uses the default of 100ms. apps is only valid during the callback
+	void MLoaderClearAppStatusBatchChangedCallback(AppContext* context);
+	void MLoaderSetAppDeviceStatusChangedCallback(AppContext* context, AppDeviceStatusChangedCallback callback, void* userData);
+	void MLoaderClearAppDeviceStatusChangedCallback(AppContext* context);
 
 	char* GetAppThumbImage(AppContext* context, VrpApp* app);
 
+	bool MLoaderGetCacheUsage(AppContext* context, CacheUsage* usage);		// usage as of the last cache scan
+	void MLoaderSetCacheQuota(AppContext* context, unsigned long long quotaBytes);	// limits downloads and tool archives, 0 disables eviction
+	void MLoaderCollectCacheGarbage(AppContext* context);		// rescans the cache and evicts on the background thread
+
+	void MLoaderSetCpuBudget(AppContext* context, int threads);					// threads shared by all extractions, 0 uses every core
+	void MLoaderSetExtractionThreads(AppContext* context, int threadsPerJob);	// 0 lets a single extraction use everything that's free
+	void MLoaderSetExtractionLowPriority(AppContext* context, bool lowPriority);
+
+	int MLoaderGetTraceSummary(AppContext* context, TraceStageSummary* summaries, int capacity);	// fills up to capacity stages and returns how many were written, pass NULL to get the stage count
+	bool MLoaderExportTrace(AppContext* context, const char* file);		// writes every recorded span as Chrome trace event JSON
+
+	void MLoaderSetLogLevel(AppContext* context, MLoaderLogLevel level);	// records below level are discarded, the default is MLoaderLogInfo
+	void MLoaderSetLogFormat(AppContext* context, MLoaderLogFormat format);	// the default is MLoaderLogFormatJson
+	void MLoaderSetLogSampling(AppContext* context, const char* event, int keepOneIn);	// keeps one in keepOneIn records of event (e.g. "install_progress"), <= 1 keeps every record
+	void MLoaderSetLogRotation(AppContext* context, unsigned long long maxBytes, int maxFiles);	// rotates to mloader.log.1 .. .maxFiles once the log exceeds maxBytes, 0 never rotates. The default is 10 MB and 3 files
+	bool MLoaderGetStats(AppContext* context, MLoaderStats* stats);		// snapshot of queue depths, running jobs, byte totals, throughput and catalog size
+	void MLoaderSetStatsDumpInterval(AppContext* context, int seconds);	// periodically writes the stats to mloader-stats.prom in the cache dir in OpenMetrics format, 0 stops
+
+	// Asynchronous variants of calls which wait on adb or the file system. They run on a library thread pool, completion is reported
+	// through the callback (may be NULL) or by polling the handle. Every returned handle has to be released with MLoaderReleaseOperation
+	MLoaderOperation* MLoaderGetDevicePropertyAsync(AppContext* context, AdbDevice* device, const char* propertyName, MLoaderOperationCompletedCallback callback, void* userData);	// result is the property value
+	MLoaderOperation* MLoaderSetSelectedAdbDeviceAsync(AppContext* context, AdbDevice* device, MLoaderOperationCompletedCallback callback, void* userData);
+	MLoaderOperation* MLoaderDeleteAppAsync(AppContext* context, VrpApp* app, MLoaderOperationCompletedCallback callback, void* userData);
+	MLoaderOperation* MLoaderGetAppThumbImageAsync(AppContext* context, VrpApp* app, MLoaderOperationCompletedCallback callback, void* userData);	// result is the image path, fails when there is no thumbnail
+	bool MLoaderIsOperationDone(MLoaderOperation* operation);
+	bool MLoaderWaitOperation(MLoaderOperation* operation, int timeoutMs);		// returns whether the operation is done, timeoutMs < 0 waits until it is
+	bool MLoaderOperationSucceeded(MLoaderOperation* operation);
+	const char* MLoaderGetOperationResult(MLoaderOperation* operation);		// NULL until the operation succeeded, owned by the handle
+	void MLoaderReleaseOperation(MLoaderOperation* operation);
+
+	// Events are queued per subscriber and can be consumed from any thread. The descriptor turns readable while events are waiting,
+	// drain until fewer than maxEvents are returned to rearm it. Events are dropped, and counted, when a subscriber falls capacity events behind
+	MLoaderEventSubscription* MLoaderSubscribeEvents(AppContext* context, unsigned int eventMask, int capacity);	// eventMask combines MLOADER_EVENT_MASK values, 0 subscribes to everything. capacity <= 0 uses 1024
+	int MLoaderGetEventFd(MLoaderEventSubscription* subscription);
+	int MLoaderDrainEvents(MLoaderEventSubscription* subscription, MLoaderEvent* events, int maxEvents);	// never blocks, returns the number of events written
+	unsigned long long MLoaderGetDroppedEventCount(MLoaderEventSubscription* subscription);
+	void MLoaderUnsubscribeEvents(AppContext* context, MLoaderEventSubscription* subscription);
+
 	const char* MLoaderGetErrorMessage();
 	char* MLoaderGetLibraryVersion();
 #ifdef __cplusplus
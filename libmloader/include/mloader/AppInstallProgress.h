@@ -0,0 +1,30 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef APP_INSTALL_PROGRESS_H
+#define APP_INSTALL_PROGRESS_H
+
+#include "VrpApp.h"
+
+typedef struct
+{
+	AppStatus Status;						// install status of the app on this device
+	int Progress;							// percent of the install job, -1 when not installing
+	unsigned long long BytesWritten;		// apk and obb bytes written so far, skipped obb files included
+	unsigned long long BytesTotal;
+	double MegabytesPerSecond;				// transfer rate to the device, sampled every second
+} AppInstallProgress;
+
+#endif // APP_INSTALL_PROGRESS_H
@@ -0,0 +1,52 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef APP_QUERY_H
+#define APP_QUERY_H
+
+#include <stdbool.h>
+
+#define APP_QUERY_MAX_SORT_KEYS 4
+
+typedef enum
+{
+	AppSortPopularity = 0,
+	AppSortSize,
+	AppSortLastUpdated,
+	AppSortName
+} AppSortKey;
+
+typedef struct
+{
+	AppSortKey Key;
+	bool Descending;
+} AppSortOrder;
+
+typedef struct
+{
+	const char* NameContains;					// case-insensitive substring of the game name, NULL or "" matches every name
+	unsigned int StatusMask;					// (1 << AppStatus) for every accepted status, 0 accepts every status
+	int MinSizeMB;
+	int MaxSizeMB;								// 0 for no upper bound
+	const char* UpdatedFrom;					// inclusive date prefix such as "2024-05" or "2024-05-01", NULL for no bound
+	const char* UpdatedUntil;
+	float MinRating;
+	AppSortOrder SortOrder[APP_QUERY_MAX_SORT_KEYS];	// later keys break ties of earlier ones
+	int NumSortKeys;							// 0 keeps the catalog order, by name
+} AppQuery;
+
+typedef struct AppQueryResult AppQueryResult;
+
+#endif // APP_QUERY_H
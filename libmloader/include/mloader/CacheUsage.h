@@ -0,0 +1,32 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CACHE_USAGE_H
+#define CACHE_USAGE_H
+
+typedef struct
+{
+	unsigned long long ToolArchivesBytes;		// downloaded tool archives (platform-tools, 7-Zip, rclone)
+	unsigned long long ToolsBytes;				// extracted tools
+	unsigned long long MetadataArchiveBytes;	// meta.7z
+	unsigned long long MetadataBytes;			// extracted metadata tree, thumbnails and notes
+	unsigned long long DownloadsBytes;			// game archives of running, failed or direct install downloads
+	unsigned long long LogsBytes;
+	unsigned long long OtherBytes;
+	unsigned long long TotalBytes;
+	unsigned long long QuotaBytes;				// limit for downloads and tool archives, 0 when not limited
+} CacheUsage;
+
+#endif // CACHE_USAGE_H
@@ -0,0 +1,28 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CONTEXT_OPTIONS_H
+#define CONTEXT_OPTIONS_H
+
+#include <stdbool.h>
+
+typedef struct
+{
+	const char* CacheDir;			// NULL or "" for the default
+	const char* DownloadDir;		// NULL or "" for the default
+	bool WarmStart;					// serve the metadata of the previous run right away and revalidate it in the background
+} LoaderContextOptions;
+
+#endif // CONTEXT_OPTIONS_H
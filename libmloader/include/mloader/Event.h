@@ -0,0 +1,42 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "VrpApp.h"
+
+typedef enum
+{
+	MLoaderEventAppStatusChanged = 0,
+	MLoaderEventAppDeviceStatusChanged,
+	MLoaderEventAdbDeviceListChanged,
+	MLoaderEventAppListChanged		// new metadata was applied, apps may have been added or removed
+} MLoaderEventType;
+
+#define MLOADER_EVENT_MASK(type) (1u << (type))
+
+typedef struct
+{
+	MLoaderEventType Type;
+	VrpApp* App;					// NULL for device and app list changes
+	AppStatus Status;				// app status, or the status on DeviceId for device status changes
+	int StatusParam;				// progress of app status changes, -1 otherwise
+	char DeviceId[64];				// serial of device status changes, empty otherwise
+} MLoaderEvent;
+
+typedef struct MLoaderEventSubscription MLoaderEventSubscription;
+
+#endif // EVENT_H
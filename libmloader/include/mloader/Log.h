@@ -0,0 +1,33 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef LOG_H
+#define LOG_H
+
+typedef enum
+{
+	MLoaderLogDebug = 0,			// also progress updates, these are best sampled with MLoaderSetLogSampling
+	MLoaderLogInfo,
+	MLoaderLogWarning,
+	MLoaderLogError
+} MLoaderLogLevel;
+
+typedef enum
+{
+	MLoaderLogFormatText = 0,		// one readable line per record
+	MLoaderLogFormatJson			// one JSON object per line with time, level, system, event, job, device, bytes, duration_s and message
+} MLoaderLogFormat;
+
+#endif // LOG_H
@@ -0,0 +1,27 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef OPERATION_H
+#define OPERATION_H
+
+#include <stdbool.h>
+
+// Handle of an asynchronous call. It stays valid until MLoaderReleaseOperation, which may be called before the operation completes
+typedef struct MLoaderOperation MLoaderOperation;
+
+// Called once on a library thread when the operation completes. The handle is still valid inside the callback
+typedef void (* MLoaderOperationCompletedCallback)(MLoaderOperation* operation, void* userData);
+
+#endif // OPERATION_H
@@ -0,0 +1,56 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef STATS_H
+#define STATS_H
+
+typedef struct
+{
+	double UptimeSeconds;
+
+	unsigned int QueuedDownloads;
+	unsigned int QueuedInstalls;				// summed over all devices
+
+	// jobs running right now, per stage
+	unsigned int ActiveDownloads;
+	unsigned int ActiveExtractions;
+	unsigned int ActiveInstalls;				// one per device
+	unsigned int ActiveHashes;
+
+	// totals since the context was created
+	unsigned long long BytesDownloaded;
+	unsigned long long BytesExtracted;
+	unsigned long long BytesPushed;				// to devices
+	unsigned long long DownloadsFinished;
+	unsigned long long ExtractionsFinished;
+	unsigned long long InstallsFinished;
+
+	// bytes per second. Current download and extraction rates cover the transfers which finished in the last minute,
+	// the current push rate is live. Averages are taken over the time the stage was busy
+	double DownloadBytesPerSecond;
+	double AverageDownloadBytesPerSecond;
+	double ExtractBytesPerSecond;
+	double AverageExtractBytesPerSecond;
+	double PushBytesPerSecond;
+	double AveragePushBytesPerSecond;
+
+	unsigned long long SubprocessesSpawned;		// by the whole process, including standalone contexts
+	unsigned long long LogRecordsDropped;
+
+	unsigned int CatalogGames;
+	unsigned long long CatalogMemoryBytes;		// estimate for the catalog and its search index
+} MLoaderStats;
+
+#endif // STATS_H
@@ -0,0 +1,29 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TRACE_SUMMARY_H
+#define TRACE_SUMMARY_H
+
+typedef struct
+{
+	const char* Stage;						// stage name, e.g. "transfer" or "obb_push"
+	unsigned long long Count;				// finished spans
+	unsigned long long Bytes;				// bytes moved by all spans of this stage
+	double TotalSeconds;
+	double MaxSeconds;						// slowest single span
+	double MegabytesPerSecond;				// Bytes / TotalSeconds, 0 when nothing was timed
+} TraceStageSummary;
+
+#endif // TRACE_SUMMARY_H
@@ -28,7 +28,8 @@ typedef enum
 	InstallQueued,
 	Installing,
 	InstallingError,
-	Installed
+	Installed,
+	UpdateAvailable		// an older version is installed on the selected device
 } AppStatus;
 
 typedef struct
@@ -43,8 +44,8 @@ typedef struct
 	float Rating;
 	int RatingCount;
 	AppStatus Status;
-	int AppStatusParam;			// When downloading or extracting, progress is reported with this param, otherwise it defaults to -1
-	const char* StatusCStr;		// Formatted Status as string with param, e.g. "Downloading (19%)" or "Extracting (24%)"
+	int AppStatusParam;			// When downloading, extracting or installing, progress is reported with this param, otherwise it defaults to -1
+	const char* StatusCStr;		// Formatted Status as string with param, e.g. "Downloading (19%)" or "Installing (24%)". Points to static storage owned by the library
 	const char* Note;
 } VrpApp;
 
@@ -15,6 +15,8 @@
 
 #include "7z.h"
 #include "Logger.h"
+#include "CpuBudget.h"
+#include "Utility.h"
 #include "curl_global.h"
 #include <filesystem>
 #include <exception>
@@ -24,15 +26,45 @@
 
 namespace mloader
 {
-	Zip::Zip(const std::string& cacheDir, Logger& logger)
+	Zip::Zip(const std::string& cacheDir, Logger& logger, CpuBudget& cpuBudget)
 		: m_cacheDir(cacheDir),
+		  m_cpuBudget(cpuBudget),
 		  m_logger(logger)
 	{
 		CheckAndDownloadTool();
+
+	#ifdef __linux__
+		m_ioniceAvailable = ExecShell("command -v ionice > /dev/null 2>&1") == EXIT_SUCCESS;
+	#endif
 	}
 
 	Zip::~Zip() { }
 
+	void Zip::SetThreadsPerJob(unsigned int threads)
+	{
+		m_threadsPerJob = threads;
+	}
+
+	void Zip::SetLowPriority(bool lowPriority)
+	{
+		m_lowPriority = lowPriority;
+	}
+
+	std::string Zip::GetPriorityCommandPrefix() const
+	{
+		if (!m_lowPriority && !m_cpuBudget.InstallsActive())
+		{
+			return "";
+		}
+
+		std::string prefix = "nice -n 10 ";
+		if (m_ioniceAvailable)
+		{
+			prefix += "ionice -c 3 ";	// idle io class
+		}
+		return prefix;
+	}
+
 	void Zip::CheckAndDownloadTool()
 	{
 		const fs::path zipToolDir = m_cacheDir / "7z/";
@@ -74,7 +106,7 @@ namespace mloader
 			char strbuffer[512];
 			snprintf(strbuffer, sizeof(strbuffer), "tar -xvJf %s -C %s 7zz", zipToolPathZip.c_str(), zipToolDir.c_str());
 			const std::string dbgStr = strbuffer;
-			fp = popen(strbuffer, "r");
+			fp = ProcessOpen(strbuffer, "r");
 			if (fp == NULL)
 			{
 				perror("popen");
@@ -110,12 +142,15 @@ namespace mloader
 			return false;
 		}
 
+		CpuBudget::Lease cpuLease = m_cpuBudget.AcquireExtraction(m_threadsPerJob);
+		m_logger.LogInfo(LOG_NAME, "Extracting with " + std::to_string(cpuLease.GetThreads()) + " threads");
+
 		// unzip
 		FILE* fp;
-		char strbuffer[512];
-		snprintf(strbuffer, sizeof(strbuffer), "%s x -aoa -bsp2 -o%s -p%s %s 2>&1", m_7zToolPath.c_str(), destinationDir.c_str(), password.c_str(), archiveFile.c_str());
+		char strbuffer[1024];
+		snprintf(strbuffer, sizeof(strbuffer), "%s%s x -aoa -bsp2 -mmt%u -o%s -p%s %s 2>&1", GetPriorityCommandPrefix().c_str(), m_7zToolPath.c_str(), cpuLease.GetThreads(), destinationDir.c_str(), password.c_str(), archiveFile.c_str());
 		const std::string dbgStr = strbuffer;
-		fp = popen(strbuffer, "r");
+		fp = ProcessOpen(strbuffer, "r");
 		if (fp == NULL)
 		{
 			perror("popen");
@@ -142,4 +177,118 @@ namespace mloader
 
 		return true;
 	}
-}
+
+	std::vector<ArchiveEntry> Zip::ListArchive(const fs::path& archiveFile, const std::string& password) const
+	{
+		std::vector<ArchiveEntry> entries;
+		if (!fs::exists(archiveFile))
+		{
+			return entries;
+		}
+
+		// -slt prints technical info, one "Key = Value" line per property and a blank line between entries
+		FILE* fp;
+		char strbuffer[512];
+		snprintf(strbuffer, sizeof(strbuffer), "%s l -slt -p%s \"%s\" 2>&1", m_7zToolPath.c_str(), password.c_str(), archiveFile.c_str());
+		fp = ProcessOpen(strbuffer, "r");
+		if (fp == NULL)
+		{
+			perror("popen");
+			m_logger.LogError(LOG_NAME, "Listing archive failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
+			return entries;
+		}
+
+		bool entriesStarted = false;	// properties before the "----------" line describe the archive itself
+		bool isFolder = false;
+		ArchiveEntry entry{};
+
+		auto flushEntry = [&]()
+		{
+			if (!entry.Path.empty() && !isFolder)
+			{
+				entries.push_back(std::move(entry));
+			}
+			entry = ArchiveEntry{};
+			isFolder = false;
+		};
+
+		char line[2048];
+		while (fgets(line, sizeof(line), fp) != NULL)
+		{
+			std::string property(line);
+			while (!property.empty() && (property.back() == '\n' || property.back() == '\r'))
+			{
+				property.pop_back();
+			}
+
+			if (!entriesStarted)
+			{
+				entriesStarted = property == "----------";
+				continue;
+			}
+
+			if (property.empty())
+			{
+				flushEntry();
+			}
+			else if (property.starts_with("Path = "))
+			{
+				entry.Path = property.substr(sizeof("Path = ") - 1);
+			}
+			else if (property.starts_with("Size = "))
+			{
+				entry.Size = std::stoull(property.substr(sizeof("Size = ") - 1));
+			}
+			else if (property.starts_with("Folder = "))
+			{
+				isFolder = property.substr(sizeof("Folder = ") - 1) == "+";
+			}
+		}
+		flushEntry();
+
+		int status = pclose(fp);
+		if (status != EXIT_SUCCESS)
+		{
+			m_logger.LogError(LOG_NAME, "Listing archive " + archiveFile.string() + " failed with status " + std::to_string(status));
+			entries.clear();
+		}
+
+		return entries;
+	}
+
+	bool Zip::ExtractFileToStream(const fs::path& archiveFile, const fs::path& entryPath, const StreamSink& sink, const std::string& password) const
+	{
+		// streamed entries share the cpu budget with regular extractions. They run while their install is active, so always at low priority
+		CpuBudget::Lease cpuLease = m_cpuBudget.AcquireExtraction(m_threadsPerJob);
+
+		// -spd disables wildcard matching, so entry names are taken literally
+		const std::string command = GetPriorityCommandPrefix() + m_7zToolPath.string() + " e -so -spd -mmt" + std::to_string(cpuLease.GetThreads()) + " -p" + password + " \"" + archiveFile.string() + "\" \"" + entryPath.string() + "\" 2>/dev/null";
+		FILE* fp = ProcessOpen(command.c_str(), "r");
+		if (fp == NULL)
+		{
+			perror("popen");
+			m_logger.LogError(LOG_NAME, "Streaming archive entry failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
+			return false;
+		}
+
+		std::vector<char> buffer(64 * 1024);
+		bool sinkAccepted = true;
+		size_t read;
+		while ((read = fread(buffer.data(), 1, buffer.size(), fp)) > 0)
+		{
+			if (!sink(buffer.data(), read))
+			{
+				sinkAccepted = false;
+				break;
+			}
+		}
+
+		int status = pclose(fp);
+		if (sinkAccepted && status != EXIT_SUCCESS)
+		{
+			m_logger.LogError(LOG_NAME, "Streaming " + entryPath.string() + " from " + archiveFile.string() + " failed with status " + std::to_string(status));
+		}
+
+		return sinkAccepted && status == EXIT_SUCCESS;
+	}
+}
\ No newline at end of file
@@ -16,28 +16,55 @@
 #ifndef SEVENZ_H
 #define SEVENZ_H
 
+#include "Utility.h"
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <filesystem>
+#include <vector>
 
 namespace fs = std::filesystem;
 
 namespace mloader
 {
 	class Logger;
+	class CpuBudget;
+
+	struct ArchiveEntry
+	{
+		fs::path Path;		// path of the file inside the archive
+		uint64_t Size;		// unpacked size in bytes
+	};
+
 	class Zip
 	{
 		public:
-			Zip(const std::string& cacheDir, Logger& logger);
+			Zip(const std::string& cacheDir, Logger& logger, CpuBudget& cpuBudget);
 			~Zip();
 
+			void SetThreadsPerJob(unsigned int threads);		// 0 uses every thread that's free in the cpu budget
+			// Extractions always run at low priority while installs are active. Priority and thread count are fixed when a 7-Zip
+			// process starts, so an extraction which is already running keeps them when an install begins
+			void SetLowPriority(bool lowPriority);
+
 			bool Unzip7z(const fs::path& archiveFile, const fs::path& destinationDir, const std::string& password = "") const;
+			std::vector<ArchiveEntry> ListArchive(const fs::path& archiveFile, const std::string& password = "") const;
+
+			// Decompresses a single archive entry and hands it to the sink chunk by chunk, the entry never touches the disk
+			bool ExtractFileToStream(const fs::path& archiveFile, const fs::path& entryPath, const StreamSink& sink, const std::string& password = "") const;
 
 		private:
 			void CheckAndDownloadTool();
+			std::string GetPriorityCommandPrefix() const;
 
 		private:
 			fs::path m_cacheDir;
 			fs::path m_7zToolPath;	// points to 7z executable
+			bool m_ioniceAvailable = false;
+
+			CpuBudget& m_cpuBudget;
+			std::atomic<unsigned int> m_threadsPerJob{0};
+			std::atomic_bool m_lowPriority{false};
 
 			Logger& m_logger;
 			static constexpr const char* LOG_NAME = "Zip";
@@ -14,9 +14,13 @@
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include "ADB.h"
+#include "AdbConnection.h"
 #include "Logger.h"
+#include "Tracer.h"
+#include "ThreadPool.h"
 #include "Utility.h"
 #include "curl_global.h"
+#include "md5.h"
 #include <algorithm>
 #include <atomic>
 #include <filesystem>
@@ -24,6 +28,7 @@
 #include <iostream>
 #include <cstring>
 #include <fstream>
+#include <future>
 #include <unordered_map>
 #include <sstream>
 #include <thread>
@@ -31,22 +36,52 @@
 
 namespace mloader
 {
-	ADB::ADB(const std::string& cacheDir, Logger& logger, std::function<void()> AdbDeviceListChangedCallback)
+	ADB::ADB(const std::string& cacheDir, Logger& logger, std::function<void()> AdbDeviceListChangedCallback, bool resetServer, const std::string& serverHost, uint16_t serverPort)
 		:	m_cacheDir(cacheDir),
+			m_adbDeviceListChangedCallback(AdbDeviceListChangedCallback),
 			m_logger(logger),
-			m_adbDeviceListChangedCallback(AdbDeviceListChangedCallback)
+			m_serverHost(serverHost),
+			m_serverPort(serverPort),
+			m_client(logger, serverHost, serverPort)
 	{
 		CheckAndDownloadTool();
-		ResetServer();
-		StartBackgroundDeviceService();
+		if (resetServer)
+		{
+			ResetServer();
+		}
 	}
 
 	ADB::~ADB()
 	{
-		m_endBackgroundService = true;
+		{
+			std::lock_guard<std::mutex> lock(m_backgroundServiceMutex);
+			m_endBackgroundService = true;
+			if (m_trackerConnection)
+			{
+				m_trackerConnection->Shutdown();
+			}
+		}
+		m_backgroundServiceCondition.notify_all();
+
+		if (m_backgroundDeviceThread.joinable())
+		{
+			m_backgroundDeviceThread.join();
+		}
+
 		KillServer();
 	}
 
+	void ADB::SetTracer(Tracer* tracer)
+	{
+		m_tracer = tracer;
+	}
+
+	void ADB::SetThreadPool(ThreadPool* threadPool)
+	{
+		std::lock_guard<std::mutex> lock(m_threadPoolMutex);
+		m_threadPool = threadPool;
+	}
+
 	std::vector<AdbDevice*> ADB::GetAdbDevices()
 	{
 		std::lock_guard<std::mutex> lock(m_devicesMutex);
@@ -60,18 +95,12 @@ namespace mloader
 		return devices;
 	}
 
-	void ADB::InstallFilesToDevice(const std::string& packageName, const std::vector<fs::path>& fileList, const AdbDevice& device) const
+	InstallReport ADB::InstallFilesToDevice(const std::string& packageName, const std::vector<fs::path>& fileList, const std::string& serial, std::function<void(uint64_t, uint64_t)> progressCallback) const
 	{
-		if (std::count_if(fileList.cbegin(), fileList.cend(), [](const fs::path& path)
-		{
-			return path.extension() == ".obb";
-		}) > 0)
-		{
-			// If file list contains .obb files, clear and recreate obb directory
-			const fs::path obbDir = fs::path("/sdcard/Android/obb/") / packageName;
-			ExecShell(m_adbToolPath.c_str(), "-s", device.DeviceId, "shell", "rm", "-rf", obbDir);
-			ExecShell(m_adbToolPath.c_str(), "-s", device.DeviceId, "shell", "mkdir", obbDir);	// mkdir is probably not needed but it doesn't hurt (adb push would create the directory regardless)
-		}
+		InstallReport report;
+		std::vector<APKSource> apks;
+		std::vector<fs::path> obbFiles;
+		uint64_t totalSize = 0;
 
 		for (const fs::path& file : fileList)
 		{
@@ -80,17 +109,28 @@ namespace mloader
 
 			if (extension == ".apk")
 			{
-				if (!InstallAPK(file, device.DeviceId))
+				apks.push_back({ fileName, fs::file_size(file), [file](const StreamSink& sink)
 				{
-					throw std::runtime_error("Unable to install apk file " + file.string() + " to device " + device.DeviceId);
-				}
+					std::ifstream apkFile(file, std::ios::in | std::ios::binary);
+					std::vector<char> buffer(64 * 1024);
+					while (apkFile)
+					{
+						apkFile.read(buffer.data(), buffer.size());
+						if (apkFile.gcount() > 0 && !sink(buffer.data(), static_cast<size_t>(apkFile.gcount())))
+						{
+							return false;
+						}
+					}
+					return apkFile.eof();
+				}});
+				report.BytesTransferred += apks.back().Size;
+				++report.FilesTransferred;
+				totalSize += apks.back().Size;
 			}
 			else if (extension == ".obb")
 			{
-				if (!InstallOBB(packageName, file, device.DeviceId))
-				{
-					throw std::runtime_error("Unable to install obb file " + file.string() + " to device " + device.DeviceId);
-				}
+				obbFiles.push_back(file);
+				totalSize += fs::file_size(file);
 			}
 			else
 			{
@@ -98,44 +138,261 @@ namespace mloader
 				m_logger.LogError(LOG_NAME, errMsg);
 			}
 		}
+
+		// obb files are pushed from several threads
+		std::atomic<uint64_t> writtenSize{0};
+		auto bytesWritten = [&writtenSize, totalSize, &progressCallback](uint64_t size)
+		{
+			const uint64_t written = writtenSize += size;
+			if (progressCallback)
+			{
+				progressCallback(written, totalSize);
+			}
+		};
+
+		if (!apks.empty() && !InstallAPKs(apks, serial.c_str(), bytesWritten))
+		{
+			throw std::runtime_error("Unable to install apk files of " + packageName + " to device " + serial);
+		}
+
+		if (!obbFiles.empty() && !SyncOBBDirectory(packageName, obbFiles, serial.c_str(), report, bytesWritten))
+		{
+			throw std::runtime_error("Unable to install obb files of " + packageName + " to device " + serial);
+		}
+
+		m_logger.Log(LogLevel::Info, LOG_NAME, "Installed " + packageName + " to device " + serial + ". Transferred " + std::to_string(report.FilesTransferred) + " files (" + std::to_string(report.BytesTransferred) + " bytes), skipped " +
+			std::to_string(report.FilesSkipped) + " unchanged files (" + std::to_string(report.BytesSkipped) + " bytes), removed " + std::to_string(report.FilesRemoved) + " stale files",
+			LogFields{ .Event = "install_files", .Job = packageName, .Device = serial, .Bytes = static_cast<int64_t>(report.BytesTransferred) });
+		return report;
 	}
 
-	std::vector<std::string> ADB::GetDeviceThirdPartyPackages(const AdbDevice& device) const
+	void ADB::InstallArchiveFilesToDevice(const std::string& packageName, const std::vector<ArchiveEntry>& fileList, std::function<bool(const ArchiveEntry&, const StreamSink&)> readEntry, const std::string& serial, std::function<void(uint64_t, uint64_t)> progressCallback) const
 	{
-		std::vector<std::string> packages;
-		ExecShellWithCallback([&packages](const std::string& package)
+		std::vector<APKSource> apks;
+		std::vector<const ArchiveEntry*> obbFiles;
+		uint64_t totalSize = 0;
+
+		for (const ArchiveEntry& file : fileList)
 		{
-			std::string packageTrimmed = package.substr(sizeof("package:") - 1, package.length() - sizeof("package:"));
-			if (packageTrimmed.back() == '\r')
+			const std::string extension = file.Path.extension();
+			totalSize += file.Size;
+
+			if (extension == ".apk")
 			{
-				packageTrimmed.pop_back();
+				apks.push_back({ file.Path.filename().string(), file.Size, [&readEntry, &file](const StreamSink& sink)
+				{
+					return readEntry(file, sink);
+				}});
 			}
-			packages.push_back(packageTrimmed);
-		},
-		m_adbToolPath, "-s", device.DeviceId, "shell", "pm", "list", "packages", "-3");
+			else if (extension == ".obb")
+			{
+				obbFiles.push_back(&file);
+			}
+			else
+			{
+				m_logger.LogError(LOG_NAME, "Unhandled file extension for archive entry " + file.Path.string() + ". Installation will continue, but the application might not work");
+			}
+		}
+
+		uint64_t writtenSize = 0;
+		auto bytesWritten = [&writtenSize, totalSize, &progressCallback](uint64_t size)
+		{
+			writtenSize += size;
+			if (progressCallback)
+			{
+				progressCallback(writtenSize, totalSize);
+			}
+		};
+
+		if (!apks.empty() && !InstallAPKs(apks, serial.c_str(), bytesWritten))
+		{
+			throw std::runtime_error("Unable to stream apk files of " + packageName + " to device " + serial);
+		}
+
+		if (!obbFiles.empty())
+		{
+			ClearOBBDirectory(packageName, serial.c_str());
+		}
+
+		for (const ArchiveEntry* file : obbFiles)
+		{
+			auto producer = [&readEntry, file](const StreamSink& sink)
+			{
+				return readEntry(*file, sink);
+			};
+
+			if (!InstallOBBStream(packageName, producer, *file, serial.c_str(), bytesWritten))
+			{
+				throw std::runtime_error("Unable to stream obb file " + file->Path.string() + " to device " + serial);
+			}
+		}
+	}
+
+	std::shared_ptr<const ADB::PackageInventory> ADB::GetDevicePackages(const std::string& serial) const
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_devicePackagesMutex);
+			auto it = m_devicePackages.find(serial);
+			if (it != m_devicePackages.end())
+			{
+				return it->second;
+			}
+		}
+
+		std::shared_ptr<PackageInventory> packages = std::make_shared<PackageInventory>();
+		if (!ListDevicePackages(serial, "", *packages))
+		{
+			return packages;	// not cached, the next call tries again
+		}
+
+		std::lock_guard<std::mutex> lock(m_devicePackagesMutex);
+		m_devicePackages.emplace(serial, packages);
 		return packages;
 	}
 
+	void ADB::RefreshDevicePackage(const std::string& serial, const std::string& packageName) const
+	{
+		// the filter matches substrings, only take the exact package from the result
+		PackageInventory matches;
+		if (!ListDevicePackages(serial, packageName, matches))
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(m_devicePackagesMutex);
+		auto it = m_devicePackages.find(serial);
+		if (it == m_devicePackages.end())
+		{
+			return;	// no inventory yet, it's read completely on first use
+		}
+
+		// inventories are shared with readers, replace instead of modifying in place
+		std::shared_ptr<PackageInventory> packages = std::make_shared<PackageInventory>(*it->second);
+		auto match = matches.find(packageName);
+		if (match != matches.end())
+		{
+			(*packages)[packageName] = match->second;
+		}
+		else
+		{
+			packages->erase(packageName);
+		}
+		it->second = packages;
+	}
+
+	bool ADB::ListDevicePackages(const std::string& serial, const std::string& filter, PackageInventory& packages) const
+	{
+		// "package:com.example.app versionCode:1234"
+		const std::string command = "cmd package list packages -3 --show-versioncode" + (filter.empty() ? "" : " " + QuoteShellArgument(filter));
+		return m_client.Shell(serial, command, [&packages](const std::string& line)
+		{
+			if (!line.starts_with("package:"))
+			{
+				return;
+			}
+
+			const size_t nameEnd = line.find_first_of(" \r\n", sizeof("package:") - 1);
+			const std::string packageName = line.substr(sizeof("package:") - 1, nameEnd - (sizeof("package:") - 1));
+			const size_t versionStart = line.find("versionCode:");
+			packages[packageName] = versionStart != std::string::npos ? std::strtoll(line.c_str() + versionStart + sizeof("versionCode:") - 1, nullptr, 10) : 0;
+		});
+	}
+
 	std::string ADB::GetDeviceProperty(const AdbDevice& device, const std::string propName) const
 	{
-		std::string property;
+		std::shared_ptr<const PropertyMap> properties = GetDeviceProperties(device.DeviceId);
+		if (!properties)
+		{
+			return "";
+		}
+
+		auto it = properties->find(propName);
+		return it != properties->end() ? it->second : "";
+	}
 
-		int result = ExecShellWithCallback([&property](const std::string& package)
+	void ADB::RefreshDeviceProperties(const AdbDevice& device)
+	{
 		{
-			property = package;
-		},
-		m_adbToolPath, "-s", device.DeviceId, "shell", "getprop", propName.c_str());
+			std::lock_guard<std::mutex> lock(m_devicePropertiesMutex);
+			m_deviceProperties.erase(device.DeviceId);
+		}
+		GetDeviceProperties(device.DeviceId);
+	}
 
-		if (result == EXIT_SUCCESS)
+	std::shared_ptr<const ADB::PropertyMap> ADB::GetCachedDeviceProperties(const std::string& serial) const
+	{
+		std::lock_guard<std::mutex> lock(m_devicePropertiesMutex);
+		auto it = m_deviceProperties.find(serial);
+		return it != m_deviceProperties.end() ? it->second : nullptr;
+	}
+
+	std::shared_ptr<const ADB::PropertyMap> ADB::GetDeviceProperties(const std::string& serial) const
+	{
 		{
-			if (property.back() == '\n' || property.back() == '\r')
+			std::lock_guard<std::mutex> lock(m_devicePropertiesMutex);
+			auto it = m_deviceProperties.find(serial);
+			if (it != m_deviceProperties.end())
 			{
-				property.pop_back();
+				return it->second;
 			}
-			return property;
 		}
 
-		return "";
+		// fetched without holding the lock, so a slow device doesn't block lookups for other devices
+		std::shared_ptr<const PropertyMap> properties = FetchDeviceProperties(serial);
+		if (properties)
+		{
+			std::lock_guard<std::mutex> lock(m_devicePropertiesMutex);
+			m_deviceProperties.emplace(serial, properties);
+		}
+		return properties;
+	}
+
+	std::shared_ptr<const ADB::PropertyMap> ADB::FetchDeviceProperties(const std::string& serial) const
+	{
+		// getprop without arguments dumps every property as "[name]: [value]", values might span several lines
+		std::shared_ptr<PropertyMap> properties = std::make_shared<PropertyMap>();
+		std::string name, value;
+		bool valueOpen = false;
+
+		const bool result = m_client.Shell(serial, "getprop", [&](const std::string& rawLine)
+		{
+			std::string line = rawLine;
+			while (!line.empty() && (line.back() == '\n' || line.back() == '\r'))
+			{
+				line.pop_back();
+			}
+
+			if (valueOpen)
+			{
+				value += "\n" + line;
+			}
+			else
+			{
+				const size_t separator = line.find("]: [");
+				if (!line.starts_with("[") || separator == std::string::npos)
+				{
+					return;
+				}
+				name = line.substr(1, separator - 1);
+				value = line.substr(separator + 4);
+			}
+
+			valueOpen = value.empty() || value.back() != ']';
+			if (!valueOpen)
+			{
+				value.pop_back();
+				(*properties)[name] = std::move(value);
+				value.clear();
+			}
+		});
+
+		if (!result || properties->empty())
+		{
+			m_logger.LogError(LOG_NAME, "Unable to read properties of device " + serial);
+			return nullptr;
+		}
+
+		return properties;
 	}
 
 	void ADB::CheckAndDownloadTool()
@@ -171,7 +428,7 @@ namespace mloader
 			char buffer[1024];
 			snprintf(buffer, sizeof(buffer), "unzip %s -d %s", adbToolPathZip.c_str(), m_cacheDir.c_str());
 			const std::string dbgStr = buffer;
-			fp = popen(buffer, "r");
+			fp = ProcessOpen(buffer, "r");
 			if (fp == NULL)
 			{
 				m_logger.LogError(LOG_NAME, "Unzipping ADB failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
@@ -201,15 +458,13 @@ namespace mloader
 
 	void ADB::StartServer()
 	{
-		while(m_backgroundServiceBusy) { } // wait for the background service to finish (just in case)
-
 		m_logger.LogInfo(LOG_NAME, "Starting ADB Server");
 
 		FILE* fp;
 		char strbuffer[512];
 
-		snprintf(strbuffer, sizeof(strbuffer), "%s start-server", m_adbToolPath.c_str());
-		fp = popen(strbuffer, "r");
+		snprintf(strbuffer, sizeof(strbuffer), "%s -P %u start-server", m_adbToolPath.c_str(), static_cast<unsigned int>(m_serverPort));
+		fp = ProcessOpen(strbuffer, "r");
 		if (fp == NULL)
 		{
 			m_logger.LogError(LOG_NAME, "Starting ADB Server failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
@@ -242,15 +497,13 @@ namespace mloader
 
 	void ADB::KillServer()
 	{
-		while(m_backgroundServiceBusy) { } // wait for the background service to finish
-
 		m_logger.LogInfo(LOG_NAME, "Stopping ADB Server");
 
 		FILE* fp;
 		char strbuffer[512];
 
-		snprintf(strbuffer, sizeof(strbuffer), "%s kill-server", m_adbToolPath.c_str());
-		fp = popen(strbuffer, "r");
+		snprintf(strbuffer, sizeof(strbuffer), "%s -P %u kill-server", m_adbToolPath.c_str(), static_cast<unsigned int>(m_serverPort));
+		fp = ProcessOpen(strbuffer, "r");
 		if (fp == NULL)
 		{
 			m_logger.LogError(LOG_NAME, "Stopping ADB Server failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
@@ -276,164 +529,537 @@ namespace mloader
 		}
 	}
 
-	static const std::string GetDeviceModel(const std::string& adbExecutablePath, const std::string& deviceId)
+	void ADB::Start()
 	{
-		constexpr const char* shellCommandFormat = "%s -s %s shell getprop ro.product.model";
-		char strBuffer[255];
-		snprintf(strBuffer, sizeof(strBuffer), shellCommandFormat, adbExecutablePath.c_str(), deviceId.c_str());
+		m_backgroundDeviceThread = std::thread(&ADB::BackgroundDeviceService, this);
+	}
 
-		FILE* fp = popen(strBuffer, "r");
-		if (fp == NULL)
+	void ADB::BackgroundDeviceService()
+	{
+		// The adb server pushes the full device list whenever it changes, so devices show up as soon as they're connected.
+		// If the server can't be reached, it is (re)started and the connection retried with an exponential backoff
+		std::chrono::milliseconds reconnectDelay = RECONNECT_INITIAL_DELAY;
+		bool connectionLost = false;
+
+		while (true)
 		{
-			perror("popen");
-		}
+			AdbConnection connection;
+			{
+				std::lock_guard<std::mutex> lock(m_backgroundServiceMutex);
+				if (m_endBackgroundService)
+				{
+					break;
+				}
+				m_trackerConnection = &connection;
+			}
 
-		char modelBuffer[255];
-		fgets(modelBuffer, sizeof(modelBuffer), fp);
+			if (connection.Connect(m_serverHost, m_serverPort) && connection.SendRequest("host:track-devices"))
+			{
+				m_logger.LogInfo(LOG_NAME, "Tracking devices");
+				reconnectDelay = RECONNECT_INITIAL_DELAY;
+				connectionLost = false;
+				TrackDevices(connection);
+			}
 
-		int status = pclose(fp);
-		if (status == -1) {
-			perror("pclose");
+			{
+				std::lock_guard<std::mutex> lock(m_backgroundServiceMutex);
+				m_trackerConnection = nullptr;
+				if (m_endBackgroundService)
+				{
+					break;
+				}
+			}
+
+			if (!connectionLost)
+			{
+				m_logger.LogError(LOG_NAME, "Lost connection to the ADB server. " + connection.GetLastError());
+				connectionLost = true;
+
+				// every device is gone with the server, warm-ups still running drop their results
+				std::vector<std::string> unknownDevices;
+				std::lock_guard<std::mutex> lock(m_deviceListMutex);
+				UpdateDeviceList(ParseDeviceList("", unknownDevices));
+			}
+
+			if (!WaitForReconnect(reconnectDelay))
+			{
+				break;
+			}
+			reconnectDelay = std::min(reconnectDelay * 2, RECONNECT_MAX_DELAY);
+			StartServer();
 		}
+	}
 
-		std::string result(modelBuffer);
-		result.erase(std::remove_if(result.begin(), result.end(), [](char c) { return c == '\n' || c == '\r'; }), result.end());
-		return result;
+	bool ADB::WaitForReconnect(std::chrono::milliseconds delay)
+	{
+		std::unique_lock<std::mutex> lock(m_backgroundServiceMutex);
+		return !m_backgroundServiceCondition.wait_for(lock, delay, [this]() { return m_endBackgroundService; });
 	}
 
-	void ADB::StartBackgroundDeviceService()
+	void ADB::TrackDevices(AdbConnection& connection)
 	{
-		std::thread([&]() {
-			while(!m_endBackgroundService)
+		std::string deviceList;
+		while (connection.ReadLengthPrefixed(deviceList))
+		{
+			// the list is published right away, devices seen for the first time get their model once the properties are read
+			std::vector<std::string> unknownDevices;
 			{
-				std::this_thread::sleep_for(std::chrono::seconds(2));
-				m_backgroundServiceBusy = true;
-				FILE* fp;
-				char strbuffer[512];
+				std::lock_guard<std::mutex> lock(m_deviceListMutex);
+				UpdateDeviceList(ParseDeviceList(deviceList, unknownDevices));
+			}
+
+			for (const std::string& serial : unknownDevices)
+			{
+				WarmDevice(serial);
+			}
+		}
+	}
+
+	void ADB::WarmDevice(const std::string& serial)
+	{
+		auto warm = [this, serial]()
+		{
+			std::shared_ptr<const PropertyMap> properties = GetDeviceProperties(serial);
+			GetDevicePackages(serial);	// so selecting the device doesn't wait for the inventory
+
+			std::lock_guard<std::mutex> lock(m_deviceListMutex);
+			m_warmingDevices.erase(serial);
 
-				snprintf(strbuffer, sizeof(strbuffer), "%s devices", m_adbToolPath.c_str());
-				fp = popen(strbuffer, "r");
-				if (fp == NULL)
+			if (std::find(m_authorizedDevices.cbegin(), m_authorizedDevices.cend(), serial) == m_authorizedDevices.cend())
+			{
+				// disconnected while its properties were read
 				{
-					perror("popen");
-					// return false;
+					std::lock_guard<std::mutex> propertiesLock(m_devicePropertiesMutex);
+					m_deviceProperties.erase(serial);
 				}
+				std::lock_guard<std::mutex> packagesLock(m_devicePackagesMutex);
+				m_devicePackages.erase(serial);
+				return;
+			}
 
-				// m_logger.LogInfo(LOG_NAME, Refreshing device list);
+			if (properties && properties->contains("ro.product.model"))
+			{
+				PublishDeviceModel(serial, properties->at("ro.product.model"));
+			}
+		};
 
-				char path[1035];
-				std::vector<std::string> adbDevices;	// list from shell
-				// Read the output
-				while (fgets(path, sizeof(path), fp) != NULL) {
-					adbDevices.push_back(path);
-				}
+		{
+			std::lock_guard<std::mutex> lock(m_deviceListMutex);
+			if (!m_warmingDevices.insert(serial).second)
+			{
+				return;		// already being read
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_threadPoolMutex);
+			if (m_threadPool != nullptr)
+			{
+				m_threadPool->Submit(warm);
+				return;
+			}
+		}
+		warm();
+	}
+
+	void ADB::PublishDeviceModel(const std::string& serial, const std::string& model)
+	{
+		// only the warmed device changes, the rest of the published list is kept as the tracker last left it
+		std::vector<AdbDevice> deviceList;
+		{
+			std::lock_guard<std::mutex> lock(m_devicesMutex);
+			for (const AdbDevice& device : m_devices)
+			{
+				const bool warmed = device.DeviceStatus == AdbDeviceStatus::OK && serial == device.DeviceId;
+				deviceList.push_back({
+					 .DeviceId = strdup(device.DeviceId),
+					 .Model = strdup(warmed ? model.c_str() : device.Model),
+					 .DeviceStatus = device.DeviceStatus
+				});
+			}
+		}
+		UpdateDeviceList(std::move(deviceList));
+	}
 
-				int status = pclose(fp);
-				if (status != EXIT_SUCCESS) {
-					m_logger.LogError(LOG_NAME, "ADB Exited with status " + std::to_string(status) + ". Error number " + std::to_string(errno) + ". " + strerror(errno));
-					perror("pclose");
+	std::vector<AdbDevice> ADB::ParseDeviceList(const std::string& deviceList, std::vector<std::string>& unknownDevices)
+	{
+		std::vector<AdbDevice> devices;
+		std::vector<std::string> authorizedDevices;
+
+		std::istringstream lines(deviceList);
+		std::string adbDeviceLine;
+		while (std::getline(lines, adbDeviceLine))
+		{
+			if (adbDeviceLine.empty())
+			{
+				continue;
+			}
+
+			std::istringstream iss(adbDeviceLine);
+			std::string deviceId, deviceStatus, deviceModel;	// Note: model can only be obtained for authorized devices
+			AdbDeviceStatus eDeviceStatus = AdbDeviceStatus::Unknown;
+			std::getline(iss, deviceId, '\t');
+			std::getline(iss, deviceStatus, '\t');
+
+			// possible device statuses:
+			// device - connected and authorized
+			// unauthorized - requires authorization
+			// offline - device was connected but went offline
+			// no permissions - no debuggging permissions
+
+			if (deviceStatus == "device")
+			{
+				// properties are only fetched once per connection, the device list is pushed again on every change
+				std::shared_ptr<const PropertyMap> properties = GetCachedDeviceProperties(deviceId);
+				if (!properties)
+				{
+					unknownDevices.push_back(deviceId);
 				}
-				else
+				else if (properties->contains("ro.product.model"))
 				{
-					// printf("Command exited with status: %d\n", WEXITSTATUS(status));
+					deviceModel = properties->at("ro.product.model");
 				}
+				authorizedDevices.push_back(deviceId);
+			}
+
+			// "no permissions" status might contain trailing text, trim it
+			if (deviceStatus.starts_with("no permissions"))
+			{
+				deviceStatus = "no permissions";
+			}
+
+			static const std::unordered_map<std::string, AdbDeviceStatus> DEVICE_STATUS_MAP =
+			{
+				{ "device", AdbDeviceStatus::OK 					},
+				{ "unauthorized", AdbDeviceStatus::UnAuthorized		},
+				{ "offline", AdbDeviceStatus::Offline 				},
+				{ "no permissions", AdbDeviceStatus::NoPermissions	}
+			};
+
+			try
+			{
+				eDeviceStatus = DEVICE_STATUS_MAP.at(deviceStatus);
+			}
+			catch (std::out_of_range& exception)
+			{
+				m_logger.LogError(LOG_NAME, "Unknown device status reported on device list: " + deviceStatus + ". " + std::string(exception.what()));
+			}
 
-				if (adbDevices.empty())
+			devices.push_back({
+				 .DeviceId = strdup(deviceId.c_str()),
+				 .Model = strdup(deviceModel.c_str()),
+				 .DeviceStatus = eDeviceStatus
+			});
+		}
+
+		// forget properties, packages and pooled connections of disconnected or no longer authorized devices,
+		// they're fetched again when the device reconnects
+		for (const std::string& serial : m_authorizedDevices)
+		{
+			if (std::find(authorizedDevices.cbegin(), authorizedDevices.cend(), serial) == authorizedDevices.cend())
+			{
 				{
-					continue;
+					std::lock_guard<std::mutex> lock(m_devicePropertiesMutex);
+					m_deviceProperties.erase(serial);
 				}
+				{
+					std::lock_guard<std::mutex> lock(m_devicePackagesMutex);
+					m_devicePackages.erase(serial);
+				}
+				m_client.DropConnections(serial);
+			}
+		}
+		m_authorizedDevices = std::move(authorizedDevices);
+		return devices;
+	}
 
-				adbDevices.erase(adbDevices.begin());	// remove header line
+	void ADB::UpdateDeviceList(std::vector<AdbDevice>&& deviceList)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_devicesMutex);
+			if (deviceList == m_devices)
+			{
+				for (AdbDevice& device : deviceList) { DestroyAdbDevice(device); }
+				return;
+			}
 
-				adbDevices.erase(std::find_if(adbDevices.begin(), adbDevices.end(), [](const std::string& deviceLine)
-				{
-					return deviceLine.empty() || deviceLine == "\n";
-				}));
+			m_logger.LogInfo(LOG_NAME, "Device change detected");
+			for(int i = 0; i < m_devices.size(); ++i){ DestroyAdbDevice(m_devices[i]); }
+			m_devices.clear();
+			m_devices = std::move(deviceList);
+		}
 
-				decltype(m_devices) deviceList;
+		if (m_adbDeviceListChangedCallback)
+		{
+			m_adbDeviceListChangedCallback();
+		}
+	}
 
-				for (std::string adbDeviceLine : adbDevices)
-				{
-					adbDeviceLine.erase(std::remove(adbDeviceLine.begin(), adbDeviceLine.end(), '\n'), adbDeviceLine.cend());
-					std::istringstream iss(adbDeviceLine);
-					std::string deviceId, deviceStatus, deviceModel;	// Note: model can only be obtained for authorized devices
-					AdbDeviceStatus eDeviceStatus = AdbDeviceStatus::Unknown;
-					std::getline(iss, deviceId, '\t');
-					std::getline(iss, deviceStatus, '\t');
-
-					// possible device statuses:
-					// device - connected and authorized
-					// unauthorized - requires authorization
-					// offline - device was connected but went offline
-					// no permissions - no debuggging permissions
-
-					if (deviceStatus == "device")
-					{
-						deviceModel = GetDeviceModel(m_adbToolPath, deviceId);
-					}
+	void ADB::ClearOBBDirectory(const std::string& packageName, const char* serial) const
+	{
+		const std::string obbDir = QuoteShellArgument((fs::path("/sdcard/Android/obb/") / packageName).string());
+		m_client.Shell(serial, "rm -rf " + obbDir + " && mkdir -p " + obbDir);
+	}
 
-					// "no permissions" status might contain trailing text, trim it
-					if (deviceStatus.starts_with("no permissions"))
-					{
-						deviceStatus = "no permissions";
-					}
+	bool ADB::SyncOBBDirectory(const std::string& packageName, const std::vector<fs::path>& obbFiles, const char* serial, InstallReport& report, const BytesWrittenCallback& bytesWritten) const
+	{
+		const fs::path obbDir = fs::path("/sdcard/Android/obb/") / packageName;
 
-					static const std::unordered_map<std::string, AdbDeviceStatus> DEVICE_STATUS_MAP =
-					{
-						{ "device", AdbDeviceStatus::OK 					},
-						{ "unauthorized", AdbDeviceStatus::UnAuthorized		},
-						{ "offline", AdbDeviceStatus::Offline 				},
-						{ "no permissions", AdbDeviceStatus::NoPermissions	}
-					};
+		// a missing directory lists as empty, every file is pushed then
+		std::vector<SyncDirEntry> remoteEntries;
+		if (!m_client.List(serial, obbDir.string(), remoteEntries))
+		{
+			remoteEntries.clear();
+		}
 
-					try
-					{
-						eDeviceStatus = DEVICE_STATUS_MAP.at(deviceStatus);
-					}
-					catch (std::out_of_range& exception)
+		// remove whatever isn't part of the title anymore instead of wiping the whole directory
+		std::string staleFiles;
+		for (const SyncDirEntry& entry : remoteEntries)
+		{
+			if (std::none_of(obbFiles.cbegin(), obbFiles.cend(), [&entry](const fs::path& file) { return file.filename() == entry.Name; }))
+			{
+				staleFiles += " " + QuoteShellArgument((obbDir / entry.Name).string());
+				++report.FilesRemoved;
+			}
+		}
+		if (!staleFiles.empty())
+		{
+			m_client.Shell(serial, "rm -rf" + staleFiles);
+		}
+
+		// unchanged files are skipped, the rest is pushed over a few sync connections at once
+		Tracer::Span span(m_tracer, TraceStage::ObbPush, "", serial);
+		const uint64_t transferredBefore = report.BytesTransferred;
+		std::atomic<size_t> nextFile{0};
+		std::atomic_bool failed{false};
+		std::mutex reportMutex;
+
+		auto pushFiles = [&]()
+		{
+			for (size_t i = nextFile++; i < obbFiles.size() && !failed; i = nextFile++)
+			{
+				const fs::path& file = obbFiles[i];
+				const std::string remotePath = (obbDir / file.filename()).string();
+				const uint64_t fileSize = fs::file_size(file);
+
+				auto remoteEntry = std::find_if(remoteEntries.cbegin(), remoteEntries.cend(), [&file](const SyncDirEntry& entry) { return entry.Name == file.filename(); });
+				if (remoteEntry != remoteEntries.cend() && OBBUpToDate(file, remotePath, *remoteEntry, serial))
+				{
 					{
-						m_logger.LogError(LOG_NAME, "Unknown device status reported on device list: " + deviceStatus + ". " + std::string(exception.what()));
+						std::lock_guard<std::mutex> lock(reportMutex);
+						report.BytesSkipped += fileSize;
+						++report.FilesSkipped;
 					}
+					bytesWritten(fileSize);
+					continue;
+				}
 
-					deviceList.push_back({
-						 .DeviceId = strdup(deviceId.c_str()),
-						 .Model = strdup(deviceModel.c_str()),
-						 .DeviceStatus = eDeviceStatus
-					});
+				if (!InstallOBB(packageName, file, serial, bytesWritten))
+				{
+					m_logger.LogError(LOG_NAME, "Unable to install obb file " + file.string() + " to device " + serial);
+					failed = true;
+					break;
 				}
 
-				if (deviceList != m_devices)
+				std::lock_guard<std::mutex> lock(reportMutex);
+				report.BytesTransferred += fileSize;
+				++report.FilesTransferred;
+			}
+		};
+
+		// an exception must not leave a worker thread, it fails the whole directory instead
+		auto pushWorker = [&]()
+		{
+			try
+			{
+				pushFiles();
+			}
+			catch(const std::exception& e)
+			{
+				m_logger.LogError(LOG_NAME, "Unable to install obb files of " + packageName + " to device " + serial + ": " + e.what());
+				failed = true;
+			}
+		};
+
+		std::vector<std::thread> workers;
+		const size_t workerCount = std::min<size_t>(OBB_PUSH_CONCURRENCY, obbFiles.size());
+		for (size_t i = 1; i < workerCount; ++i)
+		{
+			workers.emplace_back(pushWorker);
+		}
+		pushWorker();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+
+		span.AddBytes(report.BytesTransferred - transferredBefore);
+		if (failed)
+		{
+			span.SetFailed();
+		}
+		return !failed;
+	}
+
+	bool ADB::OBBUpToDate(const fs::path& file, const std::string& remotePath, const SyncDirEntry& remoteEntry, const char* serial) const
+	{
+		if (remoteEntry.Stat.Size != fs::file_size(file))
+		{
+			return false;
+		}
+
+		// sizes match, compare hashes. The local copy is hashed while the device hashes its own
+		std::future<std::string> localHash = std::async(std::launch::async, CalculateFileMD5Hash, file);
+		std::string remoteHash = m_client.ShellOutput(serial, "md5sum " + QuoteShellArgument(remotePath));
+		remoteHash = remoteHash.substr(0, remoteHash.find_first_of(" \t\r\n"));
+
+		const std::string hash = localHash.get();
+		return !hash.empty() && hash == remoteHash;
+	}
+
+	bool ADB::InstallAPKs(const std::vector<APKSource>& apks, const char* serial, const BytesWrittenCallback& bytesWritten) const
+	{
+		// Split apks (split_*.apk, config.*.apk) only work together with their base apk, so they're committed in one session.
+		// Titles without splits ship independent apks which each get their own session
+		const bool hasSplits = std::any_of(apks.cbegin(), apks.cend(), [](const APKSource& apk)
+		{
+			return apk.Name.starts_with("split_") || apk.Name.starts_with("config.");
+		});
+
+		if (hasSplits)
+		{
+			return InstallAPKSession(apks, serial, bytesWritten);
+		}
+
+		for (const APKSource& apk : apks)
+		{
+			if (!InstallAPKSession({ apk }, serial, bytesWritten))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ADB::InstallAPKSession(const std::vector<APKSource>& apks, const char* serial, const BytesWrittenCallback& bytesWritten) const
+	{
+		uint64_t totalSize = 0;
+		for (const APKSource& apk : apks)
+		{
+			totalSize += apk.Size;
+		}
+
+		Tracer::Span span(m_tracer, TraceStage::ApkInstall, "", serial);
+		span.AddBytes(totalSize);
+		span.SetFailed();	// cleared once the session is committed
+
+		// "Success: created install session [1234]"
+		std::string output;
+		if (!RunPackageCommand(serial, "install-create -r -S " + std::to_string(totalSize), nullptr, output))
+		{
+			return false;
+		}
+
+		const size_t sessionStart = output.find('[');
+		const size_t sessionEnd = output.find(']', sessionStart);
+		if (sessionStart == std::string::npos || sessionEnd == std::string::npos)
+		{
+			m_logger.LogError(LOG_NAME, "Unable to parse install session from " + output);
+			return false;
+		}
+		const std::string sessionId = output.substr(sessionStart + 1, sessionEnd - sessionStart - 1);
+
+		// apk bytes are streamed straight into the session, no temporary copy is stored on the device
+		for (const APKSource& apk : apks)
+		{
+			m_logger.LogInfo(LOG_NAME, "Installing APK " + apk.Name + " to device " + serial);
+
+			const std::string writeCommand = "install-write -S " + std::to_string(apk.Size) + " " + sessionId + " " + QuoteShellArgument(apk.Name) + " -";
+			auto producer = [&apk, &bytesWritten](const StreamSink& sink)
+			{
+				return apk.Producer([&sink, &bytesWritten](const char* data, size_t size)
 				{
-					m_logger.LogInfo(LOG_NAME, "Device change detected");
-					{
-						std::lock_guard<std::mutex> lock(m_devicesMutex);
-						for(int i = 0; i < m_devices.size(); ++i){ DestroyAdbDevice(m_devices[i]); }
-						m_devices.clear();
-						m_devices = std::move(deviceList);
-					}
-					if (m_adbDeviceListChangedCallback)
+					if (!sink(data, size))
 					{
-						m_adbDeviceListChangedCallback();
+						return false;
 					}
-				}
 
-				m_backgroundServiceBusy = false;
+					bytesWritten(size);
+					return true;
+				});
+			};
+
+			if (!RunPackageCommand(serial, writeCommand, producer, output))
+			{
+				RunPackageCommand(serial, "install-abandon " + sessionId, nullptr, output);
+				return false;
 			}
-		}).detach();
+		}
+
+		if (!RunPackageCommand(serial, "install-commit " + sessionId, nullptr, output))
+		{
+			// a failed commit already discards the session, abandoning is only needed for sessions which weren't committed
+			return false;
+		}
+
+		span.SetFailed(false);
+		return true;
 	}
 
-	bool ADB::InstallAPK(const fs::path& file, const char* serial) const
+	bool ADB::RunPackageCommand(const char* serial, const std::string& command, const std::function<bool(const StreamSink&)>& producer, std::string& output) const
 	{
-		m_logger.LogInfo(LOG_NAME, "Installing APK " + file.string() + " to device " + serial);
-		std::string escapedAPK = "\"" + file.string() + "\"";
-		return ExecShell(m_adbToolPath.c_str(), "-s", serial, "install", "-r", escapedAPK.c_str()) == EXIT_SUCCESS;
+		// cmd talks to the package service directly, pm would start a runtime for every call
+		output.clear();
+		if (!m_client.Exec(serial, "cmd package " + command, producer, output))
+		{
+			return false;
+		}
+
+		if (!output.starts_with("Success"))
+		{
+			while (!output.empty() && (output.back() == '\n' || output.back() == '\r'))
+			{
+				output.pop_back();
+			}
+			m_logger.LogError(LOG_NAME, "Package manager command " + command + " failed on device " + serial + ". " + output);
+			return false;
+		}
+
+		return true;
 	}
 
-	bool ADB::InstallOBB(const std::string& packageName, const fs::path& file, const char* serial) const
+	bool ADB::InstallOBB(const std::string& packageName, const fs::path& file, const char* serial, const BytesWrittenCallback& bytesWritten) const
 	{
 		m_logger.LogInfo(LOG_NAME, "Installing OBB " + file.string() + " to device " + serial);
-		fs::path targetLocation = fs::path("/sdcard/Android/obb/") / packageName / file.filename();
-		std::string escapedOBB = "\"" + file.string() + "\"";
-		return ExecShell(m_adbToolPath.c_str(), "-s", serial, "push", escapedOBB.c_str(), targetLocation) == EXIT_SUCCESS;
+		const fs::path targetLocation = fs::path("/sdcard/Android/obb/") / packageName / file.filename();
+		return m_client.Push(serial, file, targetLocation.string(), 0644, bytesWritten);
+	}
+
+	bool ADB::InstallOBBStream(const std::string& packageName, const std::function<bool(const StreamSink&)>& producer, const ArchiveEntry& file, const char* serial, const BytesWrittenCallback& bytesWritten) const
+	{
+		m_logger.LogInfo(LOG_NAME, "Streaming OBB " + file.Path.string() + " to device " + serial);
+		const fs::path targetLocation = fs::path("/sdcard/Android/obb/") / packageName / file.Path.filename();
+
+		// adbd confirms the write, only make sure the archive handed over the whole entry
+		Tracer::Span span(m_tracer, TraceStage::ObbPush, "", serial);
+		uint64_t transferred = 0;
+		const bool pushed = m_client.PushStream(serial, targetLocation.string(), [&producer, &transferred, &bytesWritten](const StreamSink& sink)
+		{
+			return producer([&sink, &transferred, &bytesWritten](const char* data, size_t size)
+			{
+				if (!sink(data, size))
+				{
+					return false;
+				}
+
+				transferred += size;
+				bytesWritten(size);
+				return true;
+			});
+		});
+
+		span.AddBytes(transferred);
+		span.SetFailed(!pushed || transferred != file.Size);
+		return pushed && transferred == file.Size;
 	}
 }
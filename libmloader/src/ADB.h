@@ -16,12 +16,20 @@
 #ifndef ADB_H
 #define ADB_H
 
+#include "AdbClient.h"
 #include "AdbDeviceImpl.h"
+#include "7z.h"
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -29,26 +37,88 @@ namespace fs = std::filesystem;
 namespace mloader
 {
 	class Logger;
+	class AdbConnection;
+	class Tracer;
+	class ThreadPool;
+
+	struct InstallReport
+	{
+		uint64_t BytesTransferred = 0;
+		uint64_t BytesSkipped = 0;		// obb files which already were on the device
+		unsigned int FilesTransferred = 0;
+		unsigned int FilesSkipped = 0;
+		unsigned int FilesRemoved = 0;	// stale obb files no longer part of the title
+	};
+
 	class ADB
 	{
 		public:
-			ADB(const std::string& cacheDir, Logger& logger, std::function<void()> AdbDeviceListChangedCallback = nullptr);
+			static constexpr const char* DEFAULT_SERVER_HOST = "127.0.0.1";
+			static constexpr uint16_t DEFAULT_SERVER_PORT = 5037;
+
+			// Without resetServer an adb server which is already running is reused, the device service starts one if there is none.
+			// The server port is passed on to the adb binary as well
+			ADB(const std::string& cacheDir, Logger& logger, std::function<void()> AdbDeviceListChangedCallback = nullptr, bool resetServer = true, const std::string& serverHost = DEFAULT_SERVER_HOST, uint16_t serverPort = DEFAULT_SERVER_PORT);
 			~ADB();
 
+			// Starts the device service. The device list changed callback runs on its thread, so the owner starts it
+			// once the callback can reach this instance
+			void Start();
+			void SetTracer(Tracer* tracer);
+			// Properties and package inventories of new devices are read on the pool, without it on the device service thread.
+			// Reset it to nullptr before the pool is destroyed
+			void SetThreadPool(ThreadPool* threadPool);
+
 			std::vector<AdbDevice*> GetAdbDevices();
-			void InstallFilesToDevice(const std::string& packageName, const std::vector<fs::path>& fileList, const AdbDevice& device) const;
-			std::vector<std::string> GetDeviceThirdPartyPackages(const AdbDevice& device) const;
+			// the progress callback receives the bytes written to the device so far and the total size of all files.
+			// Unchanged obb files which are skipped count as written
+			InstallReport InstallFilesToDevice(const std::string& packageName, const std::vector<fs::path>& fileList, const std::string& serial, std::function<void(uint64_t, uint64_t)> progressCallback = nullptr) const;
+			void InstallArchiveFilesToDevice(const std::string& packageName, const std::vector<ArchiveEntry>& fileList, std::function<bool(const ArchiveEntry&, const StreamSink&)> readEntry, const std::string& serial, std::function<void(uint64_t, uint64_t)> progressCallback = nullptr) const;
+			// Third party packages installed on the device with their version codes. Read once per device connection,
+			// after installs only the installed package is refreshed
+			using PackageInventory = std::unordered_map<std::string, int64_t>;
+			std::shared_ptr<const PackageInventory> GetDevicePackages(const std::string& serial) const;
+			void RefreshDevicePackage(const std::string& serial, const std::string& packageName) const;
 			std::string GetDeviceProperty(const AdbDevice& device, const std::string propName) const;
+			void RefreshDeviceProperties(const AdbDevice& device);
 
 		private:
 			void CheckAndDownloadTool();
 			void StartServer();
 			void ResetServer();
 			void KillServer();
-			void StartBackgroundDeviceService();
+			void BackgroundDeviceService();
+			bool WaitForReconnect(std::chrono::milliseconds delay);
+			void TrackDevices(AdbConnection& connection);
+			std::vector<AdbDevice> ParseDeviceList(const std::string& deviceList, std::vector<std::string>& unknownDevices);
+			void WarmDevice(const std::string& serial);
+			void PublishDeviceModel(const std::string& serial, const std::string& model);	// caller holds m_deviceListMutex
+			void UpdateDeviceList(std::vector<AdbDevice>&& deviceList);
+
+			using PropertyMap = std::unordered_map<std::string, std::string>;
+			std::shared_ptr<const PropertyMap> GetDeviceProperties(const std::string& serial) const;
+			std::shared_ptr<const PropertyMap> GetCachedDeviceProperties(const std::string& serial) const;	// nullptr until they were fetched
+			std::shared_ptr<const PropertyMap> FetchDeviceProperties(const std::string& serial) const;
+			bool ListDevicePackages(const std::string& serial, const std::string& filter, PackageInventory& packages) const;
 
-			bool InstallAPK(const fs::path& file, const char* serial) const;
-			bool InstallOBB(const std::string& packageName, const fs::path& file, const char* serial) const;
+			using BytesWrittenCallback = std::function<void(uint64_t)>;		// receives the size of every chunk written to the device
+
+			void ClearOBBDirectory(const std::string& packageName, const char* serial) const;
+			bool SyncOBBDirectory(const std::string& packageName, const std::vector<fs::path>& obbFiles, const char* serial, InstallReport& report, const BytesWrittenCallback& bytesWritten) const;
+			bool OBBUpToDate(const fs::path& file, const std::string& remotePath, const SyncDirEntry& remoteEntry, const char* serial) const;
+
+			struct APKSource
+			{
+				std::string Name;
+				uint64_t Size;
+				std::function<bool(const StreamSink&)> Producer;
+			};
+
+			bool InstallAPKs(const std::vector<APKSource>& apks, const char* serial, const BytesWrittenCallback& bytesWritten) const;
+			bool InstallAPKSession(const std::vector<APKSource>& apks, const char* serial, const BytesWrittenCallback& bytesWritten) const;
+			bool RunPackageCommand(const char* serial, const std::string& command, const std::function<bool(const StreamSink&)>& producer, std::string& output) const;
+			bool InstallOBB(const std::string& packageName, const fs::path& file, const char* serial, const BytesWrittenCallback& bytesWritten) const;
+			bool InstallOBBStream(const std::string& packageName, const std::function<bool(const StreamSink&)>& producer, const ArchiveEntry& file, const char* serial, const BytesWrittenCallback& bytesWritten) const;
 
 		private:
 			fs::path m_cacheDir;
@@ -59,10 +129,33 @@ namespace mloader
 
 			std::function<void()> m_adbDeviceListChangedCallback;
 
-			std::atomic_bool m_endBackgroundService{false};
-			std::atomic_bool m_backgroundServiceBusy{false};
+			// serial -> full getprop dump, fetched once per connection of an authorized device
+			mutable std::unordered_map<std::string, std::shared_ptr<const PropertyMap>> m_deviceProperties;
+			mutable std::mutex m_devicePropertiesMutex;
+			mutable std::unordered_map<std::string, std::shared_ptr<const PackageInventory>> m_devicePackages;	// serial -> package inventory
+			mutable std::mutex m_devicePackagesMutex;
+			std::vector<std::string> m_authorizedDevices;
+			std::unordered_set<std::string> m_warmingDevices;
+			std::mutex m_deviceListMutex;					// guards the two above and the parsing of device lists
+
+			ThreadPool* m_threadPool = nullptr;
+			std::mutex m_threadPoolMutex;
+
+			std::thread m_backgroundDeviceThread;
+			bool m_endBackgroundService = false;
+			AdbConnection* m_trackerConnection = nullptr;
+			std::mutex m_backgroundServiceMutex;
+			std::condition_variable m_backgroundServiceCondition;
+
+			Tracer* m_tracer = nullptr;
 
 			Logger& m_logger;
+			std::string m_serverHost;
+			uint16_t m_serverPort;
+			AdbClient m_client;		// the adb binary is only used to start and stop the server
+			static constexpr std::chrono::milliseconds RECONNECT_INITIAL_DELAY{250};
+			static constexpr std::chrono::milliseconds RECONNECT_MAX_DELAY{8000};
+			static constexpr unsigned int OBB_PUSH_CONCURRENCY = 3;		// stays below the sync connections AdbClient keeps per device
 			static constexpr const char* LOG_NAME = "ADB";
 	};
 }
@@ -0,0 +1,445 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "AdbClient.h"
+#include "AdbConnection.h"
+#include "Logger.h"
+#include <cstring>
+#include <ctime>
+#include <fstream>
+
+namespace mloader
+{
+	// sync requests and responses are a 4 byte id followed by little endian integers
+	static void AppendUInt32(std::string& buffer, uint32_t value)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			buffer += static_cast<char>((value >> (i * 8)) & 0xFF);
+		}
+	}
+
+	template<typename T>
+	static T ReadLittleEndian(const unsigned char* data)
+	{
+		T value = 0;
+		for (size_t i = 0; i < sizeof(T); ++i)
+		{
+			value |= static_cast<T>(data[i]) << (i * 8);
+		}
+		return value;
+	}
+
+	static bool SendSyncRequest(AdbConnection& connection, const char* id, const std::string& payload)
+	{
+		std::string request(id, 4);
+		AppendUInt32(request, static_cast<uint32_t>(payload.size()));
+		request += payload;
+		return connection.WriteExact(request.data(), request.size());
+	}
+
+	// Layout shared by the STA2 and DNT2 responses (after the id), see adb's file_sync_protocol.h
+	struct SyncStatV2
+	{
+		static constexpr size_t SIZE = 68;
+
+		uint32_t Error;
+		SyncStat Stat;
+
+		static SyncStatV2 Parse(const unsigned char* data)
+		{
+			SyncStatV2 result{};
+			result.Error				= ReadLittleEndian<uint32_t>(data);
+			result.Stat.Mode			= ReadLittleEndian<uint32_t>(data + 20);
+			result.Stat.Size			= ReadLittleEndian<uint64_t>(data + 36);
+			result.Stat.ModifiedTime	= static_cast<int64_t>(ReadLittleEndian<uint64_t>(data + 52));
+			return result;
+		}
+	};
+
+	AdbClient::AdbClient(Logger& logger, const std::string& host, uint16_t port)
+		:	m_host(host),
+			m_port(port),
+			m_logger(logger)
+	{
+	}
+
+	AdbClient::~AdbClient() { }
+
+	std::unique_ptr<AdbConnection> AdbClient::OpenService(const std::string& serial, const std::string& service) const
+	{
+		std::unique_ptr<AdbConnection> connection = std::make_unique<AdbConnection>();
+
+		if (!connection->Connect(m_host, m_port) || !connection->SendRequest("host:transport:" + serial) || !connection->SendRequest(service))
+		{
+			m_logger.LogError(LOG_NAME, "Unable to open " + service + " on device " + serial + ". " + connection->GetLastError());
+			return nullptr;
+		}
+
+		return connection;
+	}
+
+	bool AdbClient::Shell(const std::string& serial, const std::string& command, std::function<void(const std::string&)> lineCallback) const
+	{
+		std::unique_ptr<AdbConnection> connection = OpenService(serial, "shell:" + command);
+		if (!connection)
+		{
+			return false;
+		}
+
+		std::string line;
+		char buffer[4096];
+		long received;
+		while ((received = connection->Read(buffer, sizeof(buffer))) > 0)
+		{
+			for (long i = 0; i < received; ++i)
+			{
+				line += buffer[i];
+				if (buffer[i] == '\n')
+				{
+					if (lineCallback)
+					{
+						lineCallback(line);
+					}
+					line.clear();
+				}
+			}
+		}
+
+		if (!line.empty() && lineCallback)
+		{
+			lineCallback(line);
+		}
+
+		return received == 0;
+	}
+
+	std::string AdbClient::ShellOutput(const std::string& serial, const std::string& command) const
+	{
+		std::string output;
+		Shell(serial, command, [&output](const std::string& line)
+		{
+			output += line;
+		});
+		return output;
+	}
+
+	bool AdbClient::Exec(const std::string& serial, const std::string& command, std::function<bool(const StreamSink&)> producer, std::string& output) const
+	{
+		std::unique_ptr<AdbConnection> connection = OpenService(serial, "exec:" + command);
+		if (!connection)
+		{
+			return false;
+		}
+
+		if (producer)
+		{
+			AdbConnection& stdinConnection = *connection;
+			const bool produced = producer([&stdinConnection](const char* data, size_t size)
+			{
+				return stdinConnection.WriteExact(data, size);
+			});
+
+			if (!produced)
+			{
+				m_logger.LogError(LOG_NAME, "Streaming input of " + command + " to device " + serial + " failed. " + connection->GetLastError());
+				return false;
+			}
+		}
+
+		char buffer[4096];
+		long received;
+		while ((received = connection->Read(buffer, sizeof(buffer))) > 0)
+		{
+			output.append(buffer, static_cast<size_t>(received));
+		}
+
+		return received == 0;
+	}
+
+	std::unique_ptr<AdbConnection> AdbClient::AcquireSyncConnection(const std::string& serial, bool allowPooled) const
+	{
+		if (allowPooled)
+		{
+			std::lock_guard<std::mutex> lock(m_syncConnectionPoolMutex);
+			auto it = m_syncConnectionPool.find(serial);
+			while (it != m_syncConnectionPool.end() && !it->second.empty())
+			{
+				std::unique_ptr<AdbConnection> connection = std::move(it->second.back());
+				it->second.pop_back();
+				if (connection->IsIdle())
+				{
+					return connection;
+				}
+			}
+		}
+
+		return OpenService(serial, "sync:");
+	}
+
+	void AdbClient::ReleaseSyncConnection(const std::string& serial, std::unique_ptr<AdbConnection> connection) const
+	{
+		std::lock_guard<std::mutex> lock(m_syncConnectionPoolMutex);
+		std::vector<std::unique_ptr<AdbConnection>>& pool = m_syncConnectionPool[serial];
+		if (pool.size() < MAX_POOLED_SYNC_CONNECTIONS)
+		{
+			pool.push_back(std::move(connection));
+		}
+	}
+
+	void AdbClient::DropConnections(const std::string& serial)
+	{
+		std::lock_guard<std::mutex> lock(m_syncConnectionPoolMutex);
+		m_syncConnectionPool.erase(serial);
+	}
+
+	bool AdbClient::Stat(const std::string& serial, const std::string& remotePath, SyncStat& stat) const
+	{
+		// a pooled connection might have gone stale, retry once with a fresh one
+		for (bool allowPooled : { true, false })
+		{
+			std::unique_ptr<AdbConnection> connection = AcquireSyncConnection(serial, allowPooled);
+			if (!connection)
+			{
+				return false;
+			}
+
+			bool exists = false;
+			if (SyncStatRequest(*connection, remotePath, stat, exists))
+			{
+				ReleaseSyncConnection(serial, std::move(connection));
+				return exists;
+			}
+		}
+
+		return false;
+	}
+
+	bool AdbClient::SyncStatRequest(AdbConnection& connection, const std::string& remotePath, SyncStat& stat, bool& exists) const
+	{
+		unsigned char response[4 + SyncStatV2::SIZE];
+		if (!SendSyncRequest(connection, "STA2", remotePath) || !connection.ReadExact(response, sizeof(response)))
+		{
+			return false;
+		}
+
+		if (memcmp(response, "STA2", 4) != 0)
+		{
+			m_logger.LogError(LOG_NAME, "Unexpected response to STA2 " + remotePath);
+			return false;
+		}
+
+		const SyncStatV2 result = SyncStatV2::Parse(response + 4);
+		stat = result.Stat;
+		exists = result.Error == 0;
+		return true;
+	}
+
+	bool AdbClient::List(const std::string& serial, const std::string& remoteDir, std::vector<SyncDirEntry>& entries) const
+	{
+		for (bool allowPooled : { true, false })
+		{
+			std::unique_ptr<AdbConnection> connection = AcquireSyncConnection(serial, allowPooled);
+			if (!connection)
+			{
+				return false;
+			}
+
+			entries.clear();
+			if (SyncListRequest(*connection, remoteDir, entries))
+			{
+				ReleaseSyncConnection(serial, std::move(connection));
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool AdbClient::SyncListRequest(AdbConnection& connection, const std::string& remoteDir, std::vector<SyncDirEntry>& entries) const
+	{
+		if (!SendSyncRequest(connection, "LIS2", remoteDir))
+		{
+			return false;
+		}
+
+		constexpr size_t DENT_SIZE = 4 + SyncStatV2::SIZE + 4;	// id, stat, name length
+		unsigned char response[DENT_SIZE];
+		while (connection.ReadExact(response, sizeof(response)))
+		{
+			if (memcmp(response, "DONE", 4) == 0)
+			{
+				return true;
+			}
+
+			if (memcmp(response, "DNT2", 4) != 0)
+			{
+				m_logger.LogError(LOG_NAME, "Unexpected response to LIS2 " + remoteDir);
+				return false;
+			}
+
+			SyncDirEntry entry;
+			entry.Stat = SyncStatV2::Parse(response + 4).Stat;
+			entry.Name.resize(ReadLittleEndian<uint32_t>(response + 4 + SyncStatV2::SIZE));
+			if (!connection.ReadExact(entry.Name.data(), entry.Name.size()))
+			{
+				return false;
+			}
+
+			if (entry.Name != "." && entry.Name != "..")
+			{
+				entries.push_back(std::move(entry));
+			}
+		}
+
+		return false;
+	}
+
+	bool AdbClient::Push(const std::string& serial, const fs::path& localFile, const std::string& remotePath, uint32_t mode, const std::function<void(size_t)>& bytesWrittenCallback) const
+	{
+		std::ifstream file(localFile, std::ios::in | std::ios::binary);
+		if (!file.is_open())
+		{
+			m_logger.LogError(LOG_NAME, "Unable to open " + localFile.string() + " for pushing");
+			return false;
+		}
+
+		return PushStream(serial, remotePath, [&file, &bytesWrittenCallback](const StreamSink& sink)
+		{
+			std::vector<char> buffer(SYNC_DATA_MAX);
+			while (file)
+			{
+				file.read(buffer.data(), buffer.size());
+				const std::streamsize read = file.gcount();
+				if (read > 0 && !sink(buffer.data(), static_cast<size_t>(read)))
+				{
+					return false;
+				}
+				if (read > 0 && bytesWrittenCallback)
+				{
+					bytesWrittenCallback(static_cast<size_t>(read));
+				}
+			}
+			return file.eof();
+		}, mode);
+	}
+
+	bool AdbClient::PushStream(const std::string& serial, const std::string& remotePath, std::function<bool(const StreamSink&)> producer, uint32_t mode) const
+	{
+		// a pooled connection might have gone stale, retry once with a fresh one. Only up to the SEND request though,
+		// the producer can't be rewound once it started handing over data
+		std::unique_ptr<AdbConnection> connection;
+		std::string error;
+		for (bool allowPooled : { true, false })
+		{
+			connection = AcquireSyncConnection(serial, allowPooled);
+			if (!connection)
+			{
+				return false;
+			}
+
+			if (SyncSendRequest(*connection, remotePath, mode))
+			{
+				break;
+			}
+			error = connection->GetLastError();
+			connection.reset();
+		}
+
+		if (!connection)
+		{
+			m_logger.LogError(LOG_NAME, "Pushing " + remotePath + " to device " + serial + " failed. " + error);
+			return false;
+		}
+
+		if (!SyncSendData(*connection, producer))
+		{
+			m_logger.LogError(LOG_NAME, "Pushing " + remotePath + " to device " + serial + " failed. " + connection->GetLastError());
+			return false;	// the session is in an unknown state, don't pool it
+		}
+
+		// adbd acknowledges the whole transfer once the file is written
+		unsigned char response[8];
+		if (!connection->ReadExact(response, sizeof(response)))
+		{
+			m_logger.LogError(LOG_NAME, "Pushing " + remotePath + " to device " + serial + " failed. " + connection->GetLastError());
+			return false;
+		}
+
+		if (memcmp(response, "OKAY", 4) != 0)
+		{
+			std::string failure(ReadLittleEndian<uint32_t>(response + 4), '\0');
+			connection->ReadExact(failure.data(), failure.size());
+			m_logger.LogError(LOG_NAME, "Device " + serial + " refused " + remotePath + ". " + failure);
+			return false;
+		}
+
+		ReleaseSyncConnection(serial, std::move(connection));
+		return true;
+	}
+
+	bool AdbClient::SyncSendRequest(AdbConnection& connection, const std::string& remotePath, uint32_t mode) const
+	{
+		// parent directories are created by adbd
+		return SendSyncRequest(connection, "SEND", remotePath + "," + std::to_string(mode | 0100000));	// S_IFREG
+	}
+
+	bool AdbClient::SyncSendData(AdbConnection& connection, const std::function<bool(const StreamSink&)>& producer) const
+	{
+		// Producers can hand over chunks of any size, DATA packets are limited to SYNC_DATA_MAX bytes
+		std::string packet;
+		packet.reserve(8 + SYNC_DATA_MAX);
+
+		auto flushPacket = [&connection, &packet]()
+		{
+			if (packet.empty())
+			{
+				return true;
+			}
+
+			std::string header("DATA", 4);
+			AppendUInt32(header, static_cast<uint32_t>(packet.size()));
+			const bool written = connection.WriteExact(header.data(), header.size()) && connection.WriteExact(packet.data(), packet.size());
+			packet.clear();
+			return written;
+		};
+
+		const bool produced = producer([&packet, &flushPacket](const char* data, size_t size)
+		{
+			while (size > 0)
+			{
+				const size_t chunk = std::min(size, SYNC_DATA_MAX - packet.size());
+				packet.append(data, chunk);
+				data += chunk;
+				size -= chunk;
+
+				if (packet.size() == SYNC_DATA_MAX && !flushPacket())
+				{
+					return false;
+				}
+			}
+			return true;
+		});
+
+		if (!produced || !flushPacket())
+		{
+			return false;
+		}
+
+		std::string done("DONE", 4);
+		AppendUInt32(done, static_cast<uint32_t>(std::time(nullptr)));
+		return connection.WriteExact(done.data(), done.size());
+	}
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ADB_CLIENT_H
+#define ADB_CLIENT_H
+
+#include "Utility.h"
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace mloader
+{
+	class AdbConnection;
+	class Logger;
+
+	struct SyncStat
+	{
+		uint32_t Mode;
+		uint64_t Size;
+		int64_t ModifiedTime;
+	};
+
+	struct SyncDirEntry
+	{
+		std::string Name;
+		SyncStat Stat;
+	};
+
+	// In-process client for the local adb server. Talks the smart socket protocol directly instead of spawning
+	// an adb process per command. Host and port are configurable so it can be pointed at a stand-in server
+	class AdbClient
+	{
+		public:
+			AdbClient(Logger& logger, const std::string& host = "127.0.0.1", uint16_t port = 5037);
+			~AdbClient();
+
+			// shell: service, the callback receives the output line by line
+			bool Shell(const std::string& serial, const std::string& command, std::function<void(const std::string&)> lineCallback = nullptr) const;
+			std::string ShellOutput(const std::string& serial, const std::string& command) const;
+
+			// exec: service, writes everything the producer passes to its sink to the command's stdin, then collects stdout
+			bool Exec(const std::string& serial, const std::string& command, std::function<bool(const StreamSink&)> producer, std::string& output) const;
+
+			// sync: service
+			bool Stat(const std::string& serial, const std::string& remotePath, SyncStat& stat) const;
+			bool List(const std::string& serial, const std::string& remoteDir, std::vector<SyncDirEntry>& entries) const;
+			bool Push(const std::string& serial, const fs::path& localFile, const std::string& remotePath, uint32_t mode = 0644, const std::function<void(size_t)>& bytesWrittenCallback = nullptr) const;
+			bool PushStream(const std::string& serial, const std::string& remotePath, std::function<bool(const StreamSink&)> producer, uint32_t mode = 0644) const;
+
+			// closes pooled connections, used when a device disconnects
+			void DropConnections(const std::string& serial);
+
+		private:
+			std::unique_ptr<AdbConnection> OpenService(const std::string& serial, const std::string& service) const;
+			std::unique_ptr<AdbConnection> AcquireSyncConnection(const std::string& serial, bool allowPooled) const;
+			void ReleaseSyncConnection(const std::string& serial, std::unique_ptr<AdbConnection> connection) const;
+
+			bool SyncStatRequest(AdbConnection& connection, const std::string& remotePath, SyncStat& stat, bool& exists) const;
+			bool SyncListRequest(AdbConnection& connection, const std::string& remoteDir, std::vector<SyncDirEntry>& entries) const;
+			bool SyncSendRequest(AdbConnection& connection, const std::string& remotePath, uint32_t mode) const;
+			bool SyncSendData(AdbConnection& connection, const std::function<bool(const StreamSink&)>& producer) const;
+
+		private:
+			std::string m_host;
+			uint16_t m_port;
+
+			// Sync sessions stay usable after a request completes, keep a few per device around.
+			// Other services consume the connection, so they're opened on demand which is cheap for a local socket
+			mutable std::unordered_map<std::string, std::vector<std::unique_ptr<AdbConnection>>> m_syncConnectionPool;
+			mutable std::mutex m_syncConnectionPoolMutex;
+
+			Logger& m_logger;
+			static constexpr size_t MAX_POOLED_SYNC_CONNECTIONS = 4;
+			static constexpr size_t SYNC_DATA_MAX = 64 * 1024;
+			static constexpr const char* LOG_NAME = "AdbClient";
+	};
+}
+
+#endif // ADB_CLIENT_H
@@ -0,0 +1,246 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "AdbConnection.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace mloader
+{
+	AdbConnection::AdbConnection() { }
+
+	AdbConnection::~AdbConnection()
+	{
+		Close();
+	}
+
+	bool AdbConnection::Connect(const std::string& host, uint16_t port)
+	{
+		Close();
+
+		addrinfo hints{};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+
+		addrinfo* addresses = nullptr;
+		const int result = getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses);
+		if (result != 0)
+		{
+			m_lastError = std::string("Unable to resolve ") + host + ". " + gai_strerror(result);
+			return false;
+		}
+
+		int fd = -1;
+		for (addrinfo* address = addresses; address != nullptr; address = address->ai_next)
+		{
+			fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+			if (fd == -1)
+			{
+				continue;
+			}
+
+			if (connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+			{
+				break;
+			}
+
+			m_lastError = std::string("Unable to connect to adb server. ") + strerror(errno);
+			close(fd);
+			fd = -1;
+		}
+		freeaddrinfo(addresses);
+
+		if (fd == -1)
+		{
+			return false;
+		}
+
+		const int noDelay = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+	#ifdef SO_NOSIGPIPE
+		const int noSigPipe = 1;
+		setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+	#endif
+
+		m_socket = fd;
+		return true;
+	}
+
+	void AdbConnection::Close()
+	{
+		const int fd = m_socket.exchange(-1);
+		if (fd != -1)
+		{
+			close(fd);
+		}
+	}
+
+	void AdbConnection::Shutdown()
+	{
+		const int fd = m_socket;
+		if (fd != -1)
+		{
+			shutdown(fd, SHUT_RDWR);
+		}
+	}
+
+	bool AdbConnection::IsIdle()
+	{
+		pollfd descriptor{ m_socket, POLLIN, 0 };
+		const int result = poll(&descriptor, 1, 0);
+		if (result == 0)
+		{
+			return true;
+		}
+
+		// a closed connection is readable and returns end of file, pending data means the session is out of step
+		m_lastError = result < 0 ? std::string("Polling the adb server connection failed. ") + strerror(errno) : "Connection closed by adb server";
+		return false;
+	}
+
+	bool AdbConnection::SendRequest(const std::string& request)
+	{
+		char header[5];
+		snprintf(header, sizeof(header), "%04zx", request.size());
+
+		if (!WriteExact(header, 4) || !WriteExact(request.data(), request.size()))
+		{
+			return false;
+		}
+
+		char status[4];
+		if (!ReadExact(status, sizeof(status)))
+		{
+			return false;
+		}
+
+		if (memcmp(status, "OKAY", sizeof(status)) == 0)
+		{
+			return true;
+		}
+
+		std::string failure;
+		if (memcmp(status, "FAIL", sizeof(status)) == 0 && ReadLengthPrefixed(failure))
+		{
+			m_lastError = "adb server refused " + request + ". " + failure;
+		}
+		else
+		{
+			m_lastError = "Unexpected adb server response to " + request;
+		}
+		return false;
+	}
+
+	bool AdbConnection::ReadLengthPrefixed(std::string& payload)
+	{
+		char header[5]{};
+		if (!ReadExact(header, 4))
+		{
+			return false;
+		}
+
+		char* end = nullptr;
+		const unsigned long length = strtoul(header, &end, 16);
+		if (end != header + 4)
+		{
+			m_lastError = "Malformed length prefix from adb server";
+			return false;
+		}
+
+		payload.resize(length);
+		return length == 0 || ReadExact(payload.data(), length);
+	}
+
+	bool AdbConnection::ReadExact(void* buffer, size_t size)
+	{
+		char* data = static_cast<char*>(buffer);
+		while (size > 0)
+		{
+			const ssize_t received = recv(m_socket, data, size, 0);
+			if (received == 0)
+			{
+				m_lastError = "Connection closed by adb server";
+				return false;
+			}
+			if (received < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				m_lastError = std::string("Reading from adb server failed. ") + strerror(errno);
+				return false;
+			}
+			data += received;
+			size -= static_cast<size_t>(received);
+		}
+		return true;
+	}
+
+	long AdbConnection::Read(void* buffer, size_t size)
+	{
+		while (true)
+		{
+			const ssize_t received = recv(m_socket, buffer, size, 0);
+			if (received < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			if (received < 0)
+			{
+				m_lastError = std::string("Reading from adb server failed. ") + strerror(errno);
+			}
+			return static_cast<long>(received);
+		}
+	}
+
+	bool AdbConnection::WriteExact(const void* buffer, size_t size)
+	{
+	#ifdef MSG_NOSIGNAL
+		constexpr int flags = MSG_NOSIGNAL;
+	#else
+		constexpr int flags = 0;
+	#endif
+		const char* data = static_cast<const char*>(buffer);
+		while (size > 0)
+		{
+			const ssize_t sent = send(m_socket, data, size, flags);
+			if (sent < 0)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				m_lastError = std::string("Writing to adb server failed. ") + strerror(errno);
+				return false;
+			}
+			data += sent;
+			size -= static_cast<size_t>(sent);
+		}
+		return true;
+	}
+
+	const std::string& AdbConnection::GetLastError() const
+	{
+		return m_lastError;
+	}
+}
@@ -0,0 +1,55 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ADB_CONNECTION_H
+#define ADB_CONNECTION_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace mloader
+{
+	// A single socket to the local adb server speaking the smart socket protocol:
+	// requests are sent as a 4 digit hex length followed by the payload, the server answers with OKAY or FAIL
+	class AdbConnection
+	{
+		public:
+			AdbConnection();
+			~AdbConnection();
+			AdbConnection(const AdbConnection&) = delete;
+			AdbConnection& operator=(const AdbConnection&) = delete;
+
+			bool Connect(const std::string& host, uint16_t port);
+			void Close();
+			void Shutdown();	// unblocks pending reads from another thread
+			bool IsIdle();		// doesn't block, false once the server closed the connection or sent something nobody asked for
+
+			bool SendRequest(const std::string& request);
+			bool ReadLengthPrefixed(std::string& payload);
+			bool ReadExact(void* buffer, size_t size);
+			long Read(void* buffer, size_t size);		// returns the number of bytes read, 0 once the server closed the connection and -1 on errors
+			bool WriteExact(const void* buffer, size_t size);
+
+			const std::string& GetLastError() const;
+
+		private:
+			std::atomic<int> m_socket{-1};
+			std::string m_lastError;
+	};
+}
+
+#endif // ADB_CONNECTION_H
@@ -20,7 +20,7 @@
 
 bool operator==(const AdbDevice& lhs, const AdbDevice& rhs)
 {
-	return strcmp(lhs.DeviceId, rhs.DeviceId) == 0 && strcmp(lhs.Model, lhs.Model) == 0 && lhs.DeviceStatus == rhs.DeviceStatus;
+	return strcmp(lhs.DeviceId, rhs.DeviceId) == 0 && strcmp(lhs.Model, rhs.Model) == 0 && lhs.DeviceStatus == rhs.DeviceStatus;
 }
 
 void DestroyAdbDevice(AdbDevice device)
@@ -20,27 +20,88 @@
 #include "ADB.h"
 #include "7z.h"
 #include "QueueManager.h"
+#include "CacheManager.h"
+#include "CpuBudget.h"
+#include "Tracer.h"
+#include "StatusCoalescer.h"
+#include "StatusStrings.h"
+#include "CatalogQuery.h"
+#include "ThreadPool.h"
+#include "EventBus.h"
+#include "StartupGraph.h"
+#include "CatalogContext.h"
+#include "StatsDumper.h"
+#include "Utility.h"
 #include "curl_global.h"
 #include <algorithm>
 #include <filesystem>
 #include <string>
 #include <thread>
 #include <future>
+#include <mutex>
+#include <optional>
+#include <atomic>
+#include <condition_variable>
 #include <unordered_map>
+#include <vector>
+#include <chrono>
 
 namespace fs = std::filesystem;
 
-struct AppContext
+static constexpr int DEFAULT_STATUS_BATCH_INTERVAL_MS = 100;
+static constexpr unsigned int ASYNC_THREADS = 4;
+static constexpr int DEFAULT_EVENT_QUEUE_CAPACITY = 1024;
+static constexpr int STATS_THROUGHPUT_WINDOW_SECONDS = 60;
+
+struct AppQueryResult
+{
+	AppContext*						Context;
+	std::shared_ptr<const mloader::GameCatalog>	Catalog;	// the indices refer to this catalog
+	std::vector<uint32_t>			Indices;			// catalog indices, in the requested order
+};
+
+struct MLoaderEventSubscription
+{
+	std::shared_ptr<mloader::EventBus::Subscription>	Subscription;
+};
+
+struct MLoaderOperation
 {
-	mloader::VRPManager*			VrpManager;
-	mloader::RClone*				Rclone;
-	mloader::Zip*					Zip7;
-	mloader::ADB*					Adb;
-	mloader::Logger*				Logger;
-	mloader::QueueManager*			QueueManager;
+	MLoaderOperationCompletedCallback	Callback;
+	void*								UserData;
+	std::atomic<int>					References			{ 2 };		// the caller and the pool thread running it
+	std::mutex							Mutex;
+	std::condition_variable				CompletedCondition;
+	bool								Done				= false;
+	bool								Succeeded			= false;
+	std::string							Result;
+};
 
-	// App list
+struct AppContext
+{
+	mloader::VRPManager*			VrpManager								= nullptr;
+	mloader::RClone*				Rclone									= nullptr;
+	mloader::Zip*					Zip7									= nullptr;
+	mloader::ADB*					Adb										= nullptr;
+	mloader::Logger*				Logger									= nullptr;
+	mloader::QueueManager*			QueueManager							= nullptr;
+	mloader::CacheManager*			CacheManager							= nullptr;
+	mloader::CpuBudget*				CpuBudget								= nullptr;
+	mloader::Tracer*				Tracer									= nullptr;
+	mloader::StatusCoalescer*		StatusCoalescer							= nullptr;
+	mloader::ThreadPool*			ThreadPool								= nullptr;
+	mloader::EventBus*				EventBus								= nullptr;
+	mloader::StatsDumper*			StatsDumper								= nullptr;
+	std::chrono::steady_clock::time_point	CreationTime					= std::chrono::steady_clock::now();
+
+	// App list, entries are created on first use
 	VrpApp** 						AppList 								= nullptr;
+	int								NumApps									= 0;
+	std::shared_ptr<const mloader::GameCatalog>	AppCatalog;					// catalog snapshot AppList was built from
+	std::shared_ptr<const mloader::CatalogQuery>	AppQuery;				// built on the first query of AppCatalog
+	std::vector<VrpApp*>			RetiredApps;							// apps of titles which are gone from the metadata, kept until the context is destroyed since handed out pointers stay valid
+	std::vector<char*>				RetiredStrings;							// strings of apps which were replaced by new metadata, the front end may still be reading them
+	std::mutex						AppListMutex;
 	AdbDevice**						AdbDeviceList 							= nullptr;
 
 	// callbacks
@@ -48,6 +109,10 @@ struct AppContext
 	void*							AdbDeviceListChangedCallbackUserData	= nullptr;
 	AppStatusChangedCallback		AppsStatusChangedCallback				= nullptr;
 	void*							AppsStatusChangedCallbackUserData		= nullptr;
+	AppStatusBatchChangedCallback	AppsStatusBatchChangedHandler			= nullptr;
+	void*							AppsStatusBatchChangedHandlerUserData	= nullptr;
+	AppDeviceStatusChangedCallback	AppDeviceStatusChangedHandler			= nullptr;
+	void*							AppDeviceStatusChangedHandlerUserData	= nullptr;
 };
 
 static std::string DetermineCacheDir()
@@ -109,67 +174,348 @@ static int RefreshAdbDeviceList(AppContext* context)
 	return numDevices;
 }
 
-static char* GetUpdateStatusString(AppStatus appStatus, int statusParam = -1)
+void OnAdbDeviceListChangedEvent(AppContext* context)
 {
-	static std::unordered_map<AppStatus, const char*> APP_STATUS_STR_MAP =
+	RefreshAdbDeviceList(context);
+
+	if (context->AdbDeviceListChangedCallback)
 	{
-		{ AppStatus::NoInfo, 			"" 					},
-		{ AppStatus::DownloadQueued,	"Download Queued"	},
-		{ AppStatus::Downloading, 		"Downloading" 		},
-		{ AppStatus::DownloadError, 	"Download Error"	},
-		{ AppStatus::Extracting, 		"Extracting"		},
-		{ AppStatus::ExtractingError,	"Extracting Error"	},
-		{ AppStatus::Downloaded,		"Downloaded"		},
-		{ AppStatus::InstallQueued,		"Install Queued"	},
-		{ AppStatus::Installing,		"Installing"		},
-		{ AppStatus::InstallingError,	"Installing Error"	},
-		{ AppStatus::Installed,			"Installed"			}
-	};
+		context->AdbDeviceListChangedCallback(context, context->AdbDeviceListChangedCallbackUserData);
+	}
+
+	context->EventBus->Publish(MLoaderEvent { MLoaderEventAdbDeviceListChanged, nullptr, AppStatus::NoInfo, -1, "" });
+}
 
-	char* result = nullptr;
-	if (appStatus == AppStatus::Downloading)
+// Allocates the app list for the current catalog. Caller holds AppListMutex
+static void EnsureAppList(AppContext* context)
+{
+	if (context->AppList != nullptr)
 	{
-		asprintf(&result, "%s (%d%%)", APP_STATUS_STR_MAP.at(appStatus), statusParam);
+		return;
 	}
-	else
+
+	if (context->VrpManager != nullptr)		// catalog contexts keep the catalog they were created with
 	{
-		result = strdup(APP_STATUS_STR_MAP.at(appStatus));
+		context->AppCatalog = context->VrpManager->GetCatalog();
 	}
+	context->NumApps = static_cast<int>(context->AppCatalog->GetSize());
+	context->AppList = new VrpApp*[context->NumApps]();
+}
 
-	return result;
+// Creates the VrpApp of a catalog entry the first time it's handed out. Caller holds AppListMutex
+static VrpApp* MaterializeApp(AppContext* context, int index)
+{
+	VrpApp*& app = context->AppList[index];
+	if (app == nullptr)
+	{
+		const mloader::GameInfo& game = context->AppCatalog->GetGame(index);
+		app = new VrpApp();
+		app->GameName 		= strdup(game.GameName.c_str());
+		app->ReleaseName 	= strdup(game.ReleaseName.c_str());
+		app->PackageName 	= strdup(game.PackageName.c_str());
+		app->VersionCode 	= game.VersionCode;
+		app->LastUpdated 	= strdup(game.LastUpdated.c_str());
+		app->SizeMB 		= game.SizeMB;
+		app->Downloads 		= game.Downloads;
+		app->Rating 		= game.Rating;
+		app->RatingCount 	= game.RatingCount;
+		app->Status 		= context->AppCatalog->GetStatus(index);
+		app->AppStatusParam = -1;									// When downloading or extracting, progress is reported with this param, otherwise it defaults to -1
+		app->StatusCStr 	= mloader::GetAppStatusString(app->Status);
+		app->Note			= strdup(context->VrpManager != nullptr ? context->VrpManager->GetAppNote(game).c_str() : "");
+	}
+	return app;
 }
 
-void OnAdbDeviceListChangedEvent(AppContext* context)
+// Replaces a string of a handed out app if it changed. Caller holds AppListMutex
+static void UpdateAppString(AppContext* context, const char*& field, const std::string& value)
 {
-	RefreshAdbDeviceList(context);
+	if (value == field)
+	{
+		return;
+	}
 
-	if (context->AdbDeviceListChangedCallback)
+	context->RetiredStrings.push_back(const_cast<char*>(field));
+	field = strdup(value.c_str());
+}
+
+static void FreeApp(VrpApp* app)
+{
+	// cleanup individual strings
+	free((char*)app->GameName);
+	free((char*)app->ReleaseName);
+	free((char*)app->PackageName);
+	free((char*)app->LastUpdated);
+	free((char*)app->Note);
+
+	app->GameName		= NULL;
+	app->ReleaseName	= NULL;
+	app->PackageName	= NULL;
+	app->LastUpdated	= NULL;
+	app->StatusCStr		= NULL;
+	app->Note			= NULL;
+
+	delete app;
+}
+
+// Moves the app list over to the catalog the VRP manager publishes now. Apps which are still in the metadata keep their VrpApp,
+// so pointers handed out before stay valid. Returns false if the app list already shows that catalog
+static bool ApplyCatalog(AppContext* context)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
 	{
-		context->AdbDeviceListChangedCallback(context, context->AdbDeviceListChangedCallbackUserData);
+		std::lock_guard<std::mutex> lock(context->AppListMutex);
+		if (context->AppList != nullptr && catalog == context->AppCatalog)
+		{
+			return false;
+		}
+	}
+
+	// queued jobs move over before the app list does, so the devices of dropped jobs are reported with the apps they belong to
+	context->QueueManager->ApplyCatalog(catalog);
+
+	std::vector<VrpApp*> droppedApps;
+	{
+		std::lock_guard<std::mutex> lock(context->AppListMutex);
+		if (context->AppList == nullptr)
+		{
+			return true;		// nothing handed out yet, the list is created from the new catalog on first use
+		}
+
+		if (catalog == context->AppCatalog)
+		{
+			return false;
+		}
+
+		const int numApps = static_cast<int>(catalog->GetSize());
+		VrpApp** appList = new VrpApp*[numApps]();
+		std::vector<int> indices(context->NumApps, -1);		// index in the previous app list -> index in the new one
+		for (int i = 0; i < context->NumApps; ++i)
+		{
+			VrpApp* app = context->AppList[i];
+			if (app == nullptr)
+			{
+				continue;
+			}
+
+			const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
+			if (game == nullptr)
+			{
+				if (app->Status != AppStatus::NoInfo)
+				{
+					droppedApps.push_back(app);
+				}
+				app->Status = AppStatus::NoInfo;
+				app->AppStatusParam = -1;
+				app->StatusCStr = mloader::GetAppStatusString(app->Status);
+				context->RetiredApps.push_back(app);
+				continue;
+			}
+
+			const size_t index = *catalog->IndexOf(*game);
+			UpdateAppString(context, app->GameName, game->GameName);
+			UpdateAppString(context, app->PackageName, game->PackageName);
+			UpdateAppString(context, app->LastUpdated, game->LastUpdated);
+			UpdateAppString(context, app->Note, context->VrpManager->GetAppNote(*game));
+			app->VersionCode	= game->VersionCode;
+			app->SizeMB			= game->SizeMB;
+			app->Downloads		= game->Downloads;
+			app->Rating			= game->Rating;
+			app->RatingCount	= game->RatingCount;
+			app->Status			= catalog->GetStatus(index);
+			app->AppStatusParam	= -1;
+			app->StatusCStr		= mloader::GetAppStatusString(app->Status);
+			appList[index] = app;
+			indices[i] = static_cast<int>(index);
+		}
+
+		delete[] context->AppList;
+		context->AppList = appList;
+		context->NumApps = numApps;
+		context->AppCatalog = catalog;
+		context->AppQuery = nullptr;
+		if (context->StatusCoalescer)
+		{
+			context->StatusCoalescer->Remap(indices);
+		}
+	}
+
+	// queued or failed titles which are gone from the metadata
+	for (VrpApp* app : droppedApps)
+	{
+		if (context->AppsStatusChangedCallback)
+		{
+			context->AppsStatusChangedCallback(context, app, context->AppsStatusChangedCallbackUserData);
+		}
+		context->EventBus->Publish(MLoaderEvent { MLoaderEventAppStatusChanged, app, AppStatus::NoInfo, -1, "" });
 	}
+	return true;
 }
 
 void OnGameInfoStatusChanged(AppContext* context, const mloader::GameInfo& gameInfo, const AppStatus appStatus, const int statusParam)
 {
-	if (context->AppsStatusChangedCallback && context->AppList != nullptr)
+	VrpApp* updatedApp = nullptr;
+	int index = -1;
+	{
+		std::lock_guard<std::mutex> lock(context->AppListMutex);
+		if (context->AppList == nullptr)
+		{
+			return;
+		}
+
+		std::optional<size_t> catalogIndex = context->AppCatalog->IndexOf(gameInfo);
+		if (!catalogIndex || context->AppList[*catalogIndex] == nullptr)
+		{
+			return;		// apps which weren't handed out yet read their status from the catalog when they are
+		}
+
+		index = static_cast<int>(*catalogIndex);
+		updatedApp = context->AppList[index];
+		updatedApp->Status = appStatus;
+		updatedApp->AppStatusParam = statusParam;
+		updatedApp->StatusCStr = mloader::GetAppStatusString(appStatus, statusParam);
+
+		// marked under the lock, so the index is remapped with the app list when new metadata is applied
+		if (context->AppsStatusBatchChangedHandler && context->StatusCoalescer)
+		{
+			context->StatusCoalescer->Mark(index);
+		}
+	}
+
+	if (context->AppsStatusChangedCallback)
+	{
+		context->AppsStatusChangedCallback(context, updatedApp, context->AppsStatusChangedCallbackUserData);
+	}
+
+	context->EventBus->Publish(MLoaderEvent { MLoaderEventAppStatusChanged, updatedApp, appStatus, statusParam, "" });
+}
+
+void OnAppStatusBatchReady(AppContext* context, const std::vector<int>& indices)
+{
+	AppStatusBatchChangedCallback handler = context->AppsStatusBatchChangedHandler;
+	if (handler == nullptr)
+	{
+		return;
+	}
+
+	std::vector<VrpApp*> changedApps;
+	changedApps.reserve(indices.size());
 	{
-		VrpApp* updatedApp = nullptr;
-		for (int i = 0; i < context->VrpManager->GetGameList().size(); ++i)
+		std::lock_guard<std::mutex> lock(context->AppListMutex);
+		if (context->AppList == nullptr)
+		{
+			return;
+		}
+
+		for (const int index : indices)
 		{
-			if (context->AppList[i]->ReleaseName == gameInfo.ReleaseName)
+			// a batch taken before new metadata was applied may hold indices of the previous app list
+			if (index < context->NumApps && context->AppList[index] != nullptr)
 			{
-				updatedApp = context->AppList[i];
-				updatedApp->Status = appStatus;
-				free((char*)context->AppList[i]->StatusCStr);
-				context->AppList[i]->StatusCStr = GetUpdateStatusString(appStatus, statusParam);
-				context->AppsStatusChangedCallback(context, updatedApp, context->AppsStatusChangedCallbackUserData);
-				break;
+				changedApps.push_back(context->AppList[index]);
 			}
 		}
 	}
+
+	handler(context, changedApps.data(), static_cast<int>(changedApps.size()), context->AppsStatusBatchChangedHandlerUserData);
+}
+
+void OnDeviceInstallStatusChanged(AppContext* context, const mloader::GameInfo& gameInfo, const std::string& serial, const AppStatus appStatus)
+{
+	VrpApp* app = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(context->AppListMutex);
+		if (context->AppList == nullptr)
+		{
+			return;
+		}
+
+		std::optional<size_t> index = context->AppCatalog->IndexOf(gameInfo);
+		if (!index || context->AppList[*index] == nullptr)
+		{
+			return;
+		}
+		app = context->AppList[*index];
+	}
+
+	if (context->AppDeviceStatusChangedHandler)
+	{
+		context->AppDeviceStatusChangedHandler(context, app, serial.c_str(), appStatus, context->AppDeviceStatusChangedHandlerUserData);
+	}
+
+	MLoaderEvent event { MLoaderEventAppDeviceStatusChanged, app, appStatus, -1, "" };
+	snprintf(event.DeviceId, sizeof(event.DeviceId), "%s", serial.c_str());
+	context->EventBus->Publish(event);
+}
+
+// Deletes the context and whichever components it has, dependents before what they depend on
+static void DeleteContext(AppContext* context)
+{
+	delete context->StatsDumper;
+	if (context->Adb)
+	{
+		context->Adb->SetThreadPool(nullptr);
+	}
+	delete context->ThreadPool;
+	delete context->StatusCoalescer;
+	delete context->CacheManager;
+	delete context->QueueManager;
+	delete context->VrpManager;
+	delete context->Adb;
+	delete context->Zip7;
+	delete context->Rclone;
+	delete context->Logger;
+	delete context->CpuBudget;
+	delete context->Tracer;
+	delete context->EventBus;
+	delete context;
+}
+
+static std::string FormatSeconds(double seconds)
+{
+	char buffer[32];
+	snprintf(buffer, sizeof(buffer), "%.2f s", seconds);
+	return buffer;
+}
+
+// Fetches new metadata after a warm start. Offline the cached game list stays in use
+static void RevalidateMetadata(AppContext* context)
+{
+	try
+	{
+		if (!context->VrpManager->RefreshMetadata(true))
+		{
+			context->Logger->LogWarning("Initialization", "Unable to revalidate the metadata, using the cached game list");
+			return;
+		}
+	}
+	catch(const std::exception& e)
+	{
+		context->Logger->LogError("Initialization", std::string("Revalidating the metadata failed, using the cached game list: ") + e.what());
+		return;
+	}
+
+	if (ApplyCatalog(context))
+	{
+		context->EventBus->Publish(MLoaderEvent { MLoaderEventAppListChanged, nullptr, AppStatus::NoInfo, -1, "" });
+	}
 }
 
 AppContext* CreateLoaderContext(CreateLoaderContextStatusCallback callback, const char* customCacheDir, const char* customDownloadDir)
+{
+	LoaderContextOptions options;
+	MLoaderInitContextOptions(&options);
+	options.CacheDir = customCacheDir;
+	options.DownloadDir = customDownloadDir;
+	return MLoaderCreateLoaderContextWithOptions(&options, callback);
+}
+
+void MLoaderInitContextOptions(LoaderContextOptions* options)
+{
+	*options = LoaderContextOptions{};
+}
+
+AppContext* MLoaderCreateLoaderContextWithOptions(const LoaderContextOptions* options, CreateLoaderContextStatusCallback callback)
 {
 	GenericCallback(callback, "Initializing");
 
@@ -177,16 +523,19 @@ AppContext* CreateLoaderContext(CreateLoaderContextStatusCallback callback, cons
 	fs::path cacheDir = DetermineCacheDir();
 	fs::path downloadDir = DetermineDownloadDir();
 
-	if (customCacheDir[0] != '\0')
+	if (options->CacheDir != NULL && options->CacheDir[0] != '\0')
 	{
-		cacheDir = customCacheDir;
+		cacheDir = options->CacheDir;
 	}
 
-	if (customDownloadDir[0] != '\0')
+	if (options->DownloadDir != NULL && options->DownloadDir[0] != '\0')
 	{
-		downloadDir = customDownloadDir;
+		downloadDir = options->DownloadDir;
 	}
 
+	const bool warmStart = options->WarmStart;
+	bool revalidateMetadata = false;
+
 	try
 	{
 		if (!fs::is_directory(cacheDir))
@@ -206,6 +555,9 @@ AppContext* CreateLoaderContext(CreateLoaderContextStatusCallback callback, cons
 	}
 
 	AppContext* appContext = new AppContext();
+	appContext->CpuBudget = new mloader::CpuBudget();
+	appContext->Tracer = new mloader::Tracer();
+	appContext->EventBus = new mloader::EventBus();
 
 	try
 	{
@@ -214,99 +566,138 @@ AppContext* CreateLoaderContext(CreateLoaderContextStatusCallback callback, cons
 	catch(std::runtime_error& error)
 	{
 		err_msg = error.what();
-		delete appContext;
+		DeleteContext(appContext);
 		return nullptr;
 	}
 
+	appContext->Tracer->SetLogger(appContext->Logger);
 	appContext->Logger->LogInfo("Initialization", "Starting up");
 	appContext->Logger->LogInfo("Initialization", "Cache directory: " + std::string(cacheDir));
 	appContext->Logger->LogInfo("Initialization", "Download directory: " + std::string(downloadDir));
 
-	try
+	// The tools, the ADB server and the VRP credentials don't depend on each other and are set up concurrently.
+	// The metadata only needs rclone, 7-Zip and the credentials, so it's loaded while the ADB server may still be starting.
+	// A warm start keeps a running ADB server and serves the game list of the previous run, new metadata is fetched once the context is up
+	mloader::StartupGraph startup;
+	startup.AddPhase("RClone", {}, [appContext, &cacheDir]()
 	{
-		GenericCallback(callback, "Initializing RClone");
 		appContext->Rclone = new mloader::RClone(cacheDir, *appContext->Logger);
-	}
-	catch(std::runtime_error& error)
-	{
-		err_msg = error.what();
-		delete appContext->Logger;
-		delete appContext;
-		return nullptr;
-	}
-
-	try
-	{
-		GenericCallback(callback, "Initializing 7-Zip");
-		appContext->Zip7 = new mloader::Zip(cacheDir, *appContext->Logger);
-	}
-	catch(std::runtime_error& error)
+	});
+	startup.AddPhase("7-Zip", {}, [appContext, &cacheDir]()
 	{
-		err_msg = error.what();
-		delete appContext->Rclone;
-		delete appContext->Logger;
-		delete appContext;
-		return nullptr;
-	}
-
-	try
+		appContext->Zip7 = new mloader::Zip(cacheDir, *appContext->Logger, *appContext->CpuBudget);
+	});
+	startup.AddPhase("ADB", {}, [appContext, &cacheDir, warmStart]()
 	{
-		GenericCallback(callback, "Initializing ADB");
-		appContext->Adb = new mloader::ADB(cacheDir, *appContext->Logger, std::bind(OnAdbDeviceListChangedEvent, appContext));
-	}
-	catch(std::runtime_error& error)
+		appContext->Adb = new mloader::ADB(cacheDir, *appContext->Logger, std::bind(OnAdbDeviceListChangedEvent, appContext), !warmStart);
+		appContext->Adb->SetTracer(appContext->Tracer);
+		appContext->Adb->Start();
+	});
+	startup.AddPhase("VRP credentials", {}, [&cacheDir]()
 	{
-		err_msg = error.what();
-		delete appContext->Rclone;
-		delete appContext->Zip7;
-		delete appContext->Logger;
-		delete appContext;
-		return nullptr;
-	}
-
-	try
+		if (!mloader::VRPManager::FetchPublicCredentials(cacheDir))
+		{
+			throw std::runtime_error("Unable to download vrp-public.json from VRP");
+		}
+	});
+	startup.AddPhase("VRP", { "RClone", "7-Zip", "VRP credentials" }, [appContext, &cacheDir, &downloadDir]()
 	{
-		GenericCallback(callback, "Initializing VRP");
-
 		auto onAppStatusChanged = [appContext](const mloader::GameInfo& gameInfo, const AppStatus appStatus, const int statusParam)
 		{
 			OnGameInfoStatusChanged(appContext, gameInfo, appStatus, statusParam);
 		};
 
 		appContext->VrpManager = new mloader::VRPManager(*appContext->Rclone, *appContext->Zip7, cacheDir, downloadDir, *appContext->Logger, onAppStatusChanged);
-	}
-	catch(std::runtime_error& error)
+		appContext->VrpManager->SetTracer(appContext->Tracer);
+	});
+	startup.AddPhase("metadata", { "VRP" }, [appContext, warmStart, &revalidateMetadata]()
 	{
-		err_msg = error.what();
-		delete appContext->Rclone;
-		delete appContext->Zip7;
-		delete appContext->Adb;
-		delete appContext->Logger;
-		delete appContext;
-		return nullptr;
-	}
+		if (warmStart && appContext->VrpManager->LoadCachedMetadata())
+		{
+			revalidateMetadata = true;
+			return;
+		}
 
-	appContext->QueueManager = new mloader::QueueManager(*appContext->VrpManager, *appContext->Adb, *appContext->Logger);
+		if (!appContext->VrpManager->RefreshMetadata())
+		{
+			throw std::runtime_error("Unable to load metadata");
+		}
+	});
 
+	const std::chrono::steady_clock::time_point startupBegin = std::chrono::steady_clock::now();
 	try
 	{
-		GenericCallback(callback, "Loading metadata");
-		if (!RefreshMetadata(appContext))
+		startup.Run([callback](const std::string& phase)
 		{
-			throw std::runtime_error("Unable to load metadata");
-		}
-	}catch(std::runtime_error& error)
+			GenericCallback(callback, ("Initializing " + phase).c_str());
+		},
+		[appContext, callback](const std::string& phase, double seconds)
+		{
+			const std::string message = phase + " ready (" + FormatSeconds(seconds) + ")";
+			appContext->Logger->LogInfo("Initialization", message);
+			GenericCallback(callback, message.c_str());
+		});
+	}
+	catch(std::exception& error)
 	{
 		err_msg = error.what();
-		delete appContext->Rclone;
-		delete appContext->Zip7;
-		delete appContext->Adb;
-		delete appContext->VrpManager;
-		delete appContext->Logger;
-		delete appContext;
+		appContext->Logger->LogError("Initialization", error.what());
+		DeleteContext(appContext);
 		return nullptr;
 	}
 
+	appContext->QueueManager = new mloader::QueueManager(*appContext->VrpManager, *appContext->Adb, *appContext->CpuBudget, *appContext->Logger, [appContext](const mloader::GameInfo& gameInfo, const std::string& serial, const AppStatus appStatus)
+	{
+		OnDeviceInstallStatusChanged(appContext, gameInfo, serial, appStatus);
+	});
+	appContext->CacheManager = new mloader::CacheManager(cacheDir, *appContext->Logger, [appContext]()
+	{
+		return appContext->VrpManager->GetActiveArchiveDirectories();
+	});
+
+	appContext->StatusCoalescer = new mloader::StatusCoalescer([appContext](const std::vector<int>& indices)
+	{
+		OnAppStatusBatchReady(appContext, indices);
+	}, std::chrono::milliseconds(DEFAULT_STATUS_BATCH_INTERVAL_MS));
+	appContext->ThreadPool = new mloader::ThreadPool(ASYNC_THREADS);
+	appContext->Adb->SetThreadPool(appContext->ThreadPool);
+	appContext->StatsDumper = new mloader::StatsDumper(cacheDir / "mloader-stats.prom", [appContext]()
+	{
+		MLoaderStats stats;
+		MLoaderGetStats(appContext, &stats);
+		return stats;
+	});
+
+	appContext->QueueManager->SetTracer(appContext->Tracer);
+
+	const std::chrono::duration<double> startupTime = std::chrono::steady_clock::now() - startupBegin;
+	const std::string message = "Initialized in " + FormatSeconds(startupTime.count());
+	appContext->Logger->LogInfo("Initialization", message);
+	GenericCallback(callback, message.c_str());
+
+	if (revalidateMetadata)
+	{
+		// the cached game list is searchable long before the new metadata is downloaded and extracted. Both run on one task,
+		// so the index of the cached list can't replace the one published with the new metadata
+		appContext->ThreadPool->Submit([appContext]()
+		{
+			appContext->VrpManager->RebuildSearchIndex();
+			RevalidateMetadata(appContext);
+		});
+	}
+
+	return appContext;
+}
+
+AppContext* CreateCatalogContext(std::shared_ptr<const mloader::GameCatalog> catalog)
+{
+	AppContext* appContext = new AppContext();
+	appContext->EventBus = new mloader::EventBus();
+	appContext->AppCatalog = std::move(catalog);
+	appContext->StatusCoalescer = new mloader::StatusCoalescer([appContext](const std::vector<int>& indices)
+	{
+		OnAppStatusBatchReady(appContext, indices);
+	}, std::chrono::milliseconds(DEFAULT_STATUS_BATCH_INTERVAL_MS));
 	return appContext;
 }
 
@@ -320,31 +711,62 @@ void CreateLoaderContextAsync(CreateLoaderContextAsyncCompletedCallback complete
 	}).detach();
 }
 
+void MLoaderCreateLoaderContextWithOptionsAsync(CreateLoaderContextAsyncCompletedCallback completedCallback, CreateLoaderContextStatusCallback callback, const LoaderContextOptions* options)
+{
+	const std::string cacheDir = options->CacheDir != NULL ? options->CacheDir : "";
+	const std::string downloadDir = options->DownloadDir != NULL ? options->DownloadDir : "";
+	const bool warmStart = options->WarmStart;
+
+	std::thread([=]() {
+		LoaderContextOptions threadOptions{ cacheDir.c_str(), downloadDir.c_str(), warmStart };
+		completedCallback(MLoaderCreateLoaderContextWithOptions(&threadOptions, callback));
+	}).detach();
+}
+
 void DestroyLoaderContext(AppContext* context)
 {
-	if (context->AppList)
+	if (context->Adb)
 	{
-		const size_t numApps = context->VrpManager->GetGameList().size();
-		for (int i = 0; i < numApps; ++i)
-		{
-			// cleanup individual strings
-			free((char*)context->AppList[i]->GameName);
-			free((char*)context->AppList[i]->ReleaseName);
-			free((char*)context->AppList[i]->PackageName);
-			free((char*)context->AppList[i]->LastUpdated);
-			free((char*)context->AppList[i]->StatusCStr);
-			free((char*)context->AppList[i]->Note);
+		context->Adb->SetThreadPool(nullptr);
+	}
+	delete context->ThreadPool;		// finishes pending asynchronous calls while everything they use is still alive
+	context->ThreadPool = nullptr;
+
+	if (context->QueueManager)
+	{
+		context->QueueManager->Stop();		// no download or install may report a status change once the app list goes away
+	}
 
-			context->AppList[i]->GameName		= NULL;
-			context->AppList[i]->ReleaseName	= NULL;
-			context->AppList[i]->PackageName	= NULL;
-			context->AppList[i]->LastUpdated	= NULL;
-			context->AppList[i]->StatusCStr		= NULL;
-			context->AppList[i]->Note			= NULL;
+	context->AppsStatusBatchChangedHandler			= nullptr;
+	context->AppsStatusBatchChangedHandlerUserData	= nullptr;
+	delete context->StatusCoalescer;	// stops batch delivery before the app list goes away
+	context->StatusCoalescer = nullptr;
 
-			delete context->AppList[i];
+	{
+		std::lock_guard<std::mutex> lock(context->AppListMutex);
+		if (context->AppList)
+		{
+			for (int i = 0; i < context->NumApps; ++i)
+			{
+				if (context->AppList[i] != nullptr)
+				{
+					FreeApp(context->AppList[i]);
+				}
+			}
+			delete[] context->AppList;
+			context->AppList = nullptr;
+			context->NumApps = 0;
 		}
-		delete[] context->AppList;
+	}
+
+	for (VrpApp* app : context->RetiredApps)
+	{
+		FreeApp(app);
+	}
+
+	for (char* retiredString : context->RetiredStrings)
+	{
+		free(retiredString);
 	}
 
 	if (context->AdbDeviceList)
@@ -356,18 +778,10 @@ void DestroyLoaderContext(AppContext* context)
 	context->AdbDeviceListChangedCallback		= nullptr;
 	context->AppsStatusChangedCallback			= nullptr;
 	context->AppsStatusChangedCallbackUserData	= nullptr;
+	context->AppDeviceStatusChangedHandler			= nullptr;
+	context->AppDeviceStatusChangedHandlerUserData		= nullptr;
 
-	if (context != nullptr)
-	{
-		delete context->QueueManager;
-		delete context->VrpManager;
-		delete context->Adb;
-		delete context->Zip7;
-		delete context->Rclone;
-		delete context->Logger;
-		delete context;
-		context = nullptr;
-	}
+	DeleteContext(context);
 	mloader::CleanupGlobalCurl();
 }
 
@@ -381,6 +795,10 @@ bool RefreshMetadata(AppContext* context)
 		return false;
 	}
 
+	if (ApplyCatalog(context))
+	{
+		context->EventBus->Publish(MLoaderEvent { MLoaderEventAppListChanged, nullptr, AppStatus::NoInfo, -1, "" });
+	}
 	return true;
 }
 
@@ -403,93 +821,384 @@ void RefreshMetadataAsync(RefreshMetadataAsyncCompletedCallback completedCallbac
 
 VrpApp** GetAppList(AppContext* context, int* num)
 {
-	if (context->AppList == nullptr)	// lazy load
+	std::lock_guard<std::mutex> lock(context->AppListMutex);
+	EnsureAppList(context);
+	for (int i = 0; i < context->NumApps; ++i)
 	{
-		const std::map<mloader::GameInfo, AppStatus>& gameInfo = context->VrpManager->GetGameList();
-		*num = gameInfo.size();
-		context->AppList = new VrpApp*[*num];
-		int i = 0;
-		for (const auto& pair : gameInfo)
-		{
-			context->AppList[i] = new VrpApp();
-			context->AppList[i]->GameName 		= strdup(pair.first.GameName.c_str());
-			context->AppList[i]->ReleaseName 	= strdup(pair.first.ReleaseName.c_str());
-			context->AppList[i]->PackageName 	= strdup(pair.first.PackageName.c_str());
-			context->AppList[i]->VersionCode 	= pair.first.VersionCode;
-			context->AppList[i]->LastUpdated 	= strdup(pair.first.LastUpdated.c_str());
-			context->AppList[i]->SizeMB 		= pair.first.SizeMB;
-			context->AppList[i]->Downloads 		= pair.first.Downloads;
-			context->AppList[i]->Rating 		= pair.first.Rating;
-			context->AppList[i]->RatingCount 	= pair.first.RatingCount;
-			context->AppList[i]->Status 		= pair.second;
-			context->AppList[i]->AppStatusParam = -1;									// When downloading or extracting, progress is reported with this param, otherwise it defaults to -1
-			context->AppList[i]->StatusCStr 	= GetUpdateStatusString(context->AppList[i]->Status);
-			context->AppList[i]->Note			= strdup(context->VrpManager->GetAppNote(pair.first).c_str());
-			++i;
-		}
+		MaterializeApp(context, i);
 	}
 
+	*num = context->NumApps;
 	return context->AppList;
 }
 
-int DownloadApp(AppContext* context, VrpApp* app)
+void MLoaderInitAppQuery(AppQuery* query)
+{
+	*query = AppQuery{};
+}
+
+AppQueryResult* MLoaderQueryApps(AppContext* context, const AppQuery* query)
 {
-	const std::map<mloader::GameInfo, AppStatus>& gameInfo = context->VrpManager->GetGameList();
+	const AppQuery everything{};
+	if (query == NULL)
+	{
+		query = &everything;
+	}
 
-	auto it = std::find_if(gameInfo.cbegin(), gameInfo.cend(), [app](const auto& pair)
+	for (int i = 0; i < std::min(query->NumSortKeys, APP_QUERY_MAX_SORT_KEYS); ++i)
 	{
-		return pair.first.ReleaseName == app->ReleaseName;
-	});
+		if (!mloader::CatalogQuery::IsValidSortKey(query->SortOrder[i].Key))
+		{
+			err_msg = "Invalid sort key";
+			return NULL;
+		}
+	}
 
-	if (it == gameInfo.end())
+	std::shared_ptr<const mloader::CatalogQuery> catalogQuery;
+	std::shared_ptr<const mloader::GameCatalog> catalog;
 	{
-		return false;
+		std::lock_guard<std::mutex> lock(context->AppListMutex);
+		EnsureAppList(context);
+		if (context->AppQuery == nullptr)
+		{
+			context->AppQuery = std::make_shared<const mloader::CatalogQuery>(context->AppCatalog);
+		}
+		catalogQuery = context->AppQuery;
+		catalog = context->AppCatalog;
 	}
 
-	context->QueueManager->QueueDownload(&it->first);
-	return true;
+	return new AppQueryResult{ context, catalog, catalogQuery->Run(*query) };
 }
 
-int MLoaderInstallApp(AppContext* context, VrpApp* app, AdbDevice* device)
+int MLoaderGetQueryResultCount(AppQueryResult* result)
 {
-	const std::map<mloader::GameInfo, AppStatus>& gameInfo = context->VrpManager->GetGameList();
+	return static_cast<int>(result->Indices.size());
+}
 
-	auto it = std::find_if(gameInfo.cbegin(), gameInfo.cend(), [app](const auto& pair)
+int MLoaderGetQueryResultPage(AppQueryResult* result, int offset, int limit, VrpApp** apps)
+{
+	const int count = static_cast<int>(result->Indices.size());
+	if (offset < 0 || offset >= count || limit <= 0)
 	{
-		return pair.first.ReleaseName == app->ReleaseName;
-	});
+		return 0;
+	}
 
-	if (it == gameInfo.end())
+	const int end = std::min(count, offset + limit);
+	int written = 0;
+	AppContext* context = result->Context;
+	std::lock_guard<std::mutex> lock(context->AppListMutex);
+	for (int i = offset; i < end; ++i)
+	{
+		std::optional<size_t> index = result->Indices[i];
+		if (result->Catalog != context->AppCatalog)
+		{
+			index = context->AppCatalog->IndexOf(result->Catalog->GetGame(result->Indices[i]));		// new metadata was applied since the query ran
+		}
+
+		if (index)
+		{
+			apps[written++] = MaterializeApp(context, static_cast<int>(*index));
+		}
+	}
+
+	return written;
+}
+
+AppQueryResult* MLoaderSearchApps(AppContext* context, const char* text, int maxResults)
+{
+	std::shared_ptr<const mloader::SearchIndex> searchIndex = context->VrpManager->GetSearchIndex();
+	const std::vector<mloader::SearchIndex::Hit> hits = searchIndex->Search(text != NULL ? text : "", maxResults > 0 ? maxResults : 0);
+
+	std::lock_guard<std::mutex> lock(context->AppListMutex);
+	EnsureAppList(context);
+
+	AppQueryResult* result = new AppQueryResult{ context, context->AppCatalog, {} };
+	result->Indices.reserve(hits.size());
+
+	for (const mloader::SearchIndex::Hit& hit : hits)
+	{
+		// the index may belong to a newer catalog than the app list
+		std::optional<size_t> index = context->AppCatalog->IndexOf(searchIndex->GetCatalog()->GetGame(hit.Index));
+		if (index)
+		{
+			result->Indices.push_back(static_cast<uint32_t>(*index));
+		}
+	}
+
+	return result;
+}
+
+void MLoaderFreeQueryResult(AppQueryResult* result)
+{
+	delete result;
+}
+
+int DownloadApp(AppContext* context, VrpApp* app)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
+
+	if (game == nullptr)
+	{
+		return false;
+	}
+
+	context->QueueManager->QueueDownload(game);
+	return true;
+}
+
+int MLoaderInstallApp(AppContext* context, VrpApp* app, AdbDevice* device)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
+
+	if (game == nullptr)
 	{
 		return false;
 	}
 
-	if (device->DeviceStatus != AdbDeviceStatus::OK)
+	if (device == NULL || device->DeviceStatus != AdbDeviceStatus::OK)
 	{
 		err_msg = "Device not authorized";
 		return false;
 	}
 
-	context->QueueManager->QueueInstall(&it->first);
+	context->QueueManager->QueueInstall(game, { device->DeviceId });
 
 	return true;
 }
 
-void MLoaderDeleteApp(AppContext* context, VrpApp* app)
+int MLoaderInstallAppToDevices(AppContext* context, VrpApp* app, AdbDevice** devices, int num)
 {
-	const std::map<mloader::GameInfo, AppStatus>& gameInfo = context->VrpManager->GetGameList();
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
 
-	auto it = std::find_if(gameInfo.cbegin(), gameInfo.cend(), [app](const auto& pair)
+	if (game == nullptr || devices == NULL || num <= 0)
 	{
-		return pair.first.ReleaseName == app->ReleaseName;
-	});
+		return false;
+	}
+
+	std::vector<std::string> serials;
+	for (int i = 0; i < num; ++i)
+	{
+		if (devices[i] == NULL || devices[i]->DeviceStatus != AdbDeviceStatus::OK)
+		{
+			err_msg = "Device not authorized";
+			return false;
+		}
+		serials.push_back(devices[i]->DeviceId);
+	}
+
+	if (context->VrpManager->GameInstalled(*game))
+	{
+		context->QueueManager->QueueInstall(game, serials);
+	}
+	else
+	{
+		// not downloaded yet, download the archive once and stream it to every device
+		context->QueueManager->QueueDirectInstall(game, serials);
+	}
+
+	return true;
+}
+
+AppStatus MLoaderGetAppDeviceStatus(AppContext* context, VrpApp* app, AdbDevice* device)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
+
+	if (game == nullptr || device == NULL)
+	{
+		return AppStatus::NoInfo;
+	}
+
+	return context->QueueManager->GetDeviceInstallStatus(*game, device->DeviceId);
+}
+
+bool MLoaderGetAppDeviceProgress(AppContext* context, VrpApp* app, AdbDevice* device, AppInstallProgress* progress)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
+
+	if (game == nullptr || device == NULL || progress == NULL)
+	{
+		return false;
+	}
+
+	const mloader::DeviceInstallProgress deviceProgress = context->QueueManager->GetDeviceInstallProgress(*game, device->DeviceId);
+	progress->Status				= deviceProgress.Status;
+	progress->Progress				= deviceProgress.Status == AppStatus::Installing && deviceProgress.BytesTotal > 0 ? static_cast<int>(deviceProgress.BytesWritten * 100 / deviceProgress.BytesTotal) : -1;
+	progress->BytesWritten			= deviceProgress.BytesWritten;
+	progress->BytesTotal			= deviceProgress.BytesTotal;
+	progress->MegabytesPerSecond	= deviceProgress.BytesPerSecond / (1024.0 * 1024.0);
+	return true;
+}
+
+int MLoaderGetTraceSummary(AppContext* context, TraceStageSummary* summaries, int capacity)
+{
+	const auto summary = context->Tracer->GetSummary();
+	const int stageCount = static_cast<int>(summary.size());
+
+	if (summaries == NULL)
+	{
+		return stageCount;
+	}
+
+	const int count = std::min(stageCount, capacity);
+	for (int i = 0; i < count; ++i)
+	{
+		const mloader::Tracer::StageSummary& stage = summary[i];
+		summaries[i].Stage				= mloader::GetTraceStageName(static_cast<mloader::TraceStage>(i));
+		summaries[i].Count				= stage.Count;
+		summaries[i].Bytes				= stage.Bytes;
+		summaries[i].TotalSeconds		= stage.TotalSeconds;
+		summaries[i].MaxSeconds			= stage.MaxSeconds;
+		summaries[i].MegabytesPerSecond	= stage.TotalSeconds > 0.0 ? (stage.Bytes / (1024.0 * 1024.0)) / stage.TotalSeconds : 0.0;
+	}
+
+	return count;
+}
+
+bool MLoaderExportTrace(AppContext* context, const char* file)
+{
+	if (file == NULL)
+	{
+		err_msg = "No trace file specified";
+		return false;
+	}
+
+	if (!context->Tracer->ExportChromeTrace(file))
+	{
+		err_msg = "Unable to write trace file";
+		return false;
+	}
+
+	return true;
+}
+
+void MLoaderSetLogLevel(AppContext* context, MLoaderLogLevel level)
+{
+	context->Logger->SetLevel(static_cast<mloader::LogLevel>(level));
+}
+
+void MLoaderSetLogFormat(AppContext* context, MLoaderLogFormat format)
+{
+	context->Logger->SetFormat(static_cast<mloader::LogFormat>(format));
+}
+
+void MLoaderSetLogSampling(AppContext* context, const char* event, int keepOneIn)
+{
+	if (event == NULL)
+	{
+		return;
+	}
+
+	context->Logger->SetSampling(event, static_cast<unsigned int>(std::max(keepOneIn, 1)));
+}
+
+void MLoaderSetLogRotation(AppContext* context, unsigned long long maxBytes, int maxFiles)
+{
+	context->Logger->SetRotation(maxBytes, static_cast<unsigned int>(std::max(maxFiles, 0)));
+}
+
+bool MLoaderGetStats(AppContext* context, MLoaderStats* stats)
+{
+	if (stats == NULL)
+	{
+		err_msg = "No stats specified";
+		return false;
+	}
+
+	constexpr size_t transfer	= static_cast<size_t>(mloader::TraceStage::Transfer);
+	constexpr size_t extract	= static_cast<size_t>(mloader::TraceStage::Extract);
+	constexpr size_t install	= static_cast<size_t>(mloader::TraceStage::Install);
+	constexpr size_t hash		= static_cast<size_t>(mloader::TraceStage::Hash);
+
+	const auto summary		= context->Tracer->GetSummary();
+	const auto active		= context->Tracer->GetActiveSpans();
+	const auto throughput	= context->Tracer->GetRecentThroughput(std::chrono::seconds(STATS_THROUGHPUT_WINDOW_SECONDS));
+	const mloader::QueueStats queueStats = context->QueueManager->GetQueueStats();
+
+	const auto averageRate = [](const mloader::Tracer::StageSummary& stage)
+	{
+		return stage.TotalSeconds > 0.0 ? stage.Bytes / stage.TotalSeconds : 0.0;
+	};
+
+	*stats = MLoaderStats {};
+	stats->UptimeSeconds					= std::chrono::duration<double>(std::chrono::steady_clock::now() - context->CreationTime).count();
+	stats->QueuedDownloads					= static_cast<unsigned int>(queueStats.QueuedDownloads);
+	stats->QueuedInstalls					= static_cast<unsigned int>(queueStats.QueuedInstalls);
+	stats->ActiveDownloads					= active[transfer];
+	stats->ActiveExtractions				= active[extract];
+	stats->ActiveInstalls					= active[install];
+	stats->ActiveHashes						= active[hash];
+	stats->BytesDownloaded					= summary[transfer].Bytes;
+	stats->BytesExtracted					= summary[extract].Bytes;
+	stats->BytesPushed						= summary[install].Bytes;
+	stats->DownloadsFinished				= summary[transfer].Count;
+	stats->ExtractionsFinished				= summary[extract].Count;
+	stats->InstallsFinished					= summary[install].Count;
+	stats->DownloadBytesPerSecond			= throughput[transfer];
+	stats->AverageDownloadBytesPerSecond	= averageRate(summary[transfer]);
+	stats->ExtractBytesPerSecond			= throughput[extract];
+	stats->AverageExtractBytesPerSecond		= averageRate(summary[extract]);
+	stats->PushBytesPerSecond				= queueStats.InstallBytesPerSecond;
+	stats->AveragePushBytesPerSecond		= averageRate(summary[install]);
+	stats->SubprocessesSpawned				= mloader::GetSpawnedProcessCount();
+	stats->LogRecordsDropped				= context->Logger->GetDroppedRecordCount();
+
+	const std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const std::shared_ptr<const mloader::SearchIndex> searchIndex = context->VrpManager->GetSearchIndex();
+	if (catalog)
+	{
+		stats->CatalogGames			= static_cast<unsigned int>(catalog->GetSize());
+		stats->CatalogMemoryBytes	= catalog->GetMemoryUsage();
+	}
+	if (searchIndex)
+	{
+		stats->CatalogMemoryBytes	+= searchIndex->GetMemoryUsage();
+	}
+
+	return true;
+}
+
+void MLoaderSetStatsDumpInterval(AppContext* context, int seconds)
+{
+	context->StatsDumper->SetInterval(std::chrono::seconds(std::max(seconds, 0)));
+}
+
+int MLoaderDownloadAndInstallApp(AppContext* context, VrpApp* app, AdbDevice* device)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
+
+	if (game == nullptr)
+	{
+		return false;
+	}
+
+	if (device == NULL || device->DeviceStatus != AdbDeviceStatus::OK)
+	{
+		err_msg = "Device not authorized";
+		return false;
+	}
+
+	context->QueueManager->QueueDirectInstall(game, { device->DeviceId });
+
+	return true;
+}
+
+void MLoaderDeleteApp(AppContext* context, VrpApp* app)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
 
-	if (it == gameInfo.end())
+	if (game == nullptr)
 	{
 		return;
 	}
 
-	context->VrpManager->DeleteGame(it->first);
+	context->VrpManager->DeleteGame(*game);
 }
 
 AdbDevice** GetDeviceList(AppContext* context, int* num)
@@ -516,9 +1225,207 @@ char* MLoaderGetDeviceProperty(AppContext* context, AdbDevice* device, const cha
 	return strdup(propValue.c_str());
 }
 
+void MLoaderRefreshDeviceProperties(AppContext* context, AdbDevice* device)
+{
+	if (device == NULL)
+	{
+		return;
+	}
+
+	context->Adb->RefreshDeviceProperties(*device);
+}
+
 void MLoaderSetSelectedAdbDevice(AppContext* context, AdbDevice* device)
 {
-	context->QueueManager->SetSelectedAdbDevice(device);
+	context->QueueManager->SetSelectedAdbDevice(device != NULL ? device->DeviceId : "");
+}
+
+static void ReleaseOperation(MLoaderOperation* operation)
+{
+	if (operation->References.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		delete operation;
+	}
+}
+
+// Runs work on the library thread pool. The operation fails when work returns nothing or throws
+static MLoaderOperation* StartOperation(AppContext* context, MLoaderOperationCompletedCallback callback, void* userData, std::function<std::optional<std::string>()> work)
+{
+	MLoaderOperation* operation = new MLoaderOperation();
+	operation->Callback = callback;
+	operation->UserData = userData;
+
+	context->ThreadPool->Submit([operation, work = std::move(work)]()
+	{
+		std::optional<std::string> result;
+		try
+		{
+			result = work();
+		}
+		catch (const std::exception&)
+		{
+			result = std::nullopt;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(operation->Mutex);
+			operation->Done = true;
+			operation->Succeeded = result.has_value();
+			operation->Result = result.value_or("");
+		}
+		operation->CompletedCondition.notify_all();
+
+		if (operation->Callback)
+		{
+			operation->Callback(operation, operation->UserData);
+		}
+		ReleaseOperation(operation);
+	});
+
+	return operation;
+}
+
+MLoaderOperation* MLoaderGetDevicePropertyAsync(AppContext* context, AdbDevice* device, const char* propertyName, MLoaderOperationCompletedCallback callback, void* userData)
+{
+	// the device list may be rebuilt before the call runs, so nothing is read through the pointers later
+	const std::string serial = device != NULL ? device->DeviceId : "";
+	const std::string property = propertyName;
+	return StartOperation(context, callback, userData, [context, serial, property]() -> std::optional<std::string>
+	{
+		if (serial.empty())
+		{
+			return std::string();
+		}
+
+		const AdbDevice device { serial.c_str(), "", AdbDeviceStatus::OK };
+		return context->Adb->GetDeviceProperty(device, property);
+	});
+}
+
+MLoaderOperation* MLoaderSetSelectedAdbDeviceAsync(AppContext* context, AdbDevice* device, MLoaderOperationCompletedCallback callback, void* userData)
+{
+	const std::string serial = device != NULL ? device->DeviceId : "";
+	return StartOperation(context, callback, userData, [context, serial]() -> std::optional<std::string>
+	{
+		context->QueueManager->SetSelectedAdbDevice(serial);
+		return std::string();
+	});
+}
+
+MLoaderOperation* MLoaderDeleteAppAsync(AppContext* context, VrpApp* app, MLoaderOperationCompletedCallback callback, void* userData)
+{
+	const std::string releaseName = app->ReleaseName;
+	return StartOperation(context, callback, userData, [context, releaseName]() -> std::optional<std::string>
+	{
+		std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+		const mloader::GameInfo* game = catalog->Find(releaseName);
+		if (game == nullptr)
+		{
+			return std::nullopt;
+		}
+
+		context->VrpManager->DeleteGame(*game);
+		return std::string();
+	});
+}
+
+MLoaderOperation* MLoaderGetAppThumbImageAsync(AppContext* context, VrpApp* app, MLoaderOperationCompletedCallback callback, void* userData)
+{
+	const std::string releaseName = app->ReleaseName;
+	return StartOperation(context, callback, userData, [context, releaseName]() -> std::optional<std::string>
+	{
+		std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+		const mloader::GameInfo* game = catalog->Find(releaseName);
+		if (game == nullptr)
+		{
+			return std::nullopt;
+		}
+
+		const std::string path = context->VrpManager->GetAppThumbImage(*game);
+		return path.empty() ? std::nullopt : std::optional<std::string>(path);
+	});
+}
+
+bool MLoaderIsOperationDone(MLoaderOperation* operation)
+{
+	std::lock_guard<std::mutex> lock(operation->Mutex);
+	return operation->Done;
+}
+
+bool MLoaderWaitOperation(MLoaderOperation* operation, int timeoutMs)
+{
+	std::unique_lock<std::mutex> lock(operation->Mutex);
+	if (timeoutMs < 0)
+	{
+		operation->CompletedCondition.wait(lock, [operation]() { return operation->Done; });
+		return true;
+	}
+
+	return operation->CompletedCondition.wait_for(lock, std::chrono::milliseconds(timeoutMs), [operation]() { return operation->Done; });
+}
+
+bool MLoaderOperationSucceeded(MLoaderOperation* operation)
+{
+	std::lock_guard<std::mutex> lock(operation->Mutex);
+	return operation->Done && operation->Succeeded;
+}
+
+const char* MLoaderGetOperationResult(MLoaderOperation* operation)
+{
+	std::lock_guard<std::mutex> lock(operation->Mutex);
+	return operation->Done && operation->Succeeded ? operation->Result.c_str() : NULL;
+}
+
+void MLoaderReleaseOperation(MLoaderOperation* operation)
+{
+	if (operation != NULL)
+	{
+		ReleaseOperation(operation);
+	}
+}
+
+MLoaderEventSubscription* MLoaderSubscribeEvents(AppContext* context, unsigned int eventMask, int capacity)
+{
+	try
+	{
+		return new MLoaderEventSubscription{ context->EventBus->Subscribe(eventMask, capacity > 0 ? capacity : DEFAULT_EVENT_QUEUE_CAPACITY) };
+	}
+	catch(std::runtime_error& error)
+	{
+		err_msg = error.what();
+		return NULL;
+	}
+}
+
+int MLoaderGetEventFd(MLoaderEventSubscription* subscription)
+{
+	return subscription->Subscription->GetFd();
+}
+
+int MLoaderDrainEvents(MLoaderEventSubscription* subscription, MLoaderEvent* events, int maxEvents)
+{
+	if (events == NULL || maxEvents <= 0)
+	{
+		return 0;
+	}
+
+	return static_cast<int>(subscription->Subscription->Drain(events, maxEvents));
+}
+
+unsigned long long MLoaderGetDroppedEventCount(MLoaderEventSubscription* subscription)
+{
+	return subscription->Subscription->GetDroppedCount();
+}
+
+void MLoaderUnsubscribeEvents(AppContext* context, MLoaderEventSubscription* subscription)
+{
+	if (subscription == NULL)
+	{
+		return;
+	}
+
+	context->EventBus->Unsubscribe(subscription->Subscription.get());
+	delete subscription;
 }
 
 void SetADBDeviceListChangedCallback(AppContext* context, ADBDeviceListChangedCallback callback, void* userData)
@@ -533,6 +1440,18 @@ void ClearADBDeviceListChangedCallback(AppContext* context)
 	context->AdbDeviceListChangedCallbackUserData = nullptr;
 }
 
+void MLoaderSetAppDeviceStatusChangedCallback(AppContext* context, AppDeviceStatusChangedCallback callback, void* userData)
+{
+	context->AppDeviceStatusChangedHandler = callback;
+	context->AppDeviceStatusChangedHandlerUserData = userData;
+}
+
+void MLoaderClearAppDeviceStatusChangedCallback(AppContext* context)
+{
+	context->AppDeviceStatusChangedHandler = nullptr;
+	context->AppDeviceStatusChangedHandlerUserData = nullptr;
+}
+
 void SetAppStatusChangedCallback(AppContext* context, AppStatusChangedCallback callback, void* userData)
 {
 	context->AppsStatusChangedCallback = callback;
@@ -545,21 +1464,30 @@ void ClearAppStatusChangedCallback(AppContext* context)
 	context->AppsStatusChangedCallbackUserData = nullptr;
 }
 
-char* GetAppThumbImage(AppContext* context, VrpApp* app)
+void MLoaderSetAppStatusBatchChangedCallback(AppContext* context, AppStatusBatchChangedCallback callback, int intervalMs, void* userData)
 {
-	const std::map<mloader::GameInfo, AppStatus>& gameInfo = context->VrpManager->GetGameList();
+	context->StatusCoalescer->SetInterval(std::chrono::milliseconds(intervalMs > 0 ? intervalMs : DEFAULT_STATUS_BATCH_INTERVAL_MS));
+	context->AppsStatusBatchChangedHandlerUserData = userData;
+	context->AppsStatusBatchChangedHandler = callback;
+}
 
-	auto it = std::find_if(gameInfo.cbegin(), gameInfo.cend(), [app](const auto& pair)
-	{
-		return pair.first.ReleaseName == app->ReleaseName;
-	});
+void MLoaderClearAppStatusBatchChangedCallback(AppContext* context)
+{
+	context->AppsStatusBatchChangedHandler = nullptr;
+	context->AppsStatusBatchChangedHandlerUserData = nullptr;
+}
 
-	if (it == gameInfo.end())
+char* GetAppThumbImage(AppContext* context, VrpApp* app)
+{
+	std::shared_ptr<const mloader::GameCatalog> catalog = context->VrpManager->GetCatalog();
+	const mloader::GameInfo* game = catalog->Find(app->ReleaseName);
+
+	if (game == nullptr)
 	{
 		return NULL;
 	}
 
-	const std::string path = context->VrpManager->GetAppThumbImage(it->first);
+	const std::string path = context->VrpManager->GetAppThumbImage(*game);
 	if (path.empty())
 	{
 		return NULL;
@@ -568,6 +1496,42 @@ char* GetAppThumbImage(AppContext* context, VrpApp* app)
 	return cpath;
 }
 
+bool MLoaderGetCacheUsage(AppContext* context, CacheUsage* usage)
+{
+	if (usage == NULL)
+	{
+		return false;
+	}
+
+	*usage = context->CacheManager->GetUsage();
+	return true;
+}
+
+void MLoaderSetCacheQuota(AppContext* context, unsigned long long quotaBytes)
+{
+	context->CacheManager->SetQuota(quotaBytes);
+}
+
+void MLoaderCollectCacheGarbage(AppContext* context)
+{
+	context->CacheManager->RequestCollection();
+}
+
+void MLoaderSetCpuBudget(AppContext* context, int threads)
+{
+	context->CpuBudget->SetTotalThreads(threads > 0 ? static_cast<unsigned int>(threads) : 0);
+}
+
+void MLoaderSetExtractionThreads(AppContext* context, int threadsPerJob)
+{
+	context->Zip7->SetThreadsPerJob(threadsPerJob > 0 ? static_cast<unsigned int>(threadsPerJob) : 0);
+}
+
+void MLoaderSetExtractionLowPriority(AppContext* context, bool lowPriority)
+{
+	context->Zip7->SetLowPriority(lowPriority);
+}
+
 char* MLoaderGetLibraryVersion()
 {
 	constexpr const int version_size = 10;
@@ -0,0 +1,128 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace mloader
+{
+	// Lock-free bounded queue for many producers and consumers (Dmitry Vyukov's design).
+	// Every cell carries a sequence number telling producers and consumers whose turn it is, so neither side ever waits on the other
+	template<typename T>
+	class BoundedQueue
+	{
+		public:
+			BoundedQueue(size_t capacity)		// rounded up to a power of two
+			{
+				size_t size = 2;
+				while (size < capacity)
+				{
+					size <<= 1;
+				}
+
+				m_mask = size - 1;
+				m_cells = std::make_unique<Cell[]>(size);
+				for (size_t i = 0; i < size; ++i)
+				{
+					m_cells[i].Sequence.store(i, std::memory_order_relaxed);
+				}
+			}
+
+			BoundedQueue(const BoundedQueue&) = delete;
+			BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+			bool TryPush(const T& value)		// false when the queue is full
+			{
+				size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+				while (true)
+				{
+					Cell& cell = m_cells[position & m_mask];
+					const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+					const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+					if (difference == 0)
+					{
+						if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							cell.Value = value;
+							cell.Sequence.store(position + 1, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (difference < 0)
+					{
+						return false;
+					}
+					else
+					{
+						position = m_enqueuePosition.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			bool TryPop(T& value)		// false when the queue is empty
+			{
+				size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+				while (true)
+				{
+					Cell& cell = m_cells[position & m_mask];
+					const size_t sequence = cell.Sequence.load(std::memory_order_acquire);
+					const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+					if (difference == 0)
+					{
+						if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+						{
+							value = cell.Value;
+							cell.Sequence.store(position + m_mask + 1, std::memory_order_release);
+							return true;
+						}
+					}
+					else if (difference < 0)
+					{
+						return false;
+					}
+					else
+					{
+						position = m_dequeuePosition.load(std::memory_order_relaxed);
+					}
+				}
+			}
+
+			bool HasItems() const
+			{
+				const size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+				return m_cells[position & m_mask].Sequence.load(std::memory_order_acquire) == position + 1;
+			}
+
+		private:
+			struct Cell
+			{
+				std::atomic<size_t> Sequence;
+				T Value;
+			};
+
+			std::unique_ptr<Cell[]> m_cells;
+			size_t m_mask;
+
+			alignas(64) std::atomic<size_t> m_enqueuePosition { 0 };
+			alignas(64) std::atomic<size_t> m_dequeuePosition { 0 };
+	};
+}
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,281 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "CacheManager.h"
+#include "Logger.h"
+#include "Utility.h"
+#include <algorithm>
+#include <cctype>
+#include <system_error>
+
+namespace mloader
+{
+	CacheManager::CacheManager(const fs::path& cacheDir, Logger& logger, std::function<std::vector<fs::path>()> pinnedPathsCallback)
+		:	m_cacheDir(cacheDir),
+			m_pinnedPathsCallback(pinnedPathsCallback),
+			m_logger(logger)
+	{
+		m_backgroundThread = std::thread(&CacheManager::BackgroundCollectionService, this);
+	}
+
+	CacheManager::~CacheManager()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_serviceMutex);
+			m_running = false;
+		}
+		m_serviceCondition.notify_all();
+
+		if (m_backgroundThread.joinable())
+		{
+			m_backgroundThread.join();
+		}
+	}
+
+	void CacheManager::SetQuota(uint64_t quotaBytes)
+	{
+		m_quotaBytes = quotaBytes;
+		RequestCollection();
+	}
+
+	CacheUsage CacheManager::GetUsage() const
+	{
+		std::lock_guard<std::mutex> lock(m_usageMutex);
+		CacheUsage usage = m_usage;
+		usage.QuotaBytes = m_quotaBytes;
+		return usage;
+	}
+
+	void CacheManager::RequestCollection()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_serviceMutex);
+			m_collectionRequested = true;
+		}
+		m_serviceCondition.notify_all();
+	}
+
+	CacheCategory CacheManager::DetermineCategory(const fs::directory_entry& entry)
+	{
+		const std::string name = entry.path().filename().string();
+
+		if (entry.is_directory())
+		{
+			if (name == "platform-tools" || name == "7z" || name.starts_with("rclone-"))
+			{
+				return CacheCategory::Tools;
+			}
+
+			if (name == "metadata")
+			{
+				return CacheCategory::Metadata;
+			}
+
+			// game downloads are stored in directories named after the md5 hash of the release name
+			if (name.size() == 32 && std::all_of(name.cbegin(), name.cend(), [](char c) { return std::isxdigit(static_cast<unsigned char>(c)); }))
+			{
+				return CacheCategory::Downloads;
+			}
+
+			return CacheCategory::Other;
+		}
+
+		if (name == "meta.7z")
+		{
+			return CacheCategory::MetadataArchive;
+		}
+
+		if (name == "vrp-public.json")
+		{
+			return CacheCategory::Metadata;
+		}
+
+		if (name.ends_with(".zip") || name.ends_with(".tar.xz"))
+		{
+			return CacheCategory::ToolArchives;
+		}
+
+		if (name.find(".log") != std::string::npos)
+		{
+			return CacheCategory::Logs;
+		}
+
+		return CacheCategory::Other;
+	}
+
+	bool CacheManager::IsEvictable(CacheCategory category)
+	{
+		// tool archives are only needed until the tool is extracted, downloads can always be fetched again.
+		// Everything else is either in use or required for the next startup
+		return category == CacheCategory::ToolArchives || category == CacheCategory::Downloads;
+	}
+
+	std::vector<CacheManager::CacheEntry> CacheManager::ScanCacheDirectory() const
+	{
+		std::vector<CacheEntry> entries;
+		std::error_code ec;
+
+		for (const fs::directory_entry& entry : fs::directory_iterator(m_cacheDir, ec))
+		{
+			CacheEntry cacheEntry{ entry.path(), DetermineCategory(entry), 0, entry.last_write_time(ec) };
+
+			if (entry.is_directory(ec))
+			{
+				for (const fs::directory_entry& file : fs::recursive_directory_iterator(entry.path(), fs::directory_options::skip_permission_denied, ec))
+				{
+					if (file.is_regular_file(ec))
+					{
+						cacheEntry.Size += file.file_size(ec);
+						cacheEntry.LastUsed = std::max(cacheEntry.LastUsed, file.last_write_time(ec));
+					}
+				}
+			}
+			else if (entry.is_regular_file(ec))
+			{
+				cacheEntry.Size = entry.file_size(ec);
+			}
+
+			entries.push_back(std::move(cacheEntry));
+		}
+
+		return entries;
+	}
+
+	void CacheManager::CollectGarbage()
+	{
+		// the snapshot is taken before the scan so that a job started in between is either
+		// part of it or is seen by the check right before its files are removed
+		std::vector<fs::path> pinnedPaths;
+		if (m_pinnedPathsCallback)
+		{
+			pinnedPaths = m_pinnedPathsCallback();
+		}
+
+		std::vector<CacheEntry> entries = ScanCacheDirectory();
+
+		// the quota only limits what can be evicted, tools and metadata would otherwise keep it exceeded for good
+		uint64_t totalBytes = 0;
+		uint64_t evictableBytes = 0;
+		for (const CacheEntry& entry : entries)
+		{
+			totalBytes += entry.Size;
+			if (IsEvictable(entry.Category))
+			{
+				evictableBytes += entry.Size;
+			}
+		}
+
+		const uint64_t quota = m_quotaBytes;
+		if (quota > 0 && evictableBytes > quota)
+		{
+			// least recently used first
+			std::vector<CacheEntry*> candidates;
+			for (CacheEntry& entry : entries)
+			{
+				if (IsEvictable(entry.Category) && std::find(pinnedPaths.cbegin(), pinnedPaths.cend(), entry.Path) == pinnedPaths.cend())
+				{
+					candidates.push_back(&entry);
+				}
+			}
+
+			std::sort(candidates.begin(), candidates.end(), [](const CacheEntry* lhs, const CacheEntry* rhs)
+			{
+				return lhs->LastUsed < rhs->LastUsed;
+			});
+
+			for (CacheEntry* entry : candidates)
+			{
+				if (evictableBytes <= quota)
+				{
+					break;
+				}
+
+				if (m_pinnedPathsCallback)
+				{
+					pinnedPaths = m_pinnedPathsCallback();
+					if (std::find(pinnedPaths.cbegin(), pinnedPaths.cend(), entry->Path) != pinnedPaths.cend())
+					{
+						continue;
+					}
+				}
+
+				std::error_code ec;
+				fs::remove_all(entry->Path, ec);
+				if (ec)
+				{
+					m_logger.LogError(LOG_NAME, "Unable to evict " + entry->Path.string() + ". " + ec.message());
+					continue;
+				}
+
+				m_logger.LogInfo(LOG_NAME, "Evicted " + entry->Path.string() + " (" + std::to_string(entry->Size) + " bytes)");
+				totalBytes -= entry->Size;
+				evictableBytes -= entry->Size;
+				entry->Size = 0;
+			}
+
+			if (evictableBytes > quota)
+			{
+				m_logger.LogWarning(LOG_NAME, "Downloads and tool archives use " + std::to_string(evictableBytes) + " bytes which exceeds the quota of " + std::to_string(quota) + " bytes, but the rest is pinned by running jobs");
+			}
+		}
+
+		CacheUsage usage{};
+		for (const CacheEntry& entry : entries)
+		{
+			switch (entry.Category)
+			{
+				case CacheCategory::ToolArchives:		usage.ToolArchivesBytes += entry.Size;		break;
+				case CacheCategory::Tools:				usage.ToolsBytes += entry.Size;				break;
+				case CacheCategory::MetadataArchive:	usage.MetadataArchiveBytes += entry.Size;	break;
+				case CacheCategory::Metadata:			usage.MetadataBytes += entry.Size;			break;
+				case CacheCategory::Downloads:			usage.DownloadsBytes += entry.Size;			break;
+				case CacheCategory::Logs:				usage.LogsBytes += entry.Size;				break;
+				case CacheCategory::Other:				usage.OtherBytes += entry.Size;				break;
+			}
+		}
+		usage.TotalBytes = totalBytes;
+
+		std::lock_guard<std::mutex> lock(m_usageMutex);
+		m_usage = usage;
+	}
+
+	void CacheManager::BackgroundCollectionService()
+	{
+		SetCurrentThreadBackgroundPriority();
+		m_logger.LogInfo(LOG_NAME, "Started background cache collection service");
+
+		std::unique_lock<std::mutex> lock(m_serviceMutex);
+		while (m_running)
+		{
+			m_serviceCondition.wait_for(lock, COLLECTION_INTERVAL, [this]() { return !m_running || m_collectionRequested; });
+			if (!m_running)
+			{
+				break;
+			}
+
+			m_collectionRequested = false;
+			lock.unlock();
+			try
+			{
+				CollectGarbage();
+			}
+			catch(const fs::filesystem_error& error)
+			{
+				m_logger.LogError(LOG_NAME, "Cache collection failed. " + std::string(error.what()));
+			}
+			lock.lock();
+		}
+	}
+}
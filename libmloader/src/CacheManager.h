@@ -0,0 +1,96 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CACHE_MANAGER_H
+#define CACHE_MANAGER_H
+
+#include <mloader/CacheUsage.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace mloader
+{
+	class Logger;
+
+	enum class CacheCategory
+	{
+		ToolArchives = 0,
+		Tools,
+		MetadataArchive,
+		Metadata,
+		Downloads,
+		Logs,
+		Other
+	};
+
+	// Keeps track of what's stored in the cache directory and evicts least recently used
+	// entries on a background thread once the configured quota is exceeded
+	class CacheManager
+	{
+		public:
+			CacheManager(const fs::path& cacheDir, Logger& logger, std::function<std::vector<fs::path>()> pinnedPathsCallback = nullptr);
+			~CacheManager();
+
+			void SetQuota(uint64_t quotaBytes);
+			CacheUsage GetUsage() const;
+			void RequestCollection();
+
+		private:
+			struct CacheEntry
+			{
+				fs::path Path;
+				CacheCategory Category;
+				uint64_t Size;
+				fs::file_time_type LastUsed;
+			};
+
+			std::vector<CacheEntry> ScanCacheDirectory() const;
+			void CollectGarbage();
+			void BackgroundCollectionService();
+
+			static CacheCategory DetermineCategory(const fs::directory_entry& entry);
+			static bool IsEvictable(CacheCategory category);
+
+		private:
+			fs::path m_cacheDir;
+			std::function<std::vector<fs::path>()> m_pinnedPathsCallback;
+
+			std::atomic<uint64_t> m_quotaBytes{DEFAULT_QUOTA_BYTES};
+			CacheUsage m_usage{};
+			mutable std::mutex m_usageMutex;
+
+			bool m_running = true;
+			bool m_collectionRequested = true;
+			std::mutex m_serviceMutex;
+			std::condition_variable m_serviceCondition;
+			std::thread m_backgroundThread;
+
+			Logger& m_logger;
+			static constexpr uint64_t DEFAULT_QUOTA_BYTES = 8ull * 1024 * 1024 * 1024;
+			static constexpr std::chrono::minutes COLLECTION_INTERVAL{10};
+			static constexpr const char* LOG_NAME = "CacheManager";
+	};
+}
+
+#endif // CACHE_MANAGER_H
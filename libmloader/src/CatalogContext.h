@@ -0,0 +1,30 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CATALOG_CONTEXT_H
+#define CATALOG_CONTEXT_H
+
+#include <mloader/AppContext.h>
+#include "GameCatalog.h"
+#include <memory>
+
+// Context around a fixed catalog, without tools, devices, logger or network. The app list, app queries and the status
+// fan-out work on it, everything else needs a full context. Used by in-process tools such as the benchmarks, free it with DestroyLoaderContext
+AppContext* CreateCatalogContext(std::shared_ptr<const mloader::GameCatalog> catalog);
+
+// Called by the VRP manager whenever a title changes its status
+void OnGameInfoStatusChanged(AppContext* context, const mloader::GameInfo& gameInfo, const AppStatus appStatus, const int statusParam);
+
+#endif // CATALOG_CONTEXT_H
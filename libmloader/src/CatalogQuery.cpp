@@ -0,0 +1,173 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "CatalogQuery.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <numeric>
+
+namespace mloader
+{
+	static std::string toLower(const std::string& str)
+	{
+		std::string result(str);
+		std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::tolower(c); });
+		return result;
+	}
+
+	CatalogQuery::CatalogQuery(std::shared_ptr<const GameCatalog> catalog)
+		:	m_catalog(std::move(catalog))
+	{
+		m_lowerNames.reserve(m_catalog->GetSize());
+		for (size_t i = 0; i < m_catalog->GetSize(); ++i)
+		{
+			m_lowerNames.push_back(toLower(m_catalog->GetGame(i).GameName));
+		}
+
+		for (size_t key = 0; key < NUM_SORT_KEYS; ++key)
+		{
+			BuildOrder(static_cast<AppSortKey>(key));
+		}
+	}
+
+	bool CatalogQuery::IsValidSortKey(int key)
+	{
+		return key >= 0 && key < static_cast<int>(NUM_SORT_KEYS);
+	}
+
+	void CatalogQuery::BuildOrder(AppSortKey key)
+	{
+		const uint32_t size = static_cast<uint32_t>(m_catalog->GetSize());
+		auto less = [this, key](uint32_t lhs, uint32_t rhs)
+		{
+			const GameInfo& a = m_catalog->GetGame(lhs);
+			const GameInfo& b = m_catalog->GetGame(rhs);
+			switch (key)
+			{
+				case AppSortPopularity:		return a.Downloads < b.Downloads;
+				case AppSortSize:			return a.SizeMB < b.SizeMB;
+				case AppSortLastUpdated:	return a.LastUpdated < b.LastUpdated;
+				case AppSortName:			return m_lowerNames[lhs] < m_lowerNames[rhs];
+			}
+			return false;
+		};
+
+		std::vector<uint32_t>& ascending = m_orders[key][0];
+		ascending.resize(size);
+		std::iota(ascending.begin(), ascending.end(), 0);
+		std::stable_sort(ascending.begin(), ascending.end(), less);
+
+		std::vector<uint32_t>& ranks = m_ranks[key];
+		ranks.resize(size);
+		uint32_t rank = 0;
+		for (uint32_t i = 0; i < size; ++i)
+		{
+			if (i > 0 && less(ascending[i - 1], ascending[i]))
+			{
+				++rank;
+			}
+			ranks[ascending[i]] = rank;
+		}
+
+		// descending walks the groups of equal values backwards, keeping the order inside each group
+		std::vector<uint32_t>& descending = m_orders[key][1];
+		descending.reserve(size);
+		uint32_t groupEnd = size;
+		while (groupEnd > 0)
+		{
+			uint32_t groupBegin = groupEnd - 1;
+			while (groupBegin > 0 && ranks[ascending[groupBegin - 1]] == ranks[ascending[groupEnd - 1]])
+			{
+				--groupBegin;
+			}
+			descending.insert(descending.end(), ascending.begin() + groupBegin, ascending.begin() + groupEnd);
+			groupEnd = groupBegin;
+		}
+	}
+
+	bool CatalogQuery::Matches(uint32_t index, const AppQuery& query, const std::string& lowerName) const
+	{
+		if (query.StatusMask != 0 && (query.StatusMask & (1u << m_catalog->GetStatus(index))) == 0)
+		{
+			return false;
+		}
+
+		const GameInfo& game = m_catalog->GetGame(index);
+		if (game.SizeMB < query.MinSizeMB || (query.MaxSizeMB > 0 && game.SizeMB > query.MaxSizeMB) || game.Rating < query.MinRating)
+		{
+			return false;
+		}
+
+		if (query.UpdatedFrom != nullptr && game.LastUpdated.compare(0, strlen(query.UpdatedFrom), query.UpdatedFrom) < 0)
+		{
+			return false;
+		}
+
+		if (query.UpdatedUntil != nullptr && game.LastUpdated.compare(0, strlen(query.UpdatedUntil), query.UpdatedUntil) > 0)
+		{
+			return false;
+		}
+
+		return lowerName.empty() || m_lowerNames[index].find(lowerName) != std::string::npos;
+	}
+
+	std::vector<uint32_t> CatalogQuery::Run(const AppQuery& query) const
+	{
+		const int numSortKeys = std::clamp(query.NumSortKeys, 0, APP_QUERY_MAX_SORT_KEYS);
+		const std::string lowerName = query.NameContains != nullptr ? toLower(query.NameContains) : std::string();
+
+		std::vector<uint32_t> result;
+		if (numSortKeys == 0)
+		{
+			for (uint32_t i = 0; i < m_catalog->GetSize(); ++i)
+			{
+				if (Matches(i, query, lowerName))
+				{
+					result.push_back(i);
+				}
+			}
+			return result;
+		}
+
+		const AppSortOrder& primary = query.SortOrder[0];
+		for (const uint32_t i : m_orders[primary.Key][primary.Descending ? 1 : 0])
+		{
+			if (Matches(i, query, lowerName))
+			{
+				result.push_back(i);
+			}
+		}
+
+		if (numSortKeys > 1)
+		{
+			// already ordered by the primary key, the stable sort only reorders ties
+			std::stable_sort(result.begin(), result.end(), [this, &query, numSortKeys](uint32_t lhs, uint32_t rhs)
+			{
+				for (int k = 0; k < numSortKeys; ++k)
+				{
+					const std::vector<uint32_t>& ranks = m_ranks[query.SortOrder[k].Key];
+					if (ranks[lhs] != ranks[rhs])
+					{
+						return query.SortOrder[k].Descending ? ranks[lhs] > ranks[rhs] : ranks[lhs] < ranks[rhs];
+					}
+				}
+				return false;
+			});
+		}
+
+		return result;
+	}
+}
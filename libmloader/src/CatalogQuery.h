@@ -0,0 +1,54 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CATALOG_QUERY_H
+#define CATALOG_QUERY_H
+
+#include "GameCatalog.h"
+#include <mloader/AppQuery.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mloader
+{
+	// Filters and sorts a catalog snapshot. A sorted permutation of the whole catalog is built once per sort key and direction,
+	// so a query sorted by a single key is a filtered walk over that permutation and additional keys only compare precomputed ranks
+	class CatalogQuery
+	{
+		public:
+			CatalogQuery(std::shared_ptr<const GameCatalog> catalog);
+
+			std::vector<uint32_t> Run(const AppQuery& query) const;		// catalog indices of the matching games, in the requested order
+
+			static bool IsValidSortKey(int key);
+
+		private:
+			bool Matches(uint32_t index, const AppQuery& query, const std::string& lowerName) const;
+			void BuildOrder(AppSortKey key);
+
+		private:
+			std::shared_ptr<const GameCatalog> m_catalog;
+			std::vector<std::string> m_lowerNames;
+
+			static constexpr size_t NUM_SORT_KEYS = AppSortName + 1;
+			std::array<std::vector<uint32_t>, NUM_SORT_KEYS> m_ranks;						// equal values share a rank
+			std::array<std::array<std::vector<uint32_t>, 2>, NUM_SORT_KEYS> m_orders;		// [key][descending], ties keep catalog order
+	};
+}
+
+#endif // CATALOG_QUERY_H
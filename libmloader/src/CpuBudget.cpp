@@ -0,0 +1,110 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "CpuBudget.h"
+#include <algorithm>
+#include <thread>
+
+namespace mloader
+{
+	CpuBudget::Lease::Lease(CpuBudget& budget, unsigned int threads)
+		:	m_budget(budget),
+			m_threads(threads)
+	{
+	}
+
+	CpuBudget::Lease::~Lease()
+	{
+		m_budget.Release(m_threads);
+	}
+
+	unsigned int CpuBudget::Lease::GetThreads() const
+	{
+		return m_threads;
+	}
+
+	CpuBudget::CpuBudget(unsigned int totalThreads)
+	{
+		SetTotalThreads(totalThreads);
+	}
+
+	void CpuBudget::SetTotalThreads(unsigned int totalThreads)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_totalThreads = totalThreads > 0 ? totalThreads : std::max(1u, std::thread::hardware_concurrency());
+		}
+		m_condition.notify_all();
+	}
+
+	unsigned int CpuBudget::GetTotalThreads() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_totalThreads;
+	}
+
+	CpuBudget::Lease CpuBudget::AcquireExtraction(unsigned int maxThreads)
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_condition.wait(lock, [this]() { return GetAvailableThreads() > 0; });
+
+		const unsigned int available = GetAvailableThreads();
+		const unsigned int threads = maxThreads > 0 ? std::min(maxThreads, available) : available;
+		m_leasedThreads += threads;
+		return Lease(*this, threads);
+	}
+
+	void CpuBudget::BeginInstall()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_activeInstalls;
+	}
+
+	void CpuBudget::EndInstall()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			--m_activeInstalls;
+		}
+		m_condition.notify_all();
+	}
+
+	bool CpuBudget::InstallsActive() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_activeInstalls > 0;
+	}
+
+	unsigned int CpuBudget::GetAvailableThreads() const
+	{
+		// installs never wait for the budget, they only shrink what's left for extractions.
+		// A single extraction thread is always allowed when nothing else is extracting so work can't starve
+		const unsigned int reserved = m_leasedThreads + m_activeInstalls * INSTALL_RESERVED_THREADS;
+		if (reserved >= m_totalThreads)
+		{
+			return m_leasedThreads == 0 ? 1 : 0;
+		}
+		return m_totalThreads - reserved;
+	}
+
+	void CpuBudget::Release(unsigned int threads)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_leasedThreads -= threads;
+		}
+		m_condition.notify_all();
+	}
+}
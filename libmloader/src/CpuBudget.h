@@ -0,0 +1,72 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CPU_BUDGET_H
+#define CPU_BUDGET_H
+
+#include <condition_variable>
+#include <mutex>
+
+namespace mloader
+{
+	// Shares a fixed number of CPU threads between concurrent extractions.
+	// Running installs reserve part of the budget, so extractions back off while a device is being written to
+	class CpuBudget
+	{
+		public:
+			class Lease
+			{
+				public:
+					Lease(CpuBudget& budget, unsigned int threads);
+					~Lease();
+					Lease(const Lease&) = delete;
+					Lease& operator=(const Lease&) = delete;
+
+					unsigned int GetThreads() const;
+
+				private:
+					CpuBudget& m_budget;
+					unsigned int m_threads;
+			};
+
+			CpuBudget(unsigned int totalThreads = 0);
+
+			void SetTotalThreads(unsigned int totalThreads);
+			unsigned int GetTotalThreads() const;
+
+			// Blocks until at least one thread is free and leases up to maxThreads of them (0 leases everything that's free)
+			Lease AcquireExtraction(unsigned int maxThreads);
+
+			void BeginInstall();
+			void EndInstall();
+			bool InstallsActive() const;
+
+		private:
+			unsigned int GetAvailableThreads() const;
+			void Release(unsigned int threads);
+
+		private:
+			unsigned int m_totalThreads;
+			unsigned int m_leasedThreads = 0;
+			unsigned int m_activeInstalls = 0;
+
+			mutable std::mutex m_mutex;
+			std::condition_variable m_condition;
+
+			static constexpr unsigned int INSTALL_RESERVED_THREADS = 2;
+	};
+}
+
+#endif // CPU_BUDGET_H
@@ -0,0 +1,169 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "EventBus.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <unistd.h>
+#ifdef __linux__
+	#include <sys/eventfd.h>
+#endif
+
+namespace mloader
+{
+	EventBus::Subscription::Subscription(uint32_t eventMask, size_t capacity)
+		:	m_eventMask(eventMask),
+			m_queue(capacity)
+	{
+	#ifdef __linux__
+		m_readFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		m_writeFd = m_readFd;
+		if (m_readFd == -1)
+		{
+			throw std::runtime_error("Unable to create an eventfd for the event subscription");
+		}
+	#else
+		int fds[2];
+		if (pipe(fds) != 0)
+		{
+			throw std::runtime_error("Unable to create a pipe for the event subscription");
+		}
+
+		for (const int fd : fds)
+		{
+			fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+		}
+		m_readFd = fds[0];
+		m_writeFd = fds[1];
+	#endif
+	}
+
+	EventBus::Subscription::~Subscription()
+	{
+		close(m_readFd);
+		if (m_writeFd != m_readFd)
+		{
+			close(m_writeFd);
+		}
+	}
+
+	int EventBus::Subscription::GetFd() const
+	{
+		return m_readFd;
+	}
+
+	uint64_t EventBus::Subscription::GetDroppedCount() const
+	{
+		return m_droppedCount.load(std::memory_order_relaxed);
+	}
+
+	void EventBus::Subscription::Push(const MLoaderEvent& event)
+	{
+		if (m_eventMask != 0 && (m_eventMask & MLOADER_EVENT_MASK(event.Type)) == 0)
+		{
+			return;
+		}
+
+		if (!m_queue.TryPush(event))
+		{
+			m_droppedCount.fetch_add(1, std::memory_order_relaxed);		// the subscriber isn't keeping up
+		}
+
+		Signal();
+	}
+
+	void EventBus::Subscription::Signal()
+	{
+		if (m_signalled.exchange(true, std::memory_order_acq_rel))
+		{
+			return;
+		}
+
+	#ifdef __linux__
+		const uint64_t one = 1;
+		[[maybe_unused]] ssize_t written = write(m_writeFd, &one, sizeof(one));
+	#else
+		const char one = 1;
+		[[maybe_unused]] ssize_t written = write(m_writeFd, &one, sizeof(one));
+	#endif
+	}
+
+	void EventBus::Subscription::ResetSignal()
+	{
+		char buffer[64];
+		while (read(m_readFd, buffer, sizeof(buffer)) > 0)
+		{
+		}
+	}
+
+	size_t EventBus::Subscription::Drain(MLoaderEvent* events, size_t maxEvents)
+	{
+		size_t count = 0;
+		while (count < maxEvents && m_queue.TryPop(events[count]))
+		{
+			++count;
+		}
+
+		if (count < maxEvents)
+		{
+			// drained, rearm. Events pushed while the flag was still set didn't write to the descriptor, so look again after clearing it
+			ResetSignal();
+			m_signalled.store(false, std::memory_order_seq_cst);
+			if (m_queue.HasItems())
+			{
+				Signal();
+			}
+		}
+
+		return count;
+	}
+
+	EventBus::EventBus()
+		:	m_subscribers(std::make_shared<const SubscriberList>())
+	{
+	}
+
+	std::shared_ptr<EventBus::Subscription> EventBus::Subscribe(uint32_t eventMask, size_t capacity)
+	{
+		std::shared_ptr<Subscription> subscription = std::make_shared<Subscription>(eventMask, capacity);
+
+		std::lock_guard<std::mutex> lock(m_subscribeMutex);
+		std::shared_ptr<SubscriberList> subscribers = std::make_shared<SubscriberList>(*std::atomic_load(&m_subscribers));
+		subscribers->push_back(subscription);
+		std::atomic_store(&m_subscribers, std::shared_ptr<const SubscriberList>(std::move(subscribers)));
+		return subscription;
+	}
+
+	void EventBus::Unsubscribe(const Subscription* subscription)
+	{
+		std::lock_guard<std::mutex> lock(m_subscribeMutex);
+		std::shared_ptr<SubscriberList> subscribers = std::make_shared<SubscriberList>(*std::atomic_load(&m_subscribers));
+		std::erase_if(*subscribers, [subscription](const std::shared_ptr<Subscription>& entry)
+		{
+			return entry.get() == subscription;
+		});
+		std::atomic_store(&m_subscribers, std::shared_ptr<const SubscriberList>(std::move(subscribers)));
+	}
+
+	void EventBus::Publish(const MLoaderEvent& event)
+	{
+		std::shared_ptr<const SubscriberList> subscribers = std::atomic_load(&m_subscribers);
+		for (const std::shared_ptr<Subscription>& subscription : *subscribers)
+		{
+			subscription->Push(event);
+		}
+	}
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "BoundedQueue.h"
+#include <mloader/Event.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mloader
+{
+	// Fans library events out to any number of subscribers. Each subscriber owns a lock-free queue and a file descriptor
+	// (an eventfd, or a pipe where there is none) which turns readable when events are waiting and can be added to poll/epoll or a GLib main loop
+	class EventBus
+	{
+		public:
+			class Subscription
+			{
+				public:
+					Subscription(uint32_t eventMask, size_t capacity);
+					~Subscription();
+					Subscription(const Subscription&) = delete;
+					Subscription& operator=(const Subscription&) = delete;
+
+					int GetFd() const;
+					size_t Drain(MLoaderEvent* events, size_t maxEvents);		// never blocks
+					uint64_t GetDroppedCount() const;
+
+				private:
+					friend class EventBus;
+					void Push(const MLoaderEvent& event);
+					void Signal();
+					void ResetSignal();
+
+				private:
+					uint32_t m_eventMask;
+					BoundedQueue<MLoaderEvent> m_queue;
+					std::atomic<bool> m_signalled { false };		// the descriptor is readable, producers only write to it once per drained batch
+					std::atomic<uint64_t> m_droppedCount { 0 };
+					int m_readFd = -1;
+					int m_writeFd = -1;		// same as m_readFd for an eventfd
+			};
+
+			EventBus();
+
+			std::shared_ptr<Subscription> Subscribe(uint32_t eventMask, size_t capacity);		// eventMask 0 subscribes to every event
+			void Unsubscribe(const Subscription* subscription);
+			void Publish(const MLoaderEvent& event);
+
+		private:
+			using SubscriberList = std::vector<std::shared_ptr<Subscription>>;
+
+			std::shared_ptr<const SubscriberList> m_subscribers;		// copy on write, only accessed through std::atomic_load / std::atomic_store
+			std::mutex m_subscribeMutex;
+	};
+}
+
+#endif // EVENT_BUS_H
@@ -0,0 +1,111 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "GameCatalog.h"
+#include <algorithm>
+#include <functional>
+
+namespace mloader
+{
+	GameCatalog::GameCatalog(std::vector<std::pair<GameInfo, AppStatus>> games)
+	{
+		// ordered by name like the std::map this replaces, the first title of a given name wins
+		std::stable_sort(games.begin(), games.end(), [](const auto& lhs, const auto& rhs)
+		{
+			return lhs.first < rhs.first;
+		});
+		games.erase(std::unique(games.begin(), games.end(), [](const auto& lhs, const auto& rhs)
+		{
+			return !(lhs.first < rhs.first) && !(rhs.first < lhs.first);
+		}), games.end());
+
+		m_games.reserve(games.size());
+		m_statuses = std::make_unique<std::atomic<AppStatus>[]>(games.size());
+		for (size_t i = 0; i < games.size(); ++i)
+		{
+			m_games.push_back(std::move(games[i].first));
+			m_statuses[i].store(games[i].second, std::memory_order_relaxed);
+		}
+
+		m_releaseIndex.reserve(m_games.size());
+		for (size_t i = 0; i < m_games.size(); ++i)
+		{
+			m_releaseIndex.emplace(m_games[i].ReleaseName, i);
+		}
+	}
+
+	size_t GameCatalog::GetSize() const
+	{
+		return m_games.size();
+	}
+
+	const GameInfo& GameCatalog::GetGame(size_t index) const
+	{
+		return m_games[index];
+	}
+
+	AppStatus GameCatalog::GetStatus(size_t index) const
+	{
+		return m_statuses[index].load(std::memory_order_acquire);
+	}
+
+	AppStatus GameCatalog::ExchangeStatus(size_t index, AppStatus status) const
+	{
+		return m_statuses[index].exchange(status, std::memory_order_acq_rel);
+	}
+
+	const GameInfo* GameCatalog::Find(const std::string& releaseName) const
+	{
+		auto it = m_releaseIndex.find(releaseName);
+		return it != m_releaseIndex.end() ? &m_games[it->second] : nullptr;
+	}
+
+	std::optional<size_t> GameCatalog::IndexOf(const GameInfo& game) const
+	{
+		const GameInfo* first = m_games.data();
+		const GameInfo* last = first + m_games.size();
+		if (!std::less<const GameInfo*>()(&game, first) && std::less<const GameInfo*>()(&game, last))
+		{
+			return static_cast<size_t>(&game - first);
+		}
+
+		auto it = m_releaseIndex.find(game.ReleaseName);
+		if (it == m_releaseIndex.end())
+		{
+			return std::nullopt;
+		}
+		return it->second;
+	}
+
+	// Strings within the small string buffer don't allocate
+	static size_t GetStringHeapSize(const std::string& text)
+	{
+		return text.capacity() > std::string().capacity() ? text.capacity() + 1 : 0;
+	}
+
+	size_t GameCatalog::GetMemoryUsage() const
+	{
+		size_t bytes = sizeof(GameCatalog) + m_games.capacity() * sizeof(GameInfo) + m_games.size() * sizeof(std::atomic<AppStatus>);
+		for (const GameInfo& game : m_games)
+		{
+			bytes += GetStringHeapSize(game.GameName) + GetStringHeapSize(game.ReleaseName) + GetStringHeapSize(game.PackageName) + GetStringHeapSize(game.LastUpdated);
+		}
+
+		// one node per entry plus the bucket array
+		bytes += m_releaseIndex.size() * (sizeof(std::pair<const std::string_view, size_t>) + 2 * sizeof(void*));
+		bytes += m_releaseIndex.bucket_count() * sizeof(void*);
+		return bytes;
+	}
+}
@@ -0,0 +1,57 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef GAME_CATALOG_H
+#define GAME_CATALOG_H
+
+#include "model/GameInfo.h"
+#include <mloader/VrpApp.h>
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace mloader
+{
+	// Snapshot of the game list. The titles never change once the catalog is built, a metadata refresh publishes a new catalog instead.
+	// Statuses are atomics so workers can update them without copying the snapshot and readers never wait on a lock
+	class GameCatalog
+	{
+		public:
+			GameCatalog(std::vector<std::pair<GameInfo, AppStatus>> games);
+			GameCatalog(const GameCatalog&) = delete;
+			GameCatalog& operator=(const GameCatalog&) = delete;
+
+			size_t GetSize() const;
+			const GameInfo& GetGame(size_t index) const;
+			AppStatus GetStatus(size_t index) const;
+			AppStatus ExchangeStatus(size_t index, AppStatus status) const;		// returns the previous status
+
+			const GameInfo* Find(const std::string& releaseName) const;
+			std::optional<size_t> IndexOf(const GameInfo& game) const;		// games of an older snapshot are matched by release name
+			size_t GetMemoryUsage() const;		// estimate in bytes, including heap allocations
+
+		private:
+			std::vector<GameInfo> m_games;
+			std::unique_ptr<std::atomic<AppStatus>[]> m_statuses;
+			std::unordered_map<std::string_view, size_t> m_releaseIndex;		// views into m_games
+	};
+}
+
+#endif // GAME_CATALOG_H
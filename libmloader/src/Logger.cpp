@@ -14,57 +14,430 @@
 // along with this program. If not, see <https://www.gnu.org/licenses/>.
 
 #include "Logger.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <exception>
-#include <ctime>
+#include <filesystem>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
 
 namespace mloader
 {
-	static std::string GetCurrentTime()
+	static const char* GetLevelTag(LogLevel level)
+	{
+		switch (level)
+		{
+			case LogLevel::Debug:	return "[DEBUG] ";
+			case LogLevel::Info:	return "[INFO] ";
+			case LogLevel::Warning:	return "[WARNING] ";
+			case LogLevel::Error:	return "[ERROR] ";
+		}
+		return "";
+	}
+
+	static const char* GetLevelName(LogLevel level)
+	{
+		switch (level)
+		{
+			case LogLevel::Debug:	return "debug";
+			case LogLevel::Info:	return "info";
+			case LogLevel::Warning:	return "warning";
+			case LogLevel::Error:	return "error";
+		}
+		return "";
+	}
+
+	// Copies as much of text as fits and returns the length copied
+	template<size_t Size>
+	static auto CopyField(char (&field)[Size], std::string_view text)
 	{
-		std::time_t now = std::time(nullptr);
-		char buffer[255];
-		std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
-		return buffer;
+		const size_t length = std::min(text.size(), Size);
+		std::memcpy(field, text.data(), length);
+		return length;
+	}
+
+	static void AppendJsonString(std::string& out, const char* text, size_t length)
+	{
+		out += '"';
+		for (size_t i = 0; i < length; ++i)
+		{
+			const char c = text[i];
+			switch (c)
+			{
+				case '"':	out += "\\\"";	break;
+				case '\\':	out += "\\\\";	break;
+				case '\n':	out += "\\n";	break;
+				case '\r':	out += "\\r";	break;
+				case '\t':	out += "\\t";	break;
+				default:
+					if (static_cast<unsigned char>(c) < 0x20)
+					{
+						char escaped[8];
+						snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+						out += escaped;
+					}
+					else
+					{
+						out += c;
+					}
+			}
+		}
+		out += '"';
 	}
 
 	Logger::Logger(const std::string& fileName)
+		:	m_fileName(fileName),
+			m_records(RECORD_CAPACITY)
 	{
 		m_logFile.open(fileName, std::ios::out | std::ios::app);
 		if (!m_logFile.is_open())
 		{
 			throw std::runtime_error("Unable to open log file " + fileName);
 		}
+
+		std::error_code error;
+		const uintmax_t fileSize = fs::file_size(fileName, error);
+		m_fileSize = error ? 0 : fileSize;
+
+		m_writerThread = std::thread(&Logger::WriterService, this);
 	}
-	
+
 	Logger::~Logger()
 	{
+		{
+			std::lock_guard<std::mutex> lock(m_writerMutex);
+			m_stop = true;
+		}
+		m_writerCondition.notify_one();
+
+		if (m_writerThread.joinable())
+		{
+			m_writerThread.join();
+		}
+
 		if (m_logFile.is_open())
 		{
 			m_logFile.close();
 		}
 	}
 
-	void Logger::WriteToFile(const std::string& message)
+	void Logger::LogDebug(const std::string& system, const std::string& message)
 	{
-		std::lock_guard<std::mutex> lock(m_logMutex);
-		m_logFile << message << std::endl;
+		Log(LogLevel::Debug, system, message);
 	}
 
 	void Logger::LogInfo(const std::string& system, const std::string& message)
 	{
-		const std::string msg = "[INFO] " + GetCurrentTime() + " [" + system + "]: " + message;
-		WriteToFile(msg);
+		Log(LogLevel::Info, system, message);
 	}
 
 	void Logger::LogWarning(const std::string& system, const std::string& message)
 	{
-		const std::string msg = "[WARNING] " + GetCurrentTime() + " [" + system + "]: " + message;
-		WriteToFile(msg);
+		Log(LogLevel::Warning, system, message);
 	}
-	
+
 	void Logger::LogError(const std::string& system, const std::string& message)
 	{
-		const std::string msg = "[ERROR] " + GetCurrentTime() + " [" + system + "]: " + message;
-		WriteToFile(msg);
+		Log(LogLevel::Error, system, message);
+	}
+
+	bool Logger::IsEnabled(LogLevel level) const
+	{
+		return level >= m_level.load(std::memory_order_relaxed);
+	}
+
+	void Logger::SetLevel(LogLevel level)
+	{
+		m_level.store(level, std::memory_order_relaxed);
+	}
+
+	void Logger::SetFormat(LogFormat format)
+	{
+		m_format.store(format, std::memory_order_relaxed);
+	}
+
+	void Logger::SetSampling(const std::string& event, unsigned int keepOneIn)
+	{
+		std::lock_guard<std::mutex> lock(m_samplingMutex);
+		std::shared_ptr<const SamplingMap> current = std::atomic_load(&m_sampling);
+
+		std::shared_ptr<SamplingMap> sampling = std::make_shared<SamplingMap>();
+		if (current)
+		{
+			for (const auto& [name, sampler] : *current)
+			{
+				sampling->emplace(name, Sampler{ sampler.KeepOneIn, std::make_unique<std::atomic<uint64_t>>(sampler.Seen->load()) });
+			}
+		}
+
+		if (keepOneIn > 1)
+		{
+			(*sampling)[event] = Sampler{ keepOneIn, std::make_unique<std::atomic<uint64_t>>(0) };
+		}
+		else
+		{
+			sampling->erase(event);
+		}
+
+		std::atomic_store(&m_sampling, std::shared_ptr<const SamplingMap>(sampling->empty() ? nullptr : std::move(sampling)));
+	}
+
+	void Logger::SetRotation(uint64_t maxBytes, unsigned int maxFiles)
+	{
+		m_rotateBytes.store(maxBytes, std::memory_order_relaxed);
+		m_rotateFiles.store(maxFiles, std::memory_order_relaxed);
+	}
+
+	uint64_t Logger::GetDroppedRecordCount() const
+	{
+		return m_droppedRecords.load(std::memory_order_relaxed);
+	}
+
+	bool Logger::Sample(std::string_view event, unsigned int& sampleRate) const
+	{
+		sampleRate = 1;
+		if (event.empty())
+		{
+			return true;
+		}
+
+		std::shared_ptr<const SamplingMap> sampling = std::atomic_load(&m_sampling);
+		if (!sampling)
+		{
+			return true;
+		}
+
+		auto it = sampling->find(std::string(event));
+		if (it == sampling->end())
+		{
+			return true;
+		}
+
+		sampleRate = it->second.KeepOneIn;
+		return it->second.Seen->fetch_add(1, std::memory_order_relaxed) % sampleRate == 0;
+	}
+
+	void Logger::Log(LogLevel level, const std::string& system, const std::string& message, const LogFields& fields)
+	{
+		if (!IsEnabled(level))
+		{
+			return;
+		}
+
+		Record record;
+		if (!Sample(fields.Event, record.SampleRate))
+		{
+			return;
+		}
+
+		record.Level = level;
+		record.Time = std::time(nullptr);
+		record.Bytes = fields.Bytes;
+		record.Seconds = fields.Seconds;
+		record.SystemLength = static_cast<uint8_t>(CopyField(record.System, system));
+		record.EventLength = static_cast<uint8_t>(CopyField(record.Event, fields.Event));
+		record.JobLength = static_cast<uint8_t>(CopyField(record.Job, fields.Job));
+		record.DeviceLength = static_cast<uint8_t>(CopyField(record.Device, fields.Device));
+		record.MessageLength = static_cast<uint16_t>(CopyField(record.Message, message));
+		record.Truncated = message.size() > MAX_MESSAGE_LENGTH;
+
+		if (!m_records.TryPush(record))
+		{
+			m_droppedRecords.fetch_add(1, std::memory_order_relaxed);
+			RequestFlush();
+			return;
+		}
+
+		if (level == LogLevel::Error)
+		{
+			RequestFlush();
+		}
+	}
+
+	void Logger::RequestFlush()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_writerMutex);
+			m_flushRequested = true;
+		}
+		m_writerCondition.notify_one();
+	}
+
+	void Logger::WriterService()
+	{
+		while (true)
+		{
+			bool stop;
+			{
+				std::unique_lock<std::mutex> lock(m_writerMutex);
+				m_writerCondition.wait_for(lock, FLUSH_INTERVAL, [this]() { return m_stop || m_flushRequested; });
+				m_flushRequested = false;
+				stop = m_stop;
+			}
+
+			WriteRecords();
+
+			if (stop)
+			{
+				break;
+			}
+		}
+	}
+
+	void Logger::WriteRecords()
+	{
+		Record record;
+		while (m_records.TryPop(record))
+		{
+			AppendRecord(record);
+		}
+
+		const uint64_t dropped = m_droppedRecords.load(std::memory_order_relaxed);
+		if (dropped != m_reportedDroppedRecords)
+		{
+			Record notice;
+			notice.Level = LogLevel::Warning;
+			notice.Time = std::time(nullptr);
+			notice.Bytes = -1;
+			notice.SystemLength = static_cast<uint8_t>(CopyField(notice.System, "Logger"));
+			notice.EventLength = static_cast<uint8_t>(CopyField(notice.Event, "log_records_dropped"));
+			notice.MessageLength = static_cast<uint16_t>(CopyField(notice.Message, std::to_string(dropped - m_reportedDroppedRecords) + " log records were dropped, the log buffer was full"));
+			AppendRecord(notice);
+			m_reportedDroppedRecords = dropped;
+		}
+
+		if (!m_batch.empty())
+		{
+			RotateIfNeeded();
+			m_logFile.write(m_batch.data(), static_cast<std::streamsize>(m_batch.size()));
+			m_logFile.flush();
+			m_fileSize += m_batch.size();
+			m_batch.clear();
+		}
+	}
+
+	void Logger::RotateIfNeeded()
+	{
+		const uint64_t maxBytes = m_rotateBytes.load(std::memory_order_relaxed);
+		if (maxBytes == 0 || m_fileSize == 0 || m_fileSize + m_batch.size() <= maxBytes)
+		{
+			return;
+		}
+
+		// mloader.log becomes mloader.log.1, mloader.log.1 becomes mloader.log.2 and so on, the oldest one is removed
+		const unsigned int maxFiles = m_rotateFiles.load(std::memory_order_relaxed);
+		m_logFile.close();
+
+		std::error_code error;
+		fs::remove(m_fileName + "." + std::to_string(maxFiles), error);
+		for (unsigned int i = maxFiles; i > 1; --i)
+		{
+			fs::rename(m_fileName + "." + std::to_string(i - 1), m_fileName + "." + std::to_string(i), error);
+		}
+
+		if (maxFiles > 0)
+		{
+			fs::rename(m_fileName, m_fileName + ".1", error);
+			m_logFile.open(m_fileName, std::ios::out | std::ios::app);
+		}
+		else
+		{
+			m_logFile.open(m_fileName, std::ios::out | std::ios::trunc);
+		}
+		m_fileSize = 0;
+	}
+
+	void Logger::AppendRecord(const Record& record)
+	{
+		// the timestamp is only formatted again when the second changes
+		if (record.Time != m_timestampSecond)
+		{
+			std::tm localTime;
+			localtime_r(&record.Time, &localTime);
+			std::strftime(m_textTimestamp, sizeof(m_textTimestamp), "%Y-%m-%d %H:%M:%S", &localTime);
+			std::strftime(m_jsonTimestamp, sizeof(m_jsonTimestamp), "%Y-%m-%dT%H:%M:%S%z", &localTime);
+			m_timestampSecond = record.Time;
+		}
+
+		if (m_format.load(std::memory_order_relaxed) == LogFormat::Json)
+		{
+			AppendJson(record);
+		}
+		else
+		{
+			AppendText(record);
+		}
+	}
+
+	void Logger::AppendText(const Record& record)
+	{
+		m_batch += GetLevelTag(record.Level);
+		m_batch += m_textTimestamp;
+		m_batch += " [";
+		m_batch.append(record.System, record.SystemLength);
+		m_batch += "]: ";
+		m_batch.append(record.Message, record.MessageLength);
+		if (record.Truncated)
+		{
+			m_batch += "...";
+		}
+		m_batch += '\n';
+	}
+
+	void Logger::AppendJson(const Record& record)
+	{
+		m_batch += "{\"time\":\"";
+		m_batch += m_jsonTimestamp;
+		m_batch += "\",\"level\":\"";
+		m_batch += GetLevelName(record.Level);
+		m_batch += "\",\"system\":";
+		AppendJsonString(m_batch, record.System, record.SystemLength);
+
+		if (record.EventLength > 0)
+		{
+			m_batch += ",\"event\":";
+			AppendJsonString(m_batch, record.Event, record.EventLength);
+		}
+
+		if (record.JobLength > 0)
+		{
+			m_batch += ",\"job\":";
+			AppendJsonString(m_batch, record.Job, record.JobLength);
+		}
+
+		if (record.DeviceLength > 0)
+		{
+			m_batch += ",\"device\":";
+			AppendJsonString(m_batch, record.Device, record.DeviceLength);
+		}
+
+		if (record.Bytes >= 0)
+		{
+			m_batch += ",\"bytes\":";
+			m_batch += std::to_string(record.Bytes);
+		}
+
+		if (record.Seconds >= 0.0)
+		{
+			char seconds[32];
+			snprintf(seconds, sizeof(seconds), ",\"duration_s\":%.3f", record.Seconds);
+			m_batch += seconds;
+		}
+
+		if (record.SampleRate > 1)
+		{
+			m_batch += ",\"sample_rate\":";		// this record stands for sample_rate records of its event
+			m_batch += std::to_string(record.SampleRate);
+		}
+
+		m_batch += ",\"message\":";
+		AppendJsonString(m_batch, record.Message, record.MessageLength);
+		if (record.Truncated)
+		{
+			m_batch += ",\"truncated\":true";
+		}
+		m_batch += "}\n";
 	}
 }
@@ -16,27 +16,145 @@
 #ifndef LOGGER_H
 #define LOGGER_H
 
+#include "BoundedQueue.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <fstream>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace mloader
 {
+	enum class LogLevel		// same order as MLoaderLogLevel
+	{
+		Debug,
+		Info,
+		Warning,
+		Error
+	};
+
+	enum class LogFormat	// same order as MLoaderLogFormat
+	{
+		Text,
+		Json
+	};
+
+	// Structured fields of a log record, empty or negative fields are left out
+	struct LogFields
+	{
+		std::string_view Event{};	// short snake_case name, records are sampled per event
+		std::string_view Job{};
+		std::string_view Device{};
+		int64_t Bytes = -1;
+		double Seconds = -1.0;		// duration
+	};
+
+	// Log calls copy the message into a fixed size record on a lock-free ring buffer and return. A background thread
+	// formats and writes the records in batches, flushing every FLUSH_INTERVAL or right away when an error is logged.
+	// If the buffer is full the record is dropped and counted, the file notes how many were lost.
+	// Records are written as JSON lines by default, the file is rotated by size
 	class Logger
 	{
 		public:
 			Logger(const std::string& fileName);
-			~Logger();
-		
+			~Logger();		// writes everything still queued
+
+			void Log(LogLevel level, const std::string& system, const std::string& message, const LogFields& fields = {});
+			void LogDebug(const std::string& system, const std::string& message);
 			void LogInfo(const std::string& system, const std::string& message);
 			void LogWarning(const std::string& system, const std::string& message);
 			void LogError(const std::string& system, const std::string& message);
-		
+
+			bool IsEnabled(LogLevel level) const;		// lets callers skip building messages which would be discarded
+			void SetLevel(LogLevel level);
+			void SetFormat(LogFormat format);
+			void SetSampling(const std::string& event, unsigned int keepOneIn);		// 0 or 1 keeps every record of the event
+			void SetRotation(uint64_t maxBytes, unsigned int maxFiles);				// maxBytes 0 never rotates, maxFiles old files are kept
+
+			uint64_t GetDroppedRecordCount() const;
+
 		private:
-			void WriteToFile(const std::string& message);
+			static constexpr size_t MAX_SYSTEM_LENGTH = 31;
+			static constexpr size_t MAX_EVENT_LENGTH = 31;
+			static constexpr size_t MAX_JOB_LENGTH = 127;
+			static constexpr size_t MAX_DEVICE_LENGTH = 63;
+			static constexpr size_t MAX_MESSAGE_LENGTH = 479;		// longer messages are cut and end with "..."
+
+			struct Record
+			{
+				LogLevel Level = LogLevel::Info;
+				std::time_t Time = 0;
+				int64_t Bytes = -1;
+				double Seconds = -1.0;
+				unsigned int SampleRate = 1;
+				uint8_t SystemLength = 0;
+				uint8_t EventLength = 0;
+				uint8_t JobLength = 0;
+				uint8_t DeviceLength = 0;
+				uint16_t MessageLength = 0;
+				bool Truncated = false;
+				char System[MAX_SYSTEM_LENGTH];
+				char Event[MAX_EVENT_LENGTH];
+				char Job[MAX_JOB_LENGTH];
+				char Device[MAX_DEVICE_LENGTH];
+				char Message[MAX_MESSAGE_LENGTH];
+			};
+
+			struct Sampler
+			{
+				unsigned int KeepOneIn;
+				std::unique_ptr<std::atomic<uint64_t>> Seen;
+			};
+			using SamplingMap = std::unordered_map<std::string, Sampler>;
+
+			bool Sample(std::string_view event, unsigned int& sampleRate) const;
+			void RequestFlush();
+			void WriterService();
+			void WriteRecords();
+			void AppendRecord(const Record& record);
+			void AppendText(const Record& record);
+			void AppendJson(const Record& record);
+			void RotateIfNeeded();
+
 		private:
+			std::string m_fileName;
 			std::ofstream m_logFile;
-			std::mutex m_logMutex;
+
+			BoundedQueue<Record> m_records;
+			std::atomic<uint64_t> m_droppedRecords { 0 };
+
+			std::atomic<LogLevel> m_level { LogLevel::Info };
+			std::atomic<LogFormat> m_format { LogFormat::Json };
+			std::atomic<uint64_t> m_rotateBytes { DEFAULT_ROTATE_BYTES };
+			std::atomic<unsigned int> m_rotateFiles { DEFAULT_ROTATE_FILES };
+			std::shared_ptr<const SamplingMap> m_sampling;		// only accessed through std::atomic_load / std::atomic_store
+			std::mutex m_samplingMutex;							// serializes SetSampling
+
+			std::thread m_writerThread;
+			std::mutex m_writerMutex;
+			std::condition_variable m_writerCondition;
+			bool m_flushRequested = false;
+			bool m_stop = false;
+
+			// only used by the writer thread
+			std::string m_batch;
+			uint64_t m_fileSize = 0;
+			uint64_t m_reportedDroppedRecords = 0;
+			std::time_t m_timestampSecond = -1;
+			char m_textTimestamp[32] = "";
+			char m_jsonTimestamp[32] = "";
+
+			static constexpr size_t RECORD_CAPACITY = 4096;
+			static constexpr std::chrono::milliseconds FLUSH_INTERVAL { 250 };
+			static constexpr uint64_t DEFAULT_ROTATE_BYTES = 10 * 1024 * 1024;
+			static constexpr unsigned int DEFAULT_ROTATE_FILES = 3;
 	};
 }
 
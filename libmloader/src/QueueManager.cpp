@@ -18,17 +18,23 @@
 
 namespace mloader
 {
-	QueueManager::QueueManager(VRPManager& vrpManager, ADB& adb, Logger& logger) :
+	QueueManager::QueueManager(VRPManager& vrpManager, ADB& adb, CpuBudget& cpuBudget, Logger& logger, std::function<void(const GameInfo&, const std::string&, AppStatus)> deviceStatusChangedCallback) :
 		m_vrpManager(vrpManager),
 		m_adb(adb),
+		m_cpuBudget(cpuBudget),
 		m_logger(logger),
+		m_deviceStatusChangedCallback(deviceStatusChangedCallback),
 		m_running(true)
 	{
 		m_backgroundDownloadThread = std::thread(&QueueManager::BackgroundDownloadService, this);
-		m_backgroundInstallThread = std::thread(&QueueManager::BackgroundInstallService, this);
 	}
 
 	QueueManager::~QueueManager()
+	{
+		Stop();
+	}
+
+	void QueueManager::Stop()
 	{
 		ClearDownloadQueue();
 		ClearInstallQueue();
@@ -39,57 +45,316 @@ namespace mloader
 			m_backgroundDownloadThread.join();
 		}
 
-		if (m_backgroundInstallThread.joinable())
 		{
-			m_backgroundInstallThread.join();
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			for (auto& [serial, worker] : m_deviceWorkers)
+			{
+				worker->Stop = true;
+				worker->Condition.notify_all();
+			}
 		}
 
-		m_selectedDevice = nullptr;
+		for (auto& [serial, worker] : m_deviceWorkers)
+		{
+			if (worker->Thread.joinable())
+			{
+				worker->Thread.join();
+			}
+		}
 	}
 
 	void QueueManager::QueueDownload(const GameInfo* game)
 	{
+		QueuedGame entry = FindQueuedGame(*game);
+		if (entry.Game == nullptr)
+		{
+			return;
+		}
+
 		{
 			std::lock_guard<std::mutex> lock(m_downloadQueueMutex);
-			m_downloadQueue.push(game);
+			m_downloadQueue.push(std::move(entry));
 		}
 		m_vrpManager.UpdateGameStatus(*game, AppStatus::DownloadQueued);
 	}
 
-	void QueueManager::QueueInstall(const GameInfo* game)
+	void QueueManager::QueueInstall(const GameInfo* game, const std::vector<std::string>& serials)
 	{
+		const QueuedGame entry = FindQueuedGame(*game);
+		if (entry.Game == nullptr)
+		{
+			return;
+		}
+
+		std::vector<std::string> queuedSerials;
 		{
 			std::lock_guard<std::mutex> lock(m_installQueueMutex);
-			m_installQueue.push(game);
+			for (const std::string& serial : serials)
+			{
+				// skip devices which already have this title queued or installing
+				auto status = m_deviceInstallStatus.find({ game->ReleaseName, serial });
+				if (status != m_deviceInstallStatus.end() && (status->second.Status == AppStatus::InstallQueued || status->second.Status == AppStatus::Installing))
+				{
+					continue;
+				}
+
+				std::unique_ptr<DeviceInstallWorker>& worker = m_deviceWorkers[serial];
+				if (!worker)
+				{
+					worker = std::make_unique<DeviceInstallWorker>();
+					worker->Serial = serial;
+					worker->Thread = std::thread(&QueueManager::DeviceInstallService, this, std::ref(*worker));
+				}
+
+				worker->Queue.push_back(entry);
+				worker->Condition.notify_one();
+				InstallBatch& batch = m_installBatches[game->ReleaseName];
+				++batch.Pending;
+				batch.Serials.insert(serial);
+				queuedSerials.push_back(serial);
+			}
+		}
+
+		if (queuedSerials.empty())
+		{
+			return;
+		}
+
+		if (m_vrpManager.GetGameStatus(*game) != AppStatus::Installing)
+		{
+			m_vrpManager.UpdateGameStatus(*game, AppStatus::InstallQueued);
+		}
+
+		for (const std::string& serial : queuedSerials)
+		{
+			SetDeviceInstallStatus(*game, serial, AppStatus::InstallQueued);
 		}
-		m_vrpManager.UpdateGameStatus(*game, AppStatus::InstallQueued);
 	}
 
-	void QueueManager::SetSelectedAdbDevice(AdbDevice* device)
+	void QueueManager::QueueDirectInstall(const GameInfo* game, const std::vector<std::string>& serials)
+	{
+		QueuedGame entry = FindQueuedGame(*game);
+		if (entry.Game == nullptr)
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_downloadQueueMutex);
+			m_downloadQueue.push(std::move(entry));
+			m_directInstalls[game->ReleaseName] = serials;
+		}
+		m_vrpManager.UpdateGameStatus(*game, AppStatus::DownloadQueued);
+	}
+
+	AppStatus QueueManager::GetDeviceInstallStatus(const GameInfo& game, const std::string& serial) const
+	{
+		std::lock_guard<std::mutex> lock(m_installQueueMutex);
+		auto it = m_deviceInstallStatus.find({ game.ReleaseName, serial });
+		return it != m_deviceInstallStatus.end() ? it->second.Status : AppStatus::NoInfo;
+	}
+
+	DeviceInstallProgress QueueManager::GetDeviceInstallProgress(const GameInfo& game, const std::string& serial) const
 	{
 		std::lock_guard<std::mutex> lock(m_installQueueMutex);
-		m_selectedDevice = device;
+		auto it = m_deviceInstallStatus.find({ game.ReleaseName, serial });
+		return it != m_deviceInstallStatus.end() ? static_cast<DeviceInstallProgress>(it->second) : DeviceInstallProgress{};
+	}
+
+	void QueueManager::SetSelectedAdbDevice(const std::string& serial)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			m_selectedSerial = serial;
+		}
+		ApplyDeviceInventory(serial);
+	}
+
+	void QueueManager::SetTracer(Tracer* tracer)
+	{
+		m_tracer = tracer;
+	}
 
-		std::vector<std::string> installedPackages;
-		if(m_selectedDevice != nullptr)
+	void QueueManager::ApplyDeviceInventory(const std::string& serial, const GameInfo* onlyGame)
+	{
+		// The inventory is cached per device connection, so switching devices is a single pass over the catalog with hash lookups
+		std::shared_ptr<const ADB::PackageInventory> packages = serial.empty() ? std::make_shared<ADB::PackageInventory>() : m_adb.GetDevicePackages(serial);
+
+		std::shared_ptr<const GameCatalog> catalog = m_vrpManager.GetCatalog();
+		const std::optional<size_t> onlyIndex = onlyGame != nullptr ? catalog->IndexOf(*onlyGame) : std::nullopt;
+		if (onlyGame != nullptr && !onlyIndex)
 		{
-			installedPackages = m_adb.GetDeviceThirdPartyPackages(*device);
+			return;
 		}
 
-		for (auto game : m_vrpManager.GetGameList())
+		// statuses are applied after the lock is released, the status callbacks may call back into the queue manager
+		struct InventoryChange
 		{
-			if (game.second >= AppStatus::Downloaded)
+			const GameInfo* Game;
+			AppStatus Previous;
+			AppStatus Status;
+		};
+		std::vector<InventoryChange> changes;
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			if (serial != m_selectedSerial)
 			{
-				if (std::count(installedPackages.cbegin(), installedPackages.cend(), game.first.PackageName) > 0)
+				return;
+			}
+
+			const size_t first = onlyIndex.value_or(0);
+			const size_t last = onlyIndex ? *onlyIndex + 1 : catalog->GetSize();
+			for (size_t i = first; i < last; ++i)
+			{
+				const GameInfo& game = catalog->GetGame(i);
+				const AppStatus status = catalog->GetStatus(i);
+
+				// leave titles alone while they're being downloaded or installed
+				const bool settled = status == AppStatus::NoInfo || status == AppStatus::Downloaded || status == AppStatus::Installed || status == AppStatus::UpdateAvailable;
+				if (!settled || m_installBatches.contains(game.ReleaseName))
 				{
-					m_vrpManager.UpdateGameStatus(game.first, AppStatus::Installed);
+					continue;
 				}
-				else
+
+				const AppStatus inventoryStatus = GetInventoryStatus(game, *packages);
+				if (inventoryStatus != status)
 				{
-					m_vrpManager.UpdateGameStatus(game.first, AppStatus::Downloaded);
+					changes.push_back({ &game, status, inventoryStatus });
 				}
 			}
 		}
+
+		for (const InventoryChange& change : changes)
+		{
+			// skip titles which were queued in the meantime
+			if (m_vrpManager.GetGameStatus(*change.Game) == change.Previous)
+			{
+				m_vrpManager.UpdateGameStatus(*change.Game, change.Status);
+			}
+		}
+	}
+
+	QueueManager::QueuedGame QueueManager::FindQueuedGame(const GameInfo& game) const
+	{
+		QueuedGame entry{ m_vrpManager.GetCatalog(), nullptr };
+		entry.Game = entry.Catalog->Find(game.ReleaseName);
+		return entry;
+	}
+
+	AppStatus QueueManager::GetInventoryStatus(const GameInfo& game, const ADB::PackageInventory& packages) const
+	{
+		auto it = packages.find(game.PackageName);
+		if (it != packages.end())
+		{
+			return it->second >= game.VersionCode ? AppStatus::Installed : AppStatus::UpdateAvailable;
+		}
+
+		// games installed directly from the archive were never extracted locally
+		return m_vrpManager.GameDownloaded(game) ? AppStatus::Downloaded : AppStatus::NoInfo;
+	}
+
+	QueueStats QueueManager::GetQueueStats() const
+	{
+		QueueStats stats;
+		{
+			std::lock_guard<std::mutex> lock(m_downloadQueueMutex);
+			stats.QueuedDownloads = m_downloadQueue.size();
+		}
+
+		std::lock_guard<std::mutex> lock(m_installQueueMutex);
+		for (const auto& [serial, worker] : m_deviceWorkers)
+		{
+			stats.QueuedInstalls += worker->Queue.size();
+		}
+
+		for (const auto& [key, state] : m_deviceInstallStatus)
+		{
+			if (state.Status == AppStatus::Installing)
+			{
+				stats.InstallBytesPerSecond += state.BytesPerSecond;
+			}
+		}
+		return stats;
+	}
+
+	void QueueManager::ApplyCatalog(const std::shared_ptr<const GameCatalog>& catalog)
+	{
+		std::vector<QueuedGame> droppedDownloads;
+		{
+			std::lock_guard<std::mutex> lock(m_downloadQueueMutex);
+			std::queue<QueuedGame> downloadQueue;
+			while (!m_downloadQueue.empty())
+			{
+				QueuedGame entry = std::move(m_downloadQueue.front());
+				m_downloadQueue.pop();
+
+				const GameInfo* game = catalog->Find(entry.Game->ReleaseName);
+				if (game != nullptr)
+				{
+					downloadQueue.push({ catalog, game });
+					continue;
+				}
+
+				m_directInstalls.erase(entry.Game->ReleaseName);
+				droppedDownloads.push_back(std::move(entry));
+			}
+			m_downloadQueue.swap(downloadQueue);
+		}
+
+		std::vector<std::pair<QueuedGame, std::string>> droppedInstalls;
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			for (auto& [serial, worker] : m_deviceWorkers)
+			{
+				std::deque<QueuedGame> queue;
+				for (QueuedGame& entry : worker->Queue)
+				{
+					const std::string& releaseName = entry.Game->ReleaseName;
+					const GameInfo* game = catalog->Find(releaseName);
+					if (game != nullptr)
+					{
+						queue.push_back({ catalog, game });
+						continue;
+					}
+
+					m_deviceInstallStatus.erase({ releaseName, serial });
+					InstallBatch& batch = m_installBatches[releaseName];
+					batch.Serials.erase(serial);
+					if (--batch.Pending == 0)
+					{
+						m_installBatches.erase(releaseName);
+					}
+					droppedInstalls.emplace_back(std::move(entry), serial);
+				}
+				worker->Queue.swap(queue);
+			}
+		}
+
+		// the titles are gone from the catalog, so only their devices can be reported here
+		for (const QueuedGame& entry : droppedDownloads)
+		{
+			m_logger.LogWarning(LOG_NAME, "Dropped the queued download of " + entry.Game->ReleaseName + ", it's no longer in the metadata");
+		}
+
+		for (const auto& [entry, serial] : droppedInstalls)
+		{
+			m_logger.LogWarning(LOG_NAME, "Dropped the queued install of " + entry.Game->ReleaseName + " to device " + serial + ", it's no longer in the metadata");
+			if (m_deviceStatusChangedCallback)
+			{
+				m_deviceStatusChangedCallback(*entry.Game, serial, AppStatus::NoInfo);
+			}
+		}
+
+		// installed titles start over in the new catalog and the version codes may have changed
+		std::string selectedSerial;
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			selectedSerial = m_selectedSerial;
+		}
+		if (!selectedSerial.empty())
+		{
+			ApplyDeviceInventory(selectedSerial);
+		}
 	}
 
 	void QueueManager::ClearDownloadQueue()
@@ -99,21 +364,59 @@ namespace mloader
 		{
 			m_downloadQueue.pop();
 		}
+		m_directInstalls.clear();
 	}
 
 	void QueueManager::ClearInstallQueue()
 	{
-		std::lock_guard<std::mutex> lock(m_installQueueMutex);
-		while(!m_installQueue.empty())
+		// installs which already started run to completion
+		std::vector<std::pair<QueuedGame, std::string>> dequeued;
 		{
-			m_installQueue.pop();
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			for (auto& [serial, worker] : m_deviceWorkers)
+			{
+				for (QueuedGame& entry : worker->Queue)
+				{
+					const std::string& releaseName = entry.Game->ReleaseName;
+					m_deviceInstallStatus.erase({ releaseName, serial });
+					m_installBatches[releaseName].Serials.erase(serial);
+					if (--m_installBatches[releaseName].Pending == 0)
+					{
+						m_installBatches.erase(releaseName);
+					}
+					dequeued.emplace_back(std::move(entry), serial);
+				}
+				worker->Queue.clear();
+			}
 		}
 
-		for (auto game : m_vrpManager.GetGameList())
+		for (const auto& [entry, serial] : dequeued)
 		{
-			if (game.second >= AppStatus::Installing)
+			if (m_deviceStatusChangedCallback)
 			{
-				m_vrpManager.UpdateGameStatus(game.first, AppStatus::Downloaded);
+				m_deviceStatusChangedCallback(*entry.Game, serial, AppStatus::NoInfo);
+			}
+		}
+
+		std::shared_ptr<const GameCatalog> catalog = m_vrpManager.GetCatalog();
+		for (size_t i = 0; i < catalog->GetSize(); ++i)
+		{
+			const AppStatus status = catalog->GetStatus(i);
+			if (status != AppStatus::InstallQueued && status != AppStatus::Installing)
+			{
+				continue;
+			}
+
+			const GameInfo& game = catalog->GetGame(i);
+			bool stillInstalling;
+			{
+				std::lock_guard<std::mutex> lock(m_installQueueMutex);
+				stillInstalling = m_installBatches.contains(game.ReleaseName);
+			}
+
+			if (!stillInstalling)
+			{
+				m_vrpManager.UpdateGameStatus(game, m_vrpManager.GameDownloaded(game) ? AppStatus::Downloaded : AppStatus::NoInfo);
 			}
 		}
 	}
@@ -125,62 +428,261 @@ namespace mloader
 		{
 			std::this_thread::sleep_for(std::chrono::milliseconds(500));
 
-			m_downloadQueueMutex.lock();
-			if (!m_downloadQueue.empty())
+			std::unique_lock<std::mutex> lock(m_downloadQueueMutex);
+			QueuedGame entry;
+			while (!m_downloadQueue.empty() && entry.Game == nullptr)
 			{
-				const GameInfo* gameInfo = m_downloadQueue.back();
-				AppStatus gameStatus = m_vrpManager.GetGameStatus(*gameInfo);
+				QueuedGame front = std::move(m_downloadQueue.front());
+				m_downloadQueue.pop();
+				if (m_vrpManager.GetGameStatus(*front.Game) == AppStatus::DownloadQueued)
+				{
+					entry = std::move(front);
+				}
+				else
+				{
+					m_directInstalls.erase(front.Game->ReleaseName);		// queued twice or no longer queued, the entry is skipped
+				}
+			}
 
-				if (gameStatus == AppStatus::DownloadQueued)
+			if (entry.Game == nullptr)
+			{
+				continue;
+			}
+
+			const GameInfo* gameInfo = entry.Game;
+			auto directInstall = m_directInstalls.find(gameInfo->ReleaseName);
+			std::vector<std::string> installSerials;
+			const bool isDirectInstall = directInstall != m_directInstalls.end();
+			if (isDirectInstall)
+			{
+				installSerials = std::move(directInstall->second);
+				m_directInstalls.erase(directInstall);
+			}
+			lock.unlock();
+
+			if (isDirectInstall)
+			{
+				if (m_vrpManager.DownloadGameArchive(*gameInfo))
 				{
-					m_downloadQueue.pop();
-					m_downloadQueueMutex.unlock();
-					m_vrpManager.DownloadGame(*gameInfo);
+					QueueInstall(gameInfo, installSerials);
 				}
 			}
-			m_downloadQueueMutex.unlock();
+			else
+			{
+				m_vrpManager.DownloadGame(*gameInfo);
+			}
 		}
 	}
 
-	void QueueManager::BackgroundInstallService()
+	void QueueManager::DeviceInstallService(DeviceInstallWorker& worker)
 	{
-		m_logger.LogInfo(LOG_NAME, "Started background install service");
-		while(m_running)
+		m_logger.LogInfo(LOG_NAME, "Started install service for device " + worker.Serial);
+		while (true)
 		{
-			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+			QueuedGame entry;
+			{
+				std::unique_lock<std::mutex> lock(m_installQueueMutex);
+				worker.Condition.wait(lock, [&worker]() { return worker.Stop || !worker.Queue.empty(); });
+				if (worker.Stop)
+				{
+					break;
+				}
+
+				entry = std::move(worker.Queue.front());
+				worker.Queue.pop_front();
+			}
+			const GameInfo* gameInfo = entry.Game;
 
-			if (m_selectedDevice == nullptr)
+			if (m_vrpManager.GetGameStatus(*gameInfo) != AppStatus::Installing)
 			{
-				continue;
+				m_vrpManager.UpdateGameStatus(*gameInfo, AppStatus::Installing);
 			}
+			SetDeviceInstallStatus(*gameInfo, worker.Serial, AppStatus::Installing);
 
-			m_installQueueMutex.lock();
-			if (!m_installQueue.empty())
+			const bool success = InstallToDevice(*gameInfo, worker.Serial);
+			if (success)
 			{
-				const GameInfo* gameInfo = m_installQueue.back();
-				AppStatus gameStatus = m_vrpManager.GetGameStatus(*gameInfo);
-				m_logger.LogInfo(LOG_NAME, "checking status");
-				if (gameStatus == AppStatus::InstallQueued)
+				m_adb.RefreshDevicePackage(worker.Serial, gameInfo->PackageName);
+			}
+			SetDeviceInstallStatus(*gameInfo, worker.Serial, success ? AppStatus::Installed : AppStatus::InstallingError);
+			FinishDeviceInstall(*gameInfo, success);
+		}
+	}
+
+	bool QueueManager::InstallToDevice(const GameInfo& game, const std::string& serial)
+	{
+		// spans of the adb stages run on this thread and are attributed to the title
+		Tracer::JobScope jobScope(game.ReleaseName);
+		Tracer::Span span(m_tracer, TraceStage::Install, game.ReleaseName, serial);
+
+		// obb files are pushed from several threads, so progress can arrive out of order
+		std::atomic<uint64_t> installedBytes{0};
+		auto progressCallback = [this, &game, &serial, &installedBytes](uint64_t bytesWritten, uint64_t bytesTotal)
+		{
+			uint64_t previous = installedBytes;
+			while (previous < bytesWritten && !installedBytes.compare_exchange_weak(previous, bytesWritten)) { }
+			const uint64_t written = installedBytes.load();		// the running maximum, a late report of another worker doesn't move it back
+			if (m_logger.IsEnabled(LogLevel::Debug))
+			{
+				m_logger.Log(LogLevel::Debug, LOG_NAME, "Install progress of " + std::to_string(bytesTotal) + " bytes", LogFields{ .Event = "install_progress", .Job = game.ReleaseName, .Device = serial, .Bytes = static_cast<int64_t>(written) });
+			}
+			UpdateDeviceInstallProgress(game, serial, written, bytesTotal);
+		};
+
+		m_cpuBudget.BeginInstall();
+		try
+		{
+			if (m_vrpManager.GameInstalled(game))
+			{
+				std::vector<fs::path> fileList = m_vrpManager.GetGameFileList(game);
+				m_adb.InstallFilesToDevice(game.PackageName, fileList, serial, progressCallback);
+			}
+			else
+			{
+				// direct install, stream the files from the downloaded archive
+				std::vector<ArchiveEntry> fileList = m_vrpManager.GetGameArchiveFileList(game);
+				m_adb.InstallArchiveFilesToDevice(game.PackageName, fileList, [this, &game](const ArchiveEntry& entry, const StreamSink& sink)
 				{
-					m_logger.LogInfo(LOG_NAME, "status check pass");
-					m_installQueue.pop();
-					m_installQueueMutex.unlock();
-					try
-					{
-						m_logger.LogInfo(LOG_NAME, "setting to installing");
-						m_vrpManager.UpdateGameStatus(*gameInfo, AppStatus::Installing);
-						std::vector<fs::path> fileList = m_vrpManager.GetGameFileList(*gameInfo);
-						m_adb.InstallFilesToDevice(gameInfo->PackageName, fileList, *m_selectedDevice);
-						m_vrpManager.UpdateGameStatus(*gameInfo, AppStatus::Installed);
-					}
-					catch(std::runtime_error& err)
-					{
-						m_vrpManager.UpdateGameStatus(*gameInfo, AppStatus::InstallingError);
-						m_logger.LogError(LOG_NAME, err.what());
-					}
+					return m_vrpManager.ReadGameArchiveFile(game, entry, sink);
+				}, serial, progressCallback);
+			}
+		}
+		catch(const std::exception& err)		// filesystem errors and malformed archive listings as well, the device is marked as failed
+		{
+			m_cpuBudget.EndInstall();
+			m_logger.LogError(LOG_NAME, "Installing " + game.ReleaseName + " to device " + serial + " failed: " + err.what());
+			span.AddBytes(installedBytes);
+			span.SetFailed();
+			return false;
+		}
+
+		m_cpuBudget.EndInstall();
+		span.AddBytes(installedBytes);
+		return true;
+	}
+
+	void QueueManager::SetDeviceInstallStatus(const GameInfo& game, const std::string& serial, AppStatus status)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			DeviceInstallState& state = m_deviceInstallStatus[{ game.ReleaseName, serial }];
+			state.Status = status;
+			if (status == AppStatus::Installing)
+			{
+				state = DeviceInstallState{};
+				state.Status = status;
+				state.SampleTime = std::chrono::steady_clock::now();
+			}
+		}
+
+		if (m_deviceStatusChangedCallback)
+		{
+			m_deviceStatusChangedCallback(game, serial, status);
+		}
+	}
+
+	void QueueManager::UpdateDeviceInstallProgress(const GameInfo& game, const std::string& serial, uint64_t bytesWritten, uint64_t bytesTotal)
+	{
+		bool deviceChanged = false;
+		int batchProgress = -1;
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			DeviceInstallState& state = m_deviceInstallStatus[{ game.ReleaseName, serial }];
+
+			auto percent = [](const DeviceInstallProgress& progress)
+			{
+				if (progress.Status == AppStatus::Installed || progress.Status == AppStatus::InstallingError)
+				{
+					return 100;
+				}
+				return progress.BytesTotal > 0 ? static_cast<int>(progress.BytesWritten * 100 / progress.BytesTotal) : 0;
+			};
+
+			const int previousPercent = percent(state);
+			state.BytesWritten = std::max(state.BytesWritten, bytesWritten);		// two workers may pass their maximum in either order
+			state.BytesTotal = bytesTotal;
+			deviceChanged = percent(state) != previousPercent;
+
+			// rate per device, so slow ports and cables stand out
+			const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if (now - state.SampleTime >= RATE_SAMPLE_INTERVAL)
+			{
+				const double seconds = std::chrono::duration<double>(now - state.SampleTime).count();
+				state.BytesPerSecond = state.BytesWritten > state.SampleBytes ? (state.BytesWritten - state.SampleBytes) / seconds : 0.0;
+				state.SampleTime = now;
+				state.SampleBytes = state.BytesWritten;
+				deviceChanged = true;
+			}
+
+			// the title reports the average over all devices, queued devices count as 0%
+			auto batch = m_installBatches.find(game.ReleaseName);
+			if (batch != m_installBatches.end() && !batch->second.Serials.empty())
+			{
+				int sum = 0;
+				for (const std::string& batchSerial : batch->second.Serials)
+				{
+					auto deviceState = m_deviceInstallStatus.find({ game.ReleaseName, batchSerial });
+					sum += deviceState != m_deviceInstallStatus.end() ? percent(deviceState->second) : 0;
+				}
+
+				const int progress = sum / static_cast<int>(batch->second.Serials.size());
+				if (progress != batch->second.Progress)
+				{
+					batch->second.Progress = progress;
+					batchProgress = progress;
 				}
 			}
-			m_installQueueMutex.unlock();
+		}
+
+		if (deviceChanged && m_deviceStatusChangedCallback)
+		{
+			m_deviceStatusChangedCallback(game, serial, AppStatus::Installing);
+		}
+
+		if (batchProgress >= 0)
+		{
+			m_vrpManager.UpdateGameStatus(game, AppStatus::Installing, batchProgress);
+		}
+	}
+
+	void QueueManager::FinishDeviceInstall(const GameInfo& game, bool success)
+	{
+		bool batchFinished = false;
+		bool batchFailed = false;
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			InstallBatch& batch = m_installBatches[game.ReleaseName];
+			batch.Failed |= !success;
+			if (--batch.Pending == 0)
+			{
+				batchFinished = true;
+				batchFailed = batch.Failed;
+				m_installBatches.erase(game.ReleaseName);
+			}
+		}
+
+		if (!batchFinished)
+		{
+			return;
+		}
+
+		// The archive is shared by every device of the batch, it's kept after failures so the install can be retried
+		if (!batchFailed && !m_vrpManager.GameInstalled(game))
+		{
+			m_vrpManager.DeleteGameArchive(game);
+		}
+
+		m_vrpManager.UpdateGameStatus(game, batchFailed ? AppStatus::InstallingError : AppStatus::Installed);
+
+		// the selected device might not have been part of the batch
+		std::string selectedSerial;
+		{
+			std::lock_guard<std::mutex> lock(m_installQueueMutex);
+			selectedSerial = m_selectedSerial;
+		}
+		if (!batchFailed && !selectedSerial.empty())
+		{
+			ApplyDeviceInventory(selectedSerial, &game);
 		}
 	}
 }
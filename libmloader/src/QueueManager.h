@@ -19,49 +19,135 @@
 #include "atomic"
 #include "model/GameInfo.h"
 #include "ADB.h"
+#include "CpuBudget.h"
 #include "Logger.h"
+#include "Tracer.h"
 #include "VRPManager.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <queue>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace mloader
 {
+	struct DeviceInstallProgress
+	{
+		AppStatus Status = AppStatus::NoInfo;
+		uint64_t BytesWritten = 0;
+		uint64_t BytesTotal = 0;
+		double BytesPerSecond = 0.0;
+	};
+
+	struct QueueStats
+	{
+		size_t QueuedDownloads = 0;
+		size_t QueuedInstalls = 0;				// summed over all devices
+		double InstallBytesPerSecond = 0.0;		// all devices together
+	};
+
 	class QueueManager
 	{
 		public:
-			QueueManager(VRPManager& vrpManager, ADB& adb, Logger& logger);
+			QueueManager(VRPManager& vrpManager, ADB& adb, CpuBudget& cpuBudget, Logger& logger, std::function<void(const GameInfo&, const std::string&, AppStatus)> deviceStatusChangedCallback = nullptr);
 			~QueueManager();
 
 			void QueueDownload(const GameInfo* game);
-			void QueueInstall(const GameInfo* game);
+			void QueueInstall(const GameInfo* game, const std::vector<std::string>& serials);
+			void QueueDirectInstall(const GameInfo* game, const std::vector<std::string>& serials);
+
+			AppStatus GetDeviceInstallStatus(const GameInfo& game, const std::string& serial) const;
+			DeviceInstallProgress GetDeviceInstallProgress(const GameInfo& game, const std::string& serial) const;
+			QueueStats GetQueueStats() const;
 
-			void SetSelectedAdbDevice(AdbDevice* device);
+			void SetSelectedAdbDevice(const std::string& serial);		// empty when no device is selected
+			void SetTracer(Tracer* tracer);
 
 			void ClearDownloadQueue();
 			void ClearInstallQueue();
+			// Moves the queued jobs over to the titles of a newly published catalog. Jobs of titles which are gone from it
+			// are dropped and their devices reported as NoInfo. The packages of the selected device are applied to the catalog again
+			void ApplyCatalog(const std::shared_ptr<const GameCatalog>& catalog);
+			void Stop();		// clears the queues and joins the download and install threads, running jobs finish first. No status changes are reported afterwards
 
 		private:
+			// A queued title holds on to the catalog it belongs to, so it stays valid while new metadata is published
+			struct QueuedGame
+			{
+				std::shared_ptr<const GameCatalog> Catalog;
+				const GameInfo* Game = nullptr;
+			};
+
+			// Every device gets its own install thread, so one title is installed onto several devices at once
+			struct DeviceInstallWorker
+			{
+				std::string Serial;
+				std::deque<QueuedGame> Queue;
+				std::condition_variable Condition;
+				bool Stop = false;
+				std::thread Thread;
+			};
+
+			// Tracks a title across all devices it's being installed to
+			struct InstallBatch
+			{
+				unsigned int Pending = 0;
+				bool Failed = false;
+				std::set<std::string> Serials;		// every device of the batch, including finished ones
+				int Progress = -1;					// average over all devices in percent
+			};
+
+			struct DeviceInstallState : DeviceInstallProgress
+			{
+				std::chrono::steady_clock::time_point SampleTime;	// the transfer rate is measured over intervals of RATE_SAMPLE_INTERVAL
+				uint64_t SampleBytes = 0;
+			};
+
+			QueuedGame FindQueuedGame(const GameInfo& game) const;		// the title in the current catalog, Game is nullptr if it's gone
 			void BackgroundDownloadService();
-			void BackgroundInstallService();
+			void DeviceInstallService(DeviceInstallWorker& worker);
+			bool InstallToDevice(const GameInfo& game, const std::string& serial);
+			void SetDeviceInstallStatus(const GameInfo& game, const std::string& serial, AppStatus status);
+			void UpdateDeviceInstallProgress(const GameInfo& game, const std::string& serial, uint64_t bytesWritten, uint64_t bytesTotal);
+			void FinishDeviceInstall(const GameInfo& game, bool success);
+			void ApplyDeviceInventory(const std::string& serial, const GameInfo* onlyGame = nullptr);
+			AppStatus GetInventoryStatus(const GameInfo& game, const ADB::PackageInventory& packages) const;
 
 		private:
 			std::atomic_bool m_running;
-			std::mutex m_downloadQueueMutex;
-			std::mutex m_installQueueMutex;
-			std::queue<const GameInfo*> m_installQueue;
-			std::queue<const GameInfo*> m_downloadQueue;
+			mutable std::mutex m_downloadQueueMutex;
+			mutable std::mutex m_installQueueMutex;
+			std::queue<QueuedGame> m_downloadQueue;
+			std::map<std::string, std::vector<std::string>> m_directInstalls;	// release name -> target devices of queued downloads which are installed from the archive without extracting
+
+			// Jobs are tracked by release name, running jobs keep the title of the catalog they were started with
+			std::unordered_map<std::string, std::unique_ptr<DeviceInstallWorker>> m_deviceWorkers;	// serial -> worker, created on the first install to a device
+			std::map<std::string, InstallBatch> m_installBatches;
+			std::map<std::pair<std::string, std::string>, DeviceInstallState> m_deviceInstallStatus;	// release name and serial
 
 		private:
 			VRPManager& m_vrpManager;
 			ADB&		m_adb;
+			CpuBudget&	m_cpuBudget;
 			Logger&		m_logger;
 
-			AdbDevice* m_selectedDevice = nullptr;
+			std::function<void(const GameInfo&, const std::string&, AppStatus)> m_deviceStatusChangedCallback;
+
+			Tracer* m_tracer = nullptr;
+			std::string m_selectedSerial;		// statuses of the catalog reflect the packages on this device
 		
 			std::thread m_backgroundDownloadThread;
-			std::thread m_backgroundInstallThread;
 
+			static constexpr std::chrono::milliseconds RATE_SAMPLE_INTERVAL{1000};
 			static constexpr const char* LOG_NAME{"QueueManager"};
 	};
 }
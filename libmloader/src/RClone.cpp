@@ -16,6 +16,7 @@
 #include "RClone.h"
 #include "Logger.h"
 #include "curl_global.h"
+#include "Utility.h"
 #include <cstring>
 #include <exception>
 #include <filesystem>
@@ -73,7 +74,7 @@ namespace mloader
 			char strbuffer[1024];
 			snprintf(strbuffer, sizeof(strbuffer), "unzip %s -d %s", rcloneToolPathZip.c_str(), m_cacheDir.c_str());
 			const std::string dbgStr = strbuffer;
-			fp = popen(strbuffer, "r");
+			fp = ProcessOpen(strbuffer, "r");
 			if (fp == NULL)
 			{
 				m_logger.LogError(LOG_NAME, "Unzipping Rclone failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
@@ -109,7 +110,7 @@ namespace mloader
 
 		snprintf(strbuffer, sizeof(strbuffer), "%s --http-url %s --tpslimit 1.0 --tpslimit-burst 3 sync \":http:/%s\" \"%s\"", m_rcloneToolPath.c_str(), baseUrl.c_str(), fileName.c_str(), directory.c_str());
 		const std::string dbgStr{strbuffer};
-		fp = popen(strbuffer, "r");
+		fp = ProcessOpen(strbuffer, "r");
 		if (fp == NULL)
 		{
 			m_logger.LogError(LOG_NAME, "Sync file failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
@@ -150,7 +151,7 @@ namespace mloader
 
 		snprintf(strbuffer, sizeof(strbuffer), "%s --http-url %s --tpslimit 1.0 --tpslimit-burst 3 copy \":http:/%s\" \"%s\" --transfers 1 --multi-thread-streams 0 --progress", m_rcloneToolPath.c_str(), baseUrl.c_str(), fileId.c_str(), directoryWithSubdir.c_str());
 		const std::string dbgStr{strbuffer};
-		fp = popen(strbuffer, "r");
+		fp = ProcessOpen(strbuffer, "r");
 		if (fp == NULL)
 		{
 			m_logger.LogError(LOG_NAME, "Downloading file failed. Error no: " + std::to_string(errno) + ". " + strerror(errno));
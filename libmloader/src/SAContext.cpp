@@ -135,6 +135,7 @@ SAContext* MLoaderSACreateLoaderContext(CreateLoaderContextStatusCallback callba
 	{
 		GenericCallback(callback, "Initializing ADB");
 		saContext->Adb = new mloader::ADB(cacheDir, *saContext->Logger, std::bind(OnAdbDeviceListChangedEvent, saContext));
+		saContext->Adb->Start();
 	}
 	catch(std::runtime_error& error)
 	{
@@ -182,7 +183,7 @@ bool MLoaderSAInstallFile(SAContext* context, const char* apkFile, AdbDevice* de
 	const std::vector<fs::path> files{ {apkFile} };
 	try
 	{
-		context->Adb->InstallFilesToDevice(obbPackageName, files, *device);
+		context->Adb->InstallFilesToDevice(obbPackageName, files, device->DeviceId);
 	}catch(std::runtime_error& err)
 	{
 		err_msg = err.what();
@@ -0,0 +1,224 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "SearchIndex.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace mloader
+{
+	SearchIndex::SearchIndex(std::shared_ptr<const GameCatalog> catalog, const NoteLoader& noteLoader)
+		:	m_catalog(std::move(catalog))
+	{
+		m_foldedNames.reserve(m_catalog->GetSize());
+
+		std::unordered_map<uint32_t, uint8_t> gameTrigrams;
+		for (uint32_t i = 0; i < m_catalog->GetSize(); ++i)
+		{
+			const GameInfo& game = m_catalog->GetGame(i);
+			m_foldedNames.push_back(Fold(game.GameName));
+
+			gameTrigrams.clear();
+			auto addField = [&gameTrigrams](const std::string& folded, Field field)
+			{
+				for (const uint32_t trigram : GetTrigrams(folded, true))
+				{
+					gameTrigrams[trigram] |= field;
+				}
+			};
+
+			addField(m_foldedNames.back(), FieldName);
+			addField(Fold(game.ReleaseName), FieldRelease);
+			addField(Fold(game.PackageName), FieldPackage);
+			if (noteLoader)
+			{
+				addField(Fold(noteLoader(game)), FieldNote);
+			}
+
+			for (const auto& [trigram, fields] : gameTrigrams)
+			{
+				m_postings[trigram].push_back({ i, fields });
+			}
+		}
+	}
+
+	const std::shared_ptr<const GameCatalog>& SearchIndex::GetCatalog() const
+	{
+		return m_catalog;
+	}
+
+	std::string SearchIndex::Fold(const std::string& text)
+	{
+		// lower case letters and digits, everything else separates words. Bytes of multibyte characters are kept as they are
+		std::string folded;
+		folded.reserve(text.size());
+		for (const unsigned char c : text)
+		{
+			if (std::isalnum(c) || c >= 0x80)
+			{
+				folded.push_back(static_cast<char>(std::tolower(c)));
+			}
+			else if (!folded.empty() && folded.back() != ' ')
+			{
+				folded.push_back(' ');
+			}
+		}
+
+		if (!folded.empty() && folded.back() == ' ')
+		{
+			folded.pop_back();
+		}
+		return folded;
+	}
+
+	std::vector<uint32_t> SearchIndex::GetTrigrams(const std::string& folded, bool padLastWord)
+	{
+		// every word is padded with two leading spaces and one trailing space, so word starts and ends carry weight.
+		// The last word of a query is left open while it's still being typed
+		std::vector<uint32_t> trigrams;
+		size_t wordStart = 0;
+		while (wordStart < folded.size())
+		{
+			size_t wordEnd = folded.find(' ', wordStart);
+			const bool lastWord = wordEnd == std::string::npos;
+			if (lastWord)
+			{
+				wordEnd = folded.size();
+			}
+
+			std::string padded = "  " + folded.substr(wordStart, wordEnd - wordStart);
+			if (!lastWord || padLastWord)
+			{
+				padded.push_back(' ');
+			}
+
+			for (size_t i = 0; i + 2 < padded.size(); ++i)
+			{
+				trigrams.push_back(static_cast<uint8_t>(padded[i]) << 16 | static_cast<uint8_t>(padded[i + 1]) << 8 | static_cast<uint8_t>(padded[i + 2]));
+			}
+
+			wordStart = wordEnd + 1;
+		}
+
+		std::sort(trigrams.begin(), trigrams.end());
+		trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+		return trigrams;
+	}
+
+	float SearchIndex::GetFieldWeight(uint8_t fields)
+	{
+		if (fields & FieldName)		return 1.0f;
+		if (fields & FieldRelease)	return 0.6f;
+		if (fields & FieldPackage)	return 0.5f;
+		return 0.25f;
+	}
+
+	std::vector<SearchIndex::Hit> SearchIndex::Search(const std::string& text, size_t maxResults) const
+	{
+		const std::string query = Fold(text);
+		const std::vector<uint32_t> queryTrigrams = GetTrigrams(query, false);
+		if (queryTrigrams.empty())
+		{
+			return {};
+		}
+
+		std::vector<float> scores(m_catalog->GetSize(), 0.0f);
+		std::vector<uint16_t> matches(m_catalog->GetSize(), 0);
+		std::vector<uint32_t> candidates;
+
+		for (const uint32_t trigram : queryTrigrams)
+		{
+			auto it = m_postings.find(trigram);
+			if (it == m_postings.end())
+			{
+				continue;
+			}
+
+			for (const Posting& posting : it->second)
+			{
+				if (matches[posting.Index]++ == 0)
+				{
+					candidates.push_back(posting.Index);
+				}
+				scores[posting.Index] += GetFieldWeight(posting.Fields);
+			}
+		}
+
+		const size_t minMatches = std::max<size_t>(1, static_cast<size_t>(std::ceil(queryTrigrams.size() * MIN_TRIGRAM_OVERLAP)));
+
+		std::vector<Hit> hits;
+		for (const uint32_t index : candidates)
+		{
+			if (matches[index] < minMatches)
+			{
+				continue;
+			}
+
+			float score = scores[index] / queryTrigrams.size();
+			if (m_foldedNames[index].find(query) != std::string::npos)
+			{
+				score += NAME_MATCH_BONUS;
+			}
+			hits.push_back({ index, score });
+		}
+
+		auto better = [this](const Hit& lhs, const Hit& rhs)
+		{
+			if (lhs.Score != rhs.Score)
+			{
+				return lhs.Score > rhs.Score;
+			}
+
+			const float lhsDownloads = m_catalog->GetGame(lhs.Index).Downloads;
+			const float rhsDownloads = m_catalog->GetGame(rhs.Index).Downloads;
+			if (lhsDownloads != rhsDownloads)
+			{
+				return lhsDownloads > rhsDownloads;		// popular titles first among equally good hits
+			}
+			return lhs.Index < rhs.Index;
+		};
+
+		if (maxResults > 0 && hits.size() > maxResults)
+		{
+			std::partial_sort(hits.begin(), hits.begin() + maxResults, hits.end(), better);
+			hits.resize(maxResults);
+		}
+		else
+		{
+			std::sort(hits.begin(), hits.end(), better);
+		}
+
+		return hits;
+	}
+
+	size_t SearchIndex::GetMemoryUsage() const
+	{
+		size_t bytes = sizeof(SearchIndex) + m_foldedNames.capacity() * sizeof(std::string);
+		for (const std::string& name : m_foldedNames)
+		{
+			bytes += name.capacity() > std::string().capacity() ? name.capacity() + 1 : 0;
+		}
+
+		// one node per trigram plus the bucket array
+		bytes += m_postings.size() * (sizeof(std::pair<const uint32_t, std::vector<Posting>>) + 2 * sizeof(void*));
+		bytes += m_postings.bucket_count() * sizeof(void*);
+		for (const auto& [trigram, postings] : m_postings)
+		{
+			bytes += postings.capacity() * sizeof(Posting);
+		}
+		return bytes;
+	}
+}
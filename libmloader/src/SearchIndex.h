@@ -0,0 +1,77 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include "GameCatalog.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mloader
+{
+	// Case-folded trigram index over the game name, release name, package name and note of every title in a catalog.
+	// Hits only need to share part of their trigrams with the query, so misspelled and partially typed words still match
+	class SearchIndex
+	{
+		public:
+			struct Hit
+			{
+				uint32_t Index;		// catalog index
+				float Score;
+			};
+
+			using NoteLoader = std::function<std::string(const GameInfo&)>;
+
+			SearchIndex(std::shared_ptr<const GameCatalog> catalog, const NoteLoader& noteLoader);
+
+			const std::shared_ptr<const GameCatalog>& GetCatalog() const;
+			std::vector<Hit> Search(const std::string& text, size_t maxResults = 0) const;		// best hits first, 0 returns every hit
+			size_t GetMemoryUsage() const;		// estimate in bytes, without the catalog
+
+		private:
+			enum Field : uint8_t
+			{
+				FieldName		= 1 << 0,
+				FieldRelease	= 1 << 1,
+				FieldPackage	= 1 << 2,
+				FieldNote		= 1 << 3
+			};
+
+			struct Posting
+			{
+				uint32_t Index;
+				uint8_t Fields;		// Field bits containing the trigram
+			};
+
+			static std::string Fold(const std::string& text);
+			static std::vector<uint32_t> GetTrigrams(const std::string& folded, bool padLastWord);
+			static float GetFieldWeight(uint8_t fields);
+
+		private:
+			std::shared_ptr<const GameCatalog> m_catalog;
+			std::unordered_map<uint32_t, std::vector<Posting>> m_postings;
+			std::vector<std::string> m_foldedNames;
+
+			static constexpr float MIN_TRIGRAM_OVERLAP = 0.5f;		// share of the query trigrams a hit needs
+			static constexpr float NAME_MATCH_BONUS = 1.0f;			// the query appears verbatim in the game name
+	};
+}
+
+#endif // SEARCH_INDEX_H
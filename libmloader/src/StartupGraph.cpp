@@ -0,0 +1,91 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "StartupGraph.h"
+#include <chrono>
+#include <stdexcept>
+
+namespace mloader
+{
+	void StartupGraph::AddPhase(const std::string& name, const std::vector<std::string>& dependencies, std::function<void()> task)
+	{
+		Phase phase{ name, {}, std::move(task) };
+		for (const std::string& dependency : dependencies)
+		{
+			phase.Dependencies.push_back(IndexOf(dependency));
+		}
+		m_phases.push_back(std::move(phase));
+	}
+
+	void StartupGraph::Run(const PhaseStartedCallback& onStarted, const PhaseFinishedCallback& onFinished)
+	{
+		std::vector<std::shared_future<void>> results;
+		results.reserve(m_phases.size());
+
+		for (const Phase& phase : m_phases)
+		{
+			std::vector<std::shared_future<void>> dependencies;
+			for (const size_t dependency : phase.Dependencies)
+			{
+				dependencies.push_back(results[dependency]);
+			}
+
+			results.push_back(std::async(std::launch::async, [this, &phase, &onStarted, &onFinished, dependencies]()
+			{
+				for (const std::shared_future<void>& dependency : dependencies)
+				{
+					dependency.get();		// rethrows the failure of a dependency, this phase is skipped then
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(m_callbackMutex);
+					onStarted(phase.Name);
+				}
+
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				phase.Task();
+				const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+				{
+					std::lock_guard<std::mutex> lock(m_callbackMutex);
+					onFinished(phase.Name, elapsed.count());
+				}
+			}).share());
+		}
+
+		for (const std::shared_future<void>& result : results)
+		{
+			result.wait();
+		}
+
+		for (const std::shared_future<void>& result : results)
+		{
+			result.get();
+		}
+	}
+
+	size_t StartupGraph::IndexOf(const std::string& name) const
+	{
+		for (size_t i = 0; i < m_phases.size(); ++i)
+		{
+			if (m_phases[i].Name == name)
+			{
+				return i;
+			}
+		}
+
+		throw std::logic_error("Unknown startup phase " + name);
+	}
+}
@@ -0,0 +1,58 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef STARTUP_GRAPH_H
+#define STARTUP_GRAPH_H
+
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mloader
+{
+	// Startup phases with dependencies between them. Every phase runs on its own thread as soon as all of its
+	// dependencies are done, so independent phases overlap
+	class StartupGraph
+	{
+		public:
+			using PhaseStartedCallback = std::function<void(const std::string& phase)>;
+			using PhaseFinishedCallback = std::function<void(const std::string& phase, double seconds)>;
+
+			// Dependencies have to be added before the phases which need them
+			void AddPhase(const std::string& name, const std::vector<std::string>& dependencies, std::function<void()> task);
+
+			// Runs all phases and waits until none is running anymore. If a phase throws, the phases depending on it are
+			// skipped and the first failure in the order the phases were added is rethrown. Callbacks are never called concurrently
+			void Run(const PhaseStartedCallback& onStarted, const PhaseFinishedCallback& onFinished);
+
+		private:
+			struct Phase
+			{
+				std::string Name;
+				std::vector<size_t> Dependencies;
+				std::function<void()> Task;
+			};
+
+			size_t IndexOf(const std::string& name) const;
+
+		private:
+			std::vector<Phase> m_phases;
+			std::mutex m_callbackMutex;
+	};
+}
+
+#endif // STARTUP_GRAPH_H
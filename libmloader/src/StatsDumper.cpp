@@ -0,0 +1,143 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "StatsDumper.h"
+#include <cstdio>
+#include <fstream>
+
+namespace mloader
+{
+	static void AppendMetric(std::string& out, const char* name, const char* type, const char* help, double value)
+	{
+		char line[256];
+		snprintf(line, sizeof(line), "# TYPE %s %s\n# HELP %s %s\n", name, type, name, help);
+		out += line;
+
+		// counters get the _total suffix on their sample
+		snprintf(line, sizeof(line), "%s%s %.17g\n", name, type[0] == 'c' ? "_total" : "", value);
+		out += line;
+	}
+
+	static void AppendActiveJobs(std::string& out, const MLoaderStats& stats)
+	{
+		out += "# TYPE mloader_active_jobs gauge\n# HELP mloader_active_jobs Jobs running right now.\n";
+
+		const std::pair<const char*, unsigned int> stages[] =
+		{
+			{ "download",	stats.ActiveDownloads },
+			{ "extract",	stats.ActiveExtractions },
+			{ "install",	stats.ActiveInstalls },
+			{ "hash",		stats.ActiveHashes }
+		};
+
+		for (const auto& [stage, active] : stages)
+		{
+			out += "mloader_active_jobs{stage=\"" + std::string(stage) + "\"} " + std::to_string(active) + "\n";
+		}
+	}
+
+	std::string FormatOpenMetrics(const MLoaderStats& stats)
+	{
+		std::string out;
+		AppendMetric(out, "mloader_uptime_seconds", "gauge", "Time since the context was created.", stats.UptimeSeconds);
+		AppendMetric(out, "mloader_queued_downloads", "gauge", "Titles waiting to be downloaded.", stats.QueuedDownloads);
+		AppendMetric(out, "mloader_queued_installs", "gauge", "Installs waiting, summed over all devices.", stats.QueuedInstalls);
+		AppendActiveJobs(out, stats);
+		AppendMetric(out, "mloader_downloaded_bytes", "counter", "Bytes downloaded.", static_cast<double>(stats.BytesDownloaded));
+		AppendMetric(out, "mloader_extracted_bytes", "counter", "Bytes of archives extracted.", static_cast<double>(stats.BytesExtracted));
+		AppendMetric(out, "mloader_pushed_bytes", "counter", "Bytes pushed to devices.", static_cast<double>(stats.BytesPushed));
+		AppendMetric(out, "mloader_downloads_finished", "counter", "Downloads finished, including failed ones.", static_cast<double>(stats.DownloadsFinished));
+		AppendMetric(out, "mloader_extractions_finished", "counter", "Extractions finished, including failed ones.", static_cast<double>(stats.ExtractionsFinished));
+		AppendMetric(out, "mloader_installs_finished", "counter", "Device installs finished, including failed ones.", static_cast<double>(stats.InstallsFinished));
+		AppendMetric(out, "mloader_download_bytes_per_second", "gauge", "Download rate of the last minute.", stats.DownloadBytesPerSecond);
+		AppendMetric(out, "mloader_download_average_bytes_per_second", "gauge", "Download rate while downloading.", stats.AverageDownloadBytesPerSecond);
+		AppendMetric(out, "mloader_extract_bytes_per_second", "gauge", "Extraction rate of the last minute.", stats.ExtractBytesPerSecond);
+		AppendMetric(out, "mloader_extract_average_bytes_per_second", "gauge", "Extraction rate while extracting.", stats.AverageExtractBytesPerSecond);
+		AppendMetric(out, "mloader_push_bytes_per_second", "gauge", "Current rate of all device transfers together.", stats.PushBytesPerSecond);
+		AppendMetric(out, "mloader_push_average_bytes_per_second", "gauge", "Device transfer rate while installing.", stats.AveragePushBytesPerSecond);
+		AppendMetric(out, "mloader_subprocesses_spawned", "counter", "Tool processes started.", static_cast<double>(stats.SubprocessesSpawned));
+		AppendMetric(out, "mloader_log_records_dropped", "counter", "Log records lost to a full log buffer.", static_cast<double>(stats.LogRecordsDropped));
+		AppendMetric(out, "mloader_catalog_games", "gauge", "Titles in the catalog.", stats.CatalogGames);
+		AppendMetric(out, "mloader_catalog_memory_bytes", "gauge", "Estimated memory of the catalog and its search index.", static_cast<double>(stats.CatalogMemoryBytes));
+		out += "# EOF\n";
+		return out;
+	}
+
+	StatsDumper::StatsDumper(const fs::path& file, StatsProvider provider)
+		:	m_file(file),
+			m_provider(std::move(provider)),
+			m_thread(&StatsDumper::DumpService, this)
+	{
+	}
+
+	StatsDumper::~StatsDumper()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_one();
+		m_thread.join();
+	}
+
+	void StatsDumper::SetInterval(std::chrono::seconds interval)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_interval = interval;
+		}
+		m_condition.notify_one();
+	}
+
+	void StatsDumper::DumpService()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_stop)
+		{
+			if (m_interval.count() <= 0)
+			{
+				m_condition.wait(lock);
+				continue;
+			}
+
+			const std::chrono::seconds interval = m_interval;
+			if (m_condition.wait_for(lock, interval, [this, interval]() { return m_stop || m_interval != interval; }))
+			{
+				continue;		// stopped or the interval changed, start waiting again
+			}
+
+			lock.unlock();
+			Dump();
+			lock.lock();
+		}
+	}
+
+	bool StatsDumper::Dump() const
+	{
+		const fs::path temporaryFile = m_file.string() + ".tmp";
+		{
+			std::ofstream file(temporaryFile, std::ios::out | std::ios::trunc);
+			if (!file.is_open())
+			{
+				return false;
+			}
+			file << FormatOpenMetrics(m_provider());
+		}
+
+		std::error_code error;
+		fs::rename(temporaryFile, m_file, error);
+		return !error;
+	}
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef STATS_DUMPER_H
+#define STATS_DUMPER_H
+
+#include <mloader/Stats.h>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace mloader
+{
+	std::string FormatOpenMetrics(const MLoaderStats& stats);
+
+	// Periodically writes the statistics to a file in the OpenMetrics text format. The file is replaced
+	// atomically, so scrapers never read a partial dump
+	class StatsDumper
+	{
+		public:
+			using StatsProvider = std::function<MLoaderStats()>;
+
+			StatsDumper(const fs::path& file, StatsProvider provider);
+			~StatsDumper();
+
+			void SetInterval(std::chrono::seconds interval);		// 0 stops dumping
+
+		private:
+			void DumpService();
+			bool Dump() const;
+
+		private:
+			fs::path m_file;
+			StatsProvider m_provider;
+
+			std::chrono::seconds m_interval{0};
+			bool m_stop = false;
+			std::mutex m_mutex;
+			std::condition_variable m_condition;
+			std::thread m_thread;
+	};
+}
+
+#endif // STATS_DUMPER_H
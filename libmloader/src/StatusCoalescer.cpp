@@ -0,0 +1,109 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "StatusCoalescer.h"
+
+namespace mloader
+{
+	StatusCoalescer::StatusCoalescer(FlushCallback flushCallback, std::chrono::milliseconds interval)
+		:	m_flushCallback(std::move(flushCallback)),
+			m_interval(interval)
+	{
+		m_flushThread = std::thread(&StatusCoalescer::FlushService, this);
+	}
+
+	StatusCoalescer::~StatusCoalescer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_all();
+
+		if (m_flushThread.joinable())
+		{
+			m_flushThread.join();
+		}
+	}
+
+	void StatusCoalescer::SetInterval(std::chrono::milliseconds interval)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_interval = interval;
+		}
+		m_condition.notify_all();
+	}
+
+	void StatusCoalescer::Mark(int index)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_pendingSet.insert(index).second)
+			{
+				return;		// already part of the next batch
+			}
+			m_pending.push_back(index);
+		}
+		m_condition.notify_all();
+	}
+
+	void StatusCoalescer::Remap(const std::vector<int>& indices)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		std::vector<int> pending;
+		pending.reserve(m_pending.size());
+		m_pendingSet.clear();
+		for (const int index : m_pending)
+		{
+			const int mapped = index >= 0 && index < static_cast<int>(indices.size()) ? indices[index] : -1;
+			if (mapped >= 0 && m_pendingSet.insert(mapped).second)
+			{
+				pending.push_back(mapped);
+			}
+		}
+		m_pending.swap(pending);
+	}
+
+	void StatusCoalescer::FlushService()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		while (!m_stop)
+		{
+			m_condition.wait(lock, [this]() { return m_stop || !m_pending.empty(); });
+
+			// the deadline is re-read on every wake up so a changed interval takes effect immediately
+			while (!m_stop && std::chrono::steady_clock::now() < m_lastFlush + m_interval)
+			{
+				m_condition.wait_until(lock, m_lastFlush + m_interval);
+			}
+
+			if (m_stop)
+			{
+				break;
+			}
+
+			std::vector<int> batch;
+			batch.swap(m_pending);
+			m_pendingSet.clear();
+
+			lock.unlock();
+			m_flushCallback(batch);
+			lock.lock();
+
+			m_lastFlush = std::chrono::steady_clock::now();
+		}
+	}
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef STATUS_COALESCER_H
+#define STATUS_COALESCER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace mloader
+{
+	// Merges status updates of the same app and hands them over in batches, at most once per interval.
+	// The first update after a quiet period is delivered right away, updates arriving within the interval after it wait for the next batch
+	class StatusCoalescer
+	{
+		public:
+			using FlushCallback = std::function<void(const std::vector<int>& indices)>;
+
+			StatusCoalescer(FlushCallback flushCallback, std::chrono::milliseconds interval);
+			~StatusCoalescer();
+			StatusCoalescer(const StatusCoalescer&) = delete;
+			StatusCoalescer& operator=(const StatusCoalescer&) = delete;
+
+			void SetInterval(std::chrono::milliseconds interval);
+			void Mark(int index);
+			void Remap(const std::vector<int>& indices);		// moves the pending updates to indices[index], those mapped to -1 are dropped. A batch which is being delivered right now keeps the old indices
+
+		private:
+			void FlushService();
+
+		private:
+			FlushCallback m_flushCallback;
+			std::chrono::milliseconds m_interval;
+			std::chrono::steady_clock::time_point m_lastFlush;
+
+			std::vector<int> m_pending;
+			std::unordered_set<int> m_pendingSet;
+			bool m_stop = false;
+
+			std::mutex m_mutex;
+			std::condition_variable m_condition;
+			std::thread m_flushThread;
+	};
+}
+
+#endif // STATUS_COALESCER_H
@@ -0,0 +1,111 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef STATUS_STRINGS_H
+#define STATUS_STRINGS_H
+
+#include <mloader/VrpApp.h>
+#include <array>
+#include <cstddef>
+
+namespace mloader
+{
+	namespace status_strings
+	{
+		static constexpr const char* LABELS[] =
+		{
+			"",						// NoInfo
+			"Download Queued",
+			"Downloading",
+			"Download Error",
+			"Extracting",
+			"Extracting Error",
+			"Downloaded",
+			"Install Queued",
+			"Installing",
+			"Installing Error",
+			"Installed",
+			"Update Available"
+		};
+
+		static constexpr size_t STATUS_COUNT = sizeof(LABELS) / sizeof(LABELS[0]);
+		static_assert(STATUS_COUNT == AppStatus::UpdateAvailable + 1, "every AppStatus needs a label");
+
+		static constexpr int MAX_PERCENT = 100;
+		static constexpr size_t STRING_CAPACITY = 24;	// longest entry is "Update Available (100%)"
+
+		using Entry = std::array<char, STRING_CAPACITY>;
+
+		// [status][0] is the bare label, [status][1 + percent] is "<label> (<percent>%)"
+		using Table = std::array<std::array<Entry, MAX_PERCENT + 2>, STATUS_COUNT>;
+
+		constexpr Entry Format(const char* label, int percent)
+		{
+			Entry entry{};
+			size_t length = 0;
+			for (const char* c = label; *c != '\0'; ++c)
+			{
+				entry[length++] = *c;
+			}
+
+			if (percent >= 0)
+			{
+				entry[length++] = ' ';
+				entry[length++] = '(';
+				if (percent >= 100)
+				{
+					entry[length++] = '0' + percent / 100;
+				}
+				if (percent >= 10)
+				{
+					entry[length++] = '0' + percent / 10 % 10;
+				}
+				entry[length++] = '0' + percent % 10;
+				entry[length++] = '%';
+				entry[length++] = ')';
+			}
+
+			return entry;
+		}
+
+		constexpr Table BuildTable()
+		{
+			Table table{};
+			for (size_t status = 0; status < STATUS_COUNT; ++status)
+			{
+				table[status][0] = Format(LABELS[status], -1);
+				for (int percent = 0; percent <= MAX_PERCENT; ++percent)
+				{
+					table[status][1 + percent] = Format(LABELS[status], percent);
+				}
+			}
+			return table;
+		}
+
+		inline constexpr Table TABLE = BuildTable();
+	}
+
+	// Returns the display string for a status, with the progress appended for downloads and installs.
+	// The string lives in a table built at compile time and must not be freed
+	constexpr const char* GetAppStatusString(AppStatus appStatus, int statusParam = -1)
+	{
+		const size_t status = static_cast<size_t>(appStatus) < status_strings::STATUS_COUNT ? static_cast<size_t>(appStatus) : 0;
+		const bool showProgress = (appStatus == AppStatus::Downloading || appStatus == AppStatus::Installing) && statusParam >= 0;
+		const int percent = statusParam > status_strings::MAX_PERCENT ? status_strings::MAX_PERCENT : statusParam;
+		return status_strings::TABLE[status][showProgress ? 1 + percent : 0].data();
+	}
+}
+
+#endif // STATUS_STRINGS_H
@@ -0,0 +1,71 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "ThreadPool.h"
+
+namespace mloader
+{
+	ThreadPool::ThreadPool(unsigned int numThreads)
+	{
+		for (unsigned int i = 0; i < numThreads; ++i)
+		{
+			m_workers.emplace_back(&ThreadPool::WorkerService, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_all();
+
+		for (std::thread& worker : m_workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::Submit(std::function<void()> task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_tasks.push_back(std::move(task));
+		}
+		m_condition.notify_one();
+	}
+
+	void ThreadPool::WorkerService()
+	{
+		while (true)
+		{
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_condition.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+				if (m_tasks.empty())
+				{
+					return;		// stopped and drained
+				}
+
+				task = std::move(m_tasks.front());
+				m_tasks.pop_front();
+			}
+
+			task();
+		}
+	}
+}
@@ -0,0 +1,52 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mloader
+{
+	// Fixed set of worker threads for the asynchronous C API calls. Tasks still queued when the pool is destroyed are run before it returns
+	class ThreadPool
+	{
+		public:
+			ThreadPool(unsigned int numThreads);
+			~ThreadPool();
+			ThreadPool(const ThreadPool&) = delete;
+			ThreadPool& operator=(const ThreadPool&) = delete;
+
+			void Submit(std::function<void()> task);
+
+		private:
+			void WorkerService();
+
+		private:
+			std::vector<std::thread> m_workers;
+			std::deque<std::function<void()>> m_tasks;
+			bool m_stop = false;
+
+			std::mutex m_mutex;
+			std::condition_variable m_condition;
+	};
+}
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,235 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "Tracer.h"
+#include "Logger.h"
+#include <algorithm>
+#include <fstream>
+#include <nlohmann/json.hpp>
+
+namespace mloader
+{
+	static thread_local std::string g_currentJob;
+
+	const char* GetTraceStageName(TraceStage stage)
+	{
+		static constexpr const char* STAGE_NAMES[] =
+		{
+			"metadata",
+			"hash",
+			"transfer",
+			"extract",
+			"install",
+			"apk_install",
+			"obb_push"
+		};
+		static_assert(std::size(STAGE_NAMES) == static_cast<size_t>(TraceStage::Count));
+
+		return STAGE_NAMES[static_cast<size_t>(stage)];
+	}
+
+	Tracer::Span::Span(Tracer* tracer, TraceStage stage, const std::string& job, const std::string& device)
+		:	m_tracer(tracer),
+			m_stage(stage),
+			m_job(job.empty() ? Tracer::GetCurrentJob() : job),
+			m_device(device),
+			m_start(std::chrono::steady_clock::now())
+	{
+		if (m_tracer)
+		{
+			m_tracer->m_activeSpans[static_cast<size_t>(m_stage)].fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	Tracer::Span::Span(Span&& other) noexcept
+		:	m_tracer(other.m_tracer),
+			m_stage(other.m_stage),
+			m_job(std::move(other.m_job)),
+			m_device(std::move(other.m_device)),
+			m_bytes(other.m_bytes),
+			m_failed(other.m_failed),
+			m_start(other.m_start)
+	{
+		other.m_tracer = nullptr;
+	}
+
+	Tracer::Span::~Span()
+	{
+		if (m_tracer)
+		{
+			m_tracer->m_activeSpans[static_cast<size_t>(m_stage)].fetch_sub(1, std::memory_order_relaxed);
+			m_tracer->Record({ m_stage, std::move(m_job), std::move(m_device), m_bytes, m_failed, m_start, std::chrono::steady_clock::now() - m_start });
+		}
+	}
+
+	void Tracer::Span::AddBytes(uint64_t bytes)
+	{
+		m_bytes += bytes;
+	}
+
+	void Tracer::Span::SetFailed(bool failed)
+	{
+		m_failed = failed;
+	}
+
+	Tracer::JobScope::JobScope(const std::string& job)
+		:	m_previousJob(g_currentJob)
+	{
+		g_currentJob = job;
+	}
+
+	Tracer::JobScope::~JobScope()
+	{
+		g_currentJob = std::move(m_previousJob);
+	}
+
+	Tracer::Tracer()
+		:	m_start(std::chrono::steady_clock::now())
+	{
+	}
+
+	void Tracer::SetLogger(Logger* logger)
+	{
+		m_logger = logger;
+	}
+
+	const std::string& Tracer::GetCurrentJob()
+	{
+		return g_currentJob;
+	}
+
+	void Tracer::Record(SpanRecord&& record)
+	{
+		const double seconds = std::chrono::duration<double>(record.Duration).count();
+
+		if (m_logger)
+		{
+			// hashes are looked up for every title at once, they are only interesting when debugging
+			const LogLevel level = record.Failed ? LogLevel::Warning : (record.Stage == TraceStage::Hash ? LogLevel::Debug : LogLevel::Info);
+			const LogFields fields{ GetTraceStageName(record.Stage), record.Job, record.Device, static_cast<int64_t>(record.Bytes), seconds };
+			m_logger->Log(level, "Tracer", record.Failed ? "Stage failed" : "Stage finished", fields);
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		StageSummary& summary = m_summary[static_cast<size_t>(record.Stage)];
+		++summary.Count;
+		summary.Bytes += record.Bytes;
+		summary.TotalSeconds += seconds;
+		summary.MaxSeconds = std::max(summary.MaxSeconds, seconds);
+
+		if (m_records.size() == MAX_RECORDS)
+		{
+			m_records.pop_front();
+		}
+		m_records.push_back(std::move(record));
+	}
+
+	std::array<Tracer::StageSummary, static_cast<size_t>(TraceStage::Count)> Tracer::GetSummary() const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return m_summary;
+	}
+
+	std::array<unsigned int, static_cast<size_t>(TraceStage::Count)> Tracer::GetActiveSpans() const
+	{
+		std::array<unsigned int, static_cast<size_t>(TraceStage::Count)> active;
+		for (size_t i = 0; i < active.size(); ++i)
+		{
+			active[i] = m_activeSpans[i].load(std::memory_order_relaxed);
+		}
+		return active;
+	}
+
+	std::array<double, static_cast<size_t>(TraceStage::Count)> Tracer::GetRecentThroughput(std::chrono::steady_clock::duration window) const
+	{
+		std::array<double, static_cast<size_t>(TraceStage::Count)> throughput{};
+		const std::chrono::steady_clock::time_point windowStart = std::chrono::steady_clock::now() - window;
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto it = m_records.rbegin(); it != m_records.rend(); ++it)		// records are in the order the spans ended
+		{
+			const std::chrono::steady_clock::time_point end = it->Start + it->Duration;
+			if (end < windowStart)
+			{
+				break;
+			}
+
+			if (it->Bytes == 0 || it->Duration.count() <= 0)
+			{
+				continue;
+			}
+
+			const std::chrono::steady_clock::duration inside = end - std::max(it->Start, windowStart);
+			throughput[static_cast<size_t>(it->Stage)] += static_cast<double>(it->Bytes) * inside.count() / it->Duration.count();
+		}
+
+		const double windowSeconds = std::chrono::duration<double>(window).count();
+		for (double& bytes : throughput)
+		{
+			bytes /= windowSeconds;
+		}
+		return throughput;
+	}
+
+	bool Tracer::ExportChromeTrace(const fs::path& file) const
+	{
+		// Trace event format, complete events ("ph": "X") with microsecond timestamps.
+		// Every job gets its own row so the stages of a title line up
+		nlohmann::json events = nlohmann::json::array();
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			std::unordered_map<std::string, int> jobRows;
+			for (const SpanRecord& record : m_records)
+			{
+				auto row = jobRows.emplace(record.Job, static_cast<int>(jobRows.size()) + 1).first;
+
+				nlohmann::json args = { { "job", record.Job }, { "bytes", record.Bytes } };
+				if (!record.Device.empty())
+				{
+					args["device"] = record.Device;
+				}
+				if (record.Failed)
+				{
+					args["failed"] = true;
+				}
+
+				events.push_back({
+					{ "name", GetTraceStageName(record.Stage) },
+					{ "cat", "mloader" },
+					{ "ph", "X" },
+					{ "ts", std::chrono::duration_cast<std::chrono::microseconds>(record.Start - m_start).count() },
+					{ "dur", std::chrono::duration_cast<std::chrono::microseconds>(record.Duration).count() },
+					{ "pid", 1 },
+					{ "tid", row->second },
+					{ "args", std::move(args) }
+				});
+			}
+
+			for (const auto& [job, row] : jobRows)
+			{
+				events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", row }, { "args", { { "name", job.empty() ? "other" : job } } } });
+			}
+		}
+
+		std::ofstream output(file, std::ios::out | std::ios::trunc);
+		if (!output.is_open())
+		{
+			return false;
+		}
+
+		output << nlohmann::json{ { "traceEvents", std::move(events) }, { "displayTimeUnit", "ms" } }.dump();
+		return output.good();
+	}
+}
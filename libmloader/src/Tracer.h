@@ -0,0 +1,134 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace mloader
+{
+	class Logger;
+
+	enum class TraceStage
+	{
+		Metadata,
+		Hash,
+		Transfer,		// rclone download
+		Extract,
+		Install,		// whole install job on one device
+		ApkInstall,
+		ObbPush,
+		Count
+	};
+
+	const char* GetTraceStageName(TraceStage stage);
+
+	// Records timed spans of the acquire and install pipeline. Spans are kept in a bounded buffer for trace export,
+	// the per stage aggregates cover everything since the tracer was created
+	class Tracer
+	{
+		public:
+			struct StageSummary
+			{
+				uint64_t Count = 0;
+				uint64_t Bytes = 0;
+				double TotalSeconds = 0.0;
+				double MaxSeconds = 0.0;
+			};
+
+			// Ends when destroyed. A span created without a tracer records nothing
+			class Span
+			{
+				public:
+					Span(Tracer* tracer, TraceStage stage, const std::string& job, const std::string& device = "");
+					~Span();
+					Span(Span&& other) noexcept;
+					Span(const Span&) = delete;
+					Span& operator=(const Span&) = delete;
+					Span& operator=(Span&&) = delete;
+
+					void AddBytes(uint64_t bytes);
+					void SetFailed(bool failed = true);
+
+				private:
+					Tracer* m_tracer;
+					TraceStage m_stage;
+					std::string m_job;
+					std::string m_device;
+					uint64_t m_bytes = 0;
+					bool m_failed = false;
+					std::chrono::steady_clock::time_point m_start;
+			};
+
+			// Spans started on this thread without an explicit job are attributed to the current job scope
+			class JobScope
+			{
+				public:
+					JobScope(const std::string& job);
+					~JobScope();
+
+				private:
+					std::string m_previousJob;
+			};
+
+			Tracer();
+
+			void SetLogger(Logger* logger);		// finished spans are also logged as structured records, with the stage as event
+			static const std::string& GetCurrentJob();
+
+			bool ExportChromeTrace(const fs::path& file) const;
+			std::array<StageSummary, static_cast<size_t>(TraceStage::Count)> GetSummary() const;
+			std::array<unsigned int, static_cast<size_t>(TraceStage::Count)> GetActiveSpans() const;
+			// Bytes per second of the spans which finished within the window, a span counts with the part of it inside the window
+			std::array<double, static_cast<size_t>(TraceStage::Count)> GetRecentThroughput(std::chrono::steady_clock::duration window) const;
+
+		private:
+			struct SpanRecord
+			{
+				TraceStage Stage;
+				std::string Job;
+				std::string Device;
+				uint64_t Bytes;
+				bool Failed;
+				std::chrono::steady_clock::time_point Start;
+				std::chrono::steady_clock::duration Duration;
+			};
+
+			void Record(SpanRecord&& record);
+
+		private:
+			std::chrono::steady_clock::time_point m_start;
+			Logger* m_logger = nullptr;
+			std::deque<SpanRecord> m_records;
+			std::array<StageSummary, static_cast<size_t>(TraceStage::Count)> m_summary;
+			std::array<std::atomic<unsigned int>, static_cast<size_t>(TraceStage::Count)> m_activeSpans{};
+			mutable std::mutex m_mutex;
+
+			static constexpr size_t MAX_RECORDS = 16384;
+	};
+}
+
+#endif // TRACER_H
@@ -16,13 +16,61 @@
 #ifndef UTILITY_H
 #define UTILITY_H
 
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
 #include <sstream>
 #include <stdlib.h>
 #include <string>
 #include <vector>
 
+#ifdef __APPLE__
+	#include <pthread.h>
+#elif __linux__
+	#include <sys/resource.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
 namespace mloader
 {
+	// Receives a chunk of streamed data, returning false aborts the stream
+	using StreamSink = std::function<bool(const char* data, size_t size)>;
+
+	inline std::atomic<uint64_t> g_spawnedProcesses{0};
+
+	// popen, counting the processes started for the runtime statistics
+	inline FILE* ProcessOpen(const char* command, const char* mode)
+	{
+		g_spawnedProcesses.fetch_add(1, std::memory_order_relaxed);
+		return popen(command, mode);
+	}
+
+	inline uint64_t GetSpawnedProcessCount()
+	{
+		return g_spawnedProcesses.load(std::memory_order_relaxed);
+	}
+
+	// Quotes an argument for a POSIX shell, e.g. for commands executed on the device
+	inline std::string QuoteShellArgument(const std::string& argument)
+	{
+		std::string quoted = "'";
+		for (char c : argument)
+		{
+			if (c == '\'')
+			{
+				quoted += "'\\''";
+			}
+			else
+			{
+				quoted += c;
+			}
+		}
+		quoted += "'";
+		return quoted;
+	}
+
 	template<typename... T>
 	inline int ExecShellWithCallback(std::function<void(const std::string&)> callback, const T&... args)
 	{
@@ -37,7 +85,7 @@ namespace mloader
 		stream << arguments.back();
 
 		std::string command = stream.str();
-		FILE* fp = popen(command.c_str(), "r");
+		FILE* fp = ProcessOpen(command.c_str(), "r");
 
 		if (fp == NULL)
 		{
@@ -62,6 +110,22 @@ namespace mloader
 	{
 		return ExecShellWithCallback(nullptr, args...);
 	}
+
+	// Lowers CPU and I/O scheduling priority of the calling thread, used by housekeeping threads
+	inline void SetCurrentThreadBackgroundPriority()
+	{
+	#ifdef __APPLE__
+		pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+	#elif __linux__
+		// on linux nice values and io priorities apply to the calling thread only
+		constexpr int IOPRIO_WHO_PROCESS = 1;
+		constexpr int IOPRIO_CLASS_IDLE = 3;
+		constexpr int IOPRIO_CLASS_SHIFT = 13;
+		const pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+		setpriority(PRIO_PROCESS, tid, 19);
+		syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+	#endif
+	}
 }
 
 #endif // UTILITY_H
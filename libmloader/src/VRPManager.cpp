@@ -18,6 +18,7 @@
 #include "7z.h"
 #include "Logger.h"
 #include "md5.h"
+#include "Tracer.h"
 #include <nlohmann/json.hpp>
 #include <filesystem>
 #include "curl_global.h"
@@ -30,22 +31,23 @@
 
 namespace mloader
 {
+	// Statuses which aren't derived from the files on disk or the packages on the device
+	static bool IsJobStatus(AppStatus status)
+	{
+		return status != AppStatus::NoInfo && status != AppStatus::Downloaded && status != AppStatus::Installed && status != AppStatus::UpdateAvailable;
+	}
+
 	VRPManager::VRPManager(const RClone& rclone, const Zip& zip, const fs::path& cacheDir, const fs::path& downloadDir, Logger& logger, std::function<void(const GameInfo&, const AppStatus, const int)> gameStatusChangedCallback)
 	:	m_rClone(rclone),
 		m_zip(zip),
 		m_cacheDir(cacheDir),
 		m_downloadDir(downloadDir),
+		m_catalog(std::make_shared<const GameCatalog>(std::vector<std::pair<GameInfo, AppStatus>>())),
+		m_searchIndex(std::make_shared<const SearchIndex>(m_catalog, nullptr)),
 		m_logger(logger),
 		m_gameStatusChangedCallback(gameStatusChangedCallback)
 	{
-		std::string error{""};
-
-		if (!CheckVRPPublicCredentials())
-		{
-			error = "Unable to download vrp-public.json from VRP";
-			throw std::runtime_error(error);
-		}
-
+		// vrp-public.json is fetched by FetchPublicCredentials before the manager is created
 		if (!LoadVRPPublicCredentials())
 		{
 			throw std::runtime_error("vrp-public file is not found. No internet connection or the server is not available.");
@@ -64,12 +66,30 @@ namespace mloader
 
 	AppStatus VRPManager::GetGameStatus(const GameInfo& gameInfo) const
 	{
-		return m_gameList.at(gameInfo);
+		std::shared_ptr<const GameCatalog> catalog = GetCatalog();
+		std::optional<size_t> index = catalog->IndexOf(gameInfo);
+		return index ? catalog->GetStatus(*index) : AppStatus::NoInfo;
 	}
 
 	void VRPManager::UpdateGameStatus(const GameInfo& gameInfo, AppStatus newStatus, int statusParam)
 	{
-		m_gameList[gameInfo] = newStatus;
+		AppStatus previousStatus;
+		{
+			std::shared_lock<std::shared_mutex> lock(m_statusMutex);
+			std::shared_ptr<const GameCatalog> catalog = GetCatalog();
+			std::optional<size_t> index = catalog->IndexOf(gameInfo);
+			if (!index)
+			{
+				return;		// the game is gone after a metadata refresh
+			}
+
+			previousStatus = catalog->ExchangeStatus(*index, newStatus);
+		}
+
+		if (previousStatus == newStatus && statusParam < 0)
+		{
+			return;		// only progress updates are reported again
+		}
 
 		if (m_gameStatusChangedCallback)
 		{
@@ -77,8 +97,14 @@ namespace mloader
 		}
 	}
 
+	void VRPManager::SetTracer(Tracer* tracer)
+	{
+		m_tracer = tracer;
+	}
+
 	bool VRPManager::RefreshMetadata(bool forceRedownload)
 	{
+		Tracer::Span span(m_tracer, TraceStage::Metadata, "metadata");
 		m_logger.LogInfo(LOG_NAME, "Refreshing metdata");
 		fs::path metaFile = m_cacheDir / "meta.7z";
 		fs::path metaDir = m_cacheDir / "metadata";
@@ -109,8 +135,46 @@ namespace mloader
 			return false;
 		}
 
+		return LoadGameList(gameListFile, true);
+	}
+
+	bool VRPManager::LoadCachedMetadata()
+	{
+		Tracer::Span span(m_tracer, TraceStage::Metadata, "cached metadata");
+		const fs::path gameListFile = m_cacheDir / "metadata" / "VRP-GameList.txt";
+
+		if (!fs::exists(gameListFile))
+		{
+			return false;
+		}
+
+		try
+		{
+			return LoadGameList(gameListFile, false);
+		}
+		catch(const std::exception& e)
+		{
+			m_logger.LogError(LOG_NAME, std::string("Unable to load the cached game list: ") + e.what());
+			return false;
+		}
+	}
+
+	void VRPManager::RebuildSearchIndex()
+	{
+		std::shared_ptr<const GameCatalog> catalog = GetCatalog();
+		std::atomic_store(&m_searchIndex, std::make_shared<const SearchIndex>(catalog, [this](const GameInfo& game)
+		{
+			return GetAppNote(game);
+		}));
+	}
+
+	bool VRPManager::LoadGameList(const fs::path& gameListFile, bool buildSearchIndex)
+	{
 		// refresh game list
-		m_gameList.clear();
+		{
+			std::lock_guard<std::mutex> lock(m_downloadedGamesMutex);
+			m_downloadedGames.clear();
+		}
 
 		std::ifstream file(gameListFile);
 
@@ -119,6 +183,7 @@ namespace mloader
 			return false;
 		}
 
+		std::vector<std::pair<GameInfo, AppStatus>> games;
 		std::vector<std::string> csvRows;
 		std::string line;
 
@@ -131,52 +196,85 @@ namespace mloader
 
 		for(const std::string& line : csvRows)
 		{
-			std::stringstream ss(line);
-			std::string item;
-			GameInfo info;
+			GameInfo info = ParseGameListRow(line);
 
-			std::getline(ss, item, ';');
-			info.GameName = std::move(item);
+			AppStatus appStatus = AppStatus::NoInfo;
+			if (GameInstalled(info))
+			{
+				appStatus = AppStatus::Downloaded;
+				std::lock_guard<std::mutex> lock(m_downloadedGamesMutex);
+				m_downloadedGames.insert(info.ReleaseName);
+			}
+			games.emplace_back(std::move(info), appStatus);
+		}
 
-			std::getline(ss, item, ';');
-			info.ReleaseName = std::move(item);
+		std::shared_ptr<const GameCatalog> catalog = std::make_shared<const GameCatalog>(std::move(games));
+		{
+			// downloads and installs keep running across a refresh, their titles take the status over into the new catalog
+			std::unique_lock<std::shared_mutex> lock(m_statusMutex);
+			std::shared_ptr<const GameCatalog> previous = GetCatalog();
+			for (size_t i = 0; i < catalog->GetSize(); ++i)
+			{
+				std::optional<size_t> previousIndex = previous->IndexOf(catalog->GetGame(i));
+				if (previousIndex && IsJobStatus(previous->GetStatus(*previousIndex)))
+				{
+					catalog->ExchangeStatus(i, previous->GetStatus(*previousIndex));
+				}
+			}
+			std::atomic_store(&m_catalog, catalog);
+		}
+		if (buildSearchIndex)
+		{
+			RebuildSearchIndex();
+		}
+		m_logger.LogInfo(LOG_NAME, "Loaded " + std::to_string(catalog->GetSize()) + " games from " + gameListFile.filename().string());
+		return true;
+	}
 
-			std::getline(ss, item, ';');
-			info.PackageName = std::move(item);
+	GameInfo VRPManager::ParseGameListRow(const std::string& row)
+	{
+		std::stringstream ss(row);
+		std::string item;
+		GameInfo info;
 
-			std::getline(ss, item, ';');
-			info.VersionCode = std::stoi(item);
+		std::getline(ss, item, ';');
+		info.GameName = std::move(item);
 
-			std::getline(ss, item, ';');
-			info.LastUpdated = std::move(item);
+		std::getline(ss, item, ';');
+		info.ReleaseName = std::move(item);
 
-			std::getline(ss, item, ';');
-			info.SizeMB = std::stoi(item);;
+		std::getline(ss, item, ';');
+		info.PackageName = std::move(item);
 
-			std::getline(ss, item, ';');
-			info.Downloads = std::stof(item);
+		std::getline(ss, item, ';');
+		info.VersionCode = std::stoi(item);
 
-			std::getline(ss, item, ';');
-			info.Rating = std::stof(item);;
+		std::getline(ss, item, ';');
+		info.LastUpdated = std::move(item);
 
-			std::getline(ss, item, ';');
-			info.RatingCount = std::stoi(item);
+		std::getline(ss, item, ';');
+		info.SizeMB = std::stoi(item);;
 
-			AppStatus appStatus = AppStatus::NoInfo;
-			if (GameInstalled(info))
-			{
-				appStatus = AppStatus::Downloaded;
-			}
-			m_gameList.emplace(std::move(info), appStatus);
-		}
+		std::getline(ss, item, ';');
+		info.Downloads = std::stof(item);
 
-		m_logger.LogInfo(LOG_NAME, "Loaded " + std::to_string(m_gameList.size()) + " games from the meta file");
-		return true;
+		std::getline(ss, item, ';');
+		info.Rating = std::stof(item);;
+
+		std::getline(ss, item, ';');
+		info.RatingCount = std::stoi(item);
+
+		return info;
 	}
 
-	const std::map<GameInfo, AppStatus>& VRPManager::GetGameList() const
+	std::shared_ptr<const GameCatalog> VRPManager::GetCatalog() const
 	{
-		return m_gameList;
+		return std::atomic_load(&m_catalog);
+	}
+
+	std::shared_ptr<const SearchIndex> VRPManager::GetSearchIndex() const
+	{
+		return std::atomic_load(&m_searchIndex);
 	}
 
 	static fs::path findFirstFileWithExtension(const fs::path& dirPath, const std::string& extension) {
@@ -188,12 +286,63 @@ namespace mloader
 		return ""; // Return an empty path if no file is found
 	}
 
+	static uint64_t getDirectorySize(const fs::path& dirPath) {
+		uint64_t size = 0;
+		std::error_code ec;
+		for (const auto& entry : fs::recursive_directory_iterator(dirPath, ec)) {
+			if (entry.is_regular_file(ec)) {
+				size += entry.file_size(ec);
+			}
+		}
+		return size;
+	}
+
 	void VRPManager::DownloadGame(const GameInfo& game)
 	{
-		if (m_gameList[game] != AppStatus::NoInfo && m_gameList[game] != AppStatus::DownloadError && m_gameList[game] != AppStatus::DownloadQueued)
+		if (!DownloadGameArchive(game))
+		{
+			return;
+		}
+
+		UpdateGameStatus(game, AppStatus::Extracting);
+		// find the first .7z file in the temp download dir
+		fs::path zipFile = GetGameArchiveFile(game);
+
+		if (zipFile.empty())
+		{
+			SetArchiveDirectoryActive(game, false);
+			UpdateGameStatus(game, AppStatus::ExtractingError);
+			std::string errMessage = "Unable to locate zip to extract " + std::string(game.ReleaseName);
+			m_logger.LogError(LOG_NAME, errMessage);
+			throw std::runtime_error(errMessage);
+		}
+		Tracer::Span extractSpan(m_tracer, TraceStage::Extract, game.ReleaseName);
+		extractSpan.AddBytes(getDirectorySize(zipFile.parent_path()));
+		if (m_zip.Unzip7z(zipFile, m_downloadDir, m_password))
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_downloadedGamesMutex);
+				m_downloadedGames.insert(game.ReleaseName);
+			}
+			UpdateGameStatus(game, AppStatus::Downloaded);
+			// cleanup if download was successful
+			DeleteGameArchive(game);
+		}
+		else
+		{
+			extractSpan.SetFailed();
+			SetArchiveDirectoryActive(game, false);
+			UpdateGameStatus(game, AppStatus::ExtractingError);
+		}
+	}
+
+	bool VRPManager::DownloadGameArchive(const GameInfo& game)
+	{
+		const AppStatus status = GetGameStatus(game);
+		if (status != AppStatus::NoInfo && status != AppStatus::DownloadError && status != AppStatus::DownloadQueued)
 		{
-			m_logger.LogError(LOG_NAME, std::string("Refusing to start download. App status is ") + std::to_string(m_gameList[game]) + std::string(". It should be NoInfo, DownloadError or DownloadQueued"));
-			return; // or throw
+			m_logger.LogError(LOG_NAME, std::string("Refusing to start download. App status is ") + std::to_string(status) + std::string(". It should be NoInfo, DownloadError or DownloadQueued"));
+			return false; // or throw
 		}
 
 		m_logger.LogInfo(LOG_NAME, "Starting download: " + std::string(game.ReleaseName));
@@ -202,49 +351,30 @@ namespace mloader
 		// Download progress callback
 		auto downloadProgressCallbackFunc = [this, game](uint8_t progress) -> void
 		{
+			if (m_logger.IsEnabled(LogLevel::Debug))
+			{
+				m_logger.Log(LogLevel::Debug, LOG_NAME, "Download progress " + std::to_string(progress) + "%", LogFields{ .Event = "download_progress", .Job = game.ReleaseName });
+			}
+
 			if (this->m_gameStatusChangedCallback)
 			{
 				UpdateGameStatus(game, AppStatus::Downloading, static_cast<int>(progress));
 			}
 		};
 
-		const std::string gameHash = CalculateGameMD5Hash(game.ReleaseName);
-		if (m_rClone.CopyFile(m_baseUri, gameHash, m_cacheDir, downloadProgressCallbackFunc))
-		{
-			UpdateGameStatus(game, AppStatus::Extracting);
-			// find the first .7z file in the temp download dir
-			fs::path zippedDirectory = m_cacheDir / fs::path(gameHash);
-			fs::path zipFile = findFirstFileWithExtension(zippedDirectory, ".001");
-
-			if (zipFile.empty())
-			{
-				UpdateGameStatus(game, AppStatus::ExtractingError);
-				std::string errMessage = "Unable to locate zip to extract " + std::string(game.ReleaseName);
-				m_logger.LogError(LOG_NAME, errMessage);
-				throw std::runtime_error(errMessage);
-			}
-			if (m_zip.Unzip7z(zipFile, m_downloadDir, m_password))
-			{
-				UpdateGameStatus(game, AppStatus::Downloaded);
-				try
-				{
-					// cleanup if download was successful
-					fs::remove_all(zippedDirectory);
-				}
-				catch(fs::filesystem_error& error)
-				{
-					m_logger.LogError(LOG_NAME, "Unable to remove directory " + std::string(zippedDirectory) + " " + std::string(error.what()));
-				}
-			}
-			else
-			{
-				UpdateGameStatus(game, AppStatus::ExtractingError);
-			}
-		}
-		else
+		SetArchiveDirectoryActive(game, true);
+		Tracer::Span span(m_tracer, TraceStage::Transfer, game.ReleaseName);
+		if (!m_rClone.CopyFile(m_baseUri, GetGameHash(game), m_cacheDir, downloadProgressCallbackFunc))
 		{
+			span.SetFailed();
+			// leave the partial download to the cache manager
+			SetArchiveDirectoryActive(game, false);
 			UpdateGameStatus(game, AppStatus::DownloadError);
+			return false;
 		}
+
+		span.AddBytes(getDirectorySize(m_cacheDir / GetGameHash(game)));
+		return true;
 	}
 
 	void VRPManager::DeleteGame(const GameInfo& game)
@@ -261,11 +391,30 @@ namespace mloader
 		{
 			if (fs::remove_all(gameDir) > 0)
 			{
+				{
+					std::lock_guard<std::mutex> lock(m_downloadedGamesMutex);
+					m_downloadedGames.erase(game.ReleaseName);
+				}
 				UpdateGameStatus(game, AppStatus::NoInfo);
 			}
 		}
 	}
 
+	void VRPManager::DeleteGameArchive(const GameInfo& game)
+	{
+		const fs::path zippedDirectory = m_cacheDir / fs::path(GetGameHash(game));
+		try
+		{
+			fs::remove_all(zippedDirectory);
+		}
+		catch(fs::filesystem_error& error)
+		{
+			m_logger.LogError(LOG_NAME, "Unable to remove directory " + std::string(zippedDirectory) + " " + std::string(error.what()));
+		}
+
+		SetArchiveDirectoryActive(game, false);
+	}
+
 	std::string VRPManager::GetAppThumbImage(const GameInfo& game) const
 	{
 		const fs::path metaDir = m_cacheDir / "metadata/.meta/thumbnails/";
@@ -325,6 +474,12 @@ namespace mloader
 		return fs::exists(manifestFile);
 	}
 
+	bool VRPManager::GameDownloaded(const GameInfo& game) const
+	{
+		std::lock_guard<std::mutex> lock(m_downloadedGamesMutex);
+		return m_downloadedGames.contains(game.ReleaseName);
+	}
+
 	std::vector<fs::path> VRPManager::GetGameFileList(const GameInfo& game) const
 	{
 		if (!GameInstalled(game))
@@ -364,10 +519,93 @@ namespace mloader
 		return files;
 	}
 
-	bool VRPManager::CheckVRPPublicCredentials()
+	std::vector<ArchiveEntry> VRPManager::GetGameArchiveFileList(const GameInfo& game) const
+	{
+		const fs::path archiveFile = GetGameArchiveFile(game);
+		if (archiveFile.empty())
+		{
+			throw std::runtime_error("Unable to locate a downloaded archive for " + game.ReleaseName);
+		}
+
+		// Archives contain the same layout as the extracted game directory:
+		// <ReleaseName>/*.apk and <ReleaseName>/<PackageName>/*.obb
+		std::vector<ArchiveEntry> apkFiles;
+		std::vector<ArchiveEntry> obbFiles;
+		for (ArchiveEntry& entry : m_zip.ListArchive(archiveFile, m_password))
+		{
+			const fs::path parentDirectory = entry.Path.parent_path();
+			if (entry.Path.extension() == ".apk" && parentDirectory.parent_path().empty())
+			{
+				apkFiles.push_back(std::move(entry));
+			}
+			else if (entry.Path.extension() == ".obb" && parentDirectory.filename() == game.PackageName)
+			{
+				obbFiles.push_back(std::move(entry));
+			}
+		}
+
+		if (apkFiles.empty() && obbFiles.empty())
+		{
+			throw std::runtime_error("Archive " + archiveFile.string() + " does not contain any installable files");
+		}
+
+		apkFiles.insert(apkFiles.end(), std::make_move_iterator(obbFiles.begin()), std::make_move_iterator(obbFiles.end()));
+		return apkFiles;
+	}
+
+	bool VRPManager::ReadGameArchiveFile(const GameInfo& game, const ArchiveEntry& entry, const StreamSink& sink) const
+	{
+		return m_zip.ExtractFileToStream(GetGameArchiveFile(game), entry.Path, sink, m_password);
+	}
+
+	std::vector<fs::path> VRPManager::GetActiveArchiveDirectories() const
+	{
+		std::lock_guard<std::mutex> lock(m_activeArchiveDirectoriesMutex);
+		return std::vector<fs::path>(m_activeArchiveDirectories.cbegin(), m_activeArchiveDirectories.cend());
+	}
+
+	void VRPManager::SetArchiveDirectoryActive(const GameInfo& game, bool active)
+	{
+		const fs::path archiveDirectory = m_cacheDir / GetGameHash(game);
+
+		std::lock_guard<std::mutex> lock(m_activeArchiveDirectoriesMutex);
+		if (active)
+		{
+			m_activeArchiveDirectories.insert(archiveDirectory);
+		}
+		else
+		{
+			m_activeArchiveDirectories.erase(archiveDirectory);
+		}
+	}
+
+	std::string VRPManager::GetGameHash(const GameInfo& game) const
+	{
+		std::lock_guard<std::mutex> lock(m_gameHashCacheMutex);
+		auto it = m_gameHashCache.find(game.ReleaseName);
+		if (it == m_gameHashCache.end())
+		{
+			Tracer::Span span(m_tracer, TraceStage::Hash, game.ReleaseName);
+			it = m_gameHashCache.emplace(game.ReleaseName, CalculateGameMD5Hash(game.ReleaseName)).first;
+		}
+		return it->second;
+	}
+
+	fs::path VRPManager::GetGameArchiveFile(const GameInfo& game) const
+	{
+		const fs::path zippedDirectory = m_cacheDir / fs::path(GetGameHash(game));
+		if (!fs::is_directory(zippedDirectory))
+		{
+			return "";
+		}
+
+		return findFirstFileWithExtension(zippedDirectory, ".001");
+	}
+
+	bool VRPManager::FetchPublicCredentials(const fs::path& cacheDir)
 	{
 		static const std::string vrppublic = "https://vrpirates.wiki/downloads/vrp-public.json";
-		static const fs::path filePath = m_cacheDir / "vrp-public.json";
+		const fs::path filePath = cacheDir / "vrp-public.json";
 
 		if (!fs::exists(filePath))
 		{
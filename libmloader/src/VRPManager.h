@@ -17,11 +17,19 @@
 #define MLOADER_H
 
 #include "model/GameInfo.h"
+#include "GameCatalog.h"
+#include "SearchIndex.h"
+#include "7z.h"
 #include <mloader/VrpApp.h>
 #include <filesystem>
 #include <functional>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 namespace fs = std::filesystem;
@@ -29,8 +37,8 @@ namespace fs = std::filesystem;
 namespace mloader
 {
 	class RClone;
-	class Zip;
 	class Logger;
+	class Tracer;
 
 	class VRPManager
 	{
@@ -38,22 +46,42 @@ namespace mloader
 			VRPManager(const RClone& rclone, const Zip& zip, const fs::path& cacheDir, const fs::path& downloadDir, Logger& logger, std::function<void(const GameInfo&, const AppStatus, const int)> gameStatusChangedCallback = nullptr);
 			~VRPManager();
 
+			// Downloads vrp-public.json into the cache directory unless it's there already. Doesn't need a VRPManager,
+			// so the credentials can be fetched while the tools are still being set up
+			static bool FetchPublicCredentials(const fs::path& cacheDir);
+			static GameInfo ParseGameListRow(const std::string& row);		// one line of VRP-GameList.txt, throws std::invalid_argument on malformed numbers
+
+			void SetTracer(Tracer* tracer);
 			bool RefreshMetadata(bool forceRedownload = false);
+			// Publishes the game list extracted by an earlier run without downloading or extracting anything.
+			// The search index isn't rebuilt, call RefreshMetadata or RebuildSearchIndex afterwards
+			bool LoadCachedMetadata();
+			void RebuildSearchIndex();
 
-			const std::map<GameInfo, AppStatus>& GetGameList() const;
+			std::shared_ptr<const GameCatalog> GetCatalog() const;		// snapshot, safe to keep using while the metadata is refreshed
+			std::shared_ptr<const SearchIndex> GetSearchIndex() const;	// built together with the catalog
 			AppStatus GetGameStatus(const GameInfo& gameInfo) const;
 			void UpdateGameStatus(const GameInfo& gameInfo, AppStatus newStatus, int statusParam = -1);
 			void DownloadGame(const GameInfo& game);
+			bool DownloadGameArchive(const GameInfo& game);
 			void DeleteGame(const GameInfo& game);
+			void DeleteGameArchive(const GameInfo& game);
 			std::string GetAppThumbImage(const GameInfo& game) const;
 			std::string GetAppNote(const GameInfo& game) const;
 			bool GameInstalled(const GameInfo& game) const;
+			bool GameDownloaded(const GameInfo& game) const;		// same as GameInstalled, without touching the file system
 			std::vector<fs::path> GetGameFileList(const GameInfo& game) const;
+			std::vector<ArchiveEntry> GetGameArchiveFileList(const GameInfo& game) const;
+			bool ReadGameArchiveFile(const GameInfo& game, const ArchiveEntry& entry, const StreamSink& sink) const;
+			std::vector<fs::path> GetActiveArchiveDirectories() const;
 
 		private:
-			bool CheckVRPPublicCredentials();
 			bool LoadVRPPublicCredentials();
 			bool DownloadMetadata();
+			bool LoadGameList(const fs::path& gameListFile, bool buildSearchIndex);
+			std::string GetGameHash(const GameInfo& game) const;
+			void SetArchiveDirectoryActive(const GameInfo& game, bool active);
+			fs::path GetGameArchiveFile(const GameInfo& game) const;
 
 		private:
 			const RClone& m_rClone;
@@ -61,9 +89,22 @@ namespace mloader
 			fs::path m_cacheDir;
 			fs::path m_downloadDir;
 
-			std::map<GameInfo, AppStatus> m_gameList;
+			std::shared_ptr<const GameCatalog> m_catalog;		// only accessed through std::atomic_load / std::atomic_store
+			std::shared_ptr<const SearchIndex> m_searchIndex;	// same
+			std::shared_mutex m_statusMutex;		// status updates hold it shared, publishing a catalog exclusively so no update falls in between
+
+			std::unordered_set<std::string> m_downloadedGames;		// release names of games extracted to the download directory
+			mutable std::mutex m_downloadedGamesMutex;
+
+			mutable std::unordered_map<std::string, std::string> m_gameHashCache;	// release name -> md5 hash
+			mutable std::mutex m_gameHashCacheMutex;
+
+			std::set<fs::path> m_activeArchiveDirectories;		// archives being downloaded or waiting for a direct install
+			mutable std::mutex m_activeArchiveDirectoriesMutex;
 			std::function<void(const GameInfo&, const AppStatus, const int)> m_gameStatusChangedCallback = nullptr;
 
+			Tracer* m_tracer = nullptr;
+
 			std::string m_baseUri = "";
 			std::string m_password = "";
 
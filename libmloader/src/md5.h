@@ -16,8 +16,12 @@
 #ifndef MD5_H
 #define MD5_H
 
+#include "Utility.h"
 #include <string>
 #include <exception>
+#include <filesystem>
+
+namespace fs = std::filesystem;
 
 namespace mloader
 {
@@ -36,7 +40,7 @@ namespace mloader
 		char buffer[1024];
 		snprintf(buffer, sizeof(buffer), md5CommandFormat, releaseName.c_str());
 
-		FILE* fp = popen(buffer, "r");
+		FILE* fp = ProcessOpen(buffer, "r");
 		if (fp == NULL)
 		{
 			perror("popen");
@@ -63,6 +67,39 @@ namespace mloader
 		return result;
 	}
 
+	// Returns an empty string if the file can't be hashed
+	inline std::string CalculateFileMD5Hash(const fs::path& file)
+	{
+	#ifdef __APPLE__
+		const std::string command = "md5 -q \"" + file.string() + "\" 2>/dev/null";
+	#else
+		const std::string command = "md5sum \"" + file.string() + "\" 2>/dev/null | awk '{print $1}'";
+	#endif
+		FILE* fp = ProcessOpen(command.c_str(), "r");
+		if (fp == NULL)
+		{
+			perror("popen");
+			return "";
+		}
+
+		char hash[64] = {};
+		if (fgets(hash, sizeof(hash), fp) == NULL)
+		{
+			hash[0] = '\0';
+		}
+
+		if (pclose(fp) != EXIT_SUCCESS)
+		{
+			return "";
+		}
+
+		std::string result(hash);
+		while (!result.empty() && (result.back() == '\n' || result.back() == '\r'))
+		{
+			result.pop_back();
+		}
+		return result;
+	}
 }
 
 #endif // MD5_H
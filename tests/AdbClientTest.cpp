@@ -0,0 +1,274 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+// Runs AdbClient against a stand-in adb server, needs no adb binary or device:
+//   mloader-tests [name]
+
+#include "StandInAdbServer.h"
+#include "AdbClient.h"
+#include "Logger.h"
+#include <cstring>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static constexpr const char* SERIAL = "1WMHH000000000";
+static constexpr uint32_t REGULAR_FILE_MODE = 0100644;
+
+static int g_failures = 0;
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+			++g_failures; \
+		} \
+	} while (false)
+
+// host:transport and sync: as the adb server answers them for an attached device
+static bool OpenSync(StandInAdbServer::Connection& connection)
+{
+	if (connection.ReadRequest() != std::string("host:transport:") + SERIAL)
+	{
+		return false;
+	}
+	connection.Okay();
+
+	if (connection.ReadRequest() != "sync:")
+	{
+		return false;
+	}
+	connection.Okay();
+	return true;
+}
+
+// STA2 response, see adb's file_sync_protocol.h
+static std::string Sta2Reply(uint32_t error, uint32_t mode, uint64_t size, int64_t modifiedTime)
+{
+	std::string reply = "STA2";
+	reply += StandInAdbServer::LittleEndian(error, 4);
+	reply += std::string(16, '\0');		// dev, ino
+	reply += StandInAdbServer::LittleEndian(mode, 4);
+	reply += std::string(12, '\0');		// nlink, uid, gid
+	reply += StandInAdbServer::LittleEndian(size, 8);
+	reply += std::string(8, '\0');		// atime
+	reply += StandInAdbServer::LittleEndian(static_cast<uint64_t>(modifiedTime), 8);
+	reply += std::string(8, '\0');		// ctime
+	return reply;
+}
+
+// Answers every STA2 request of the session until the client closes it
+static void ServeStat(StandInAdbServer::Connection& connection, const std::string& reply)
+{
+	std::string id;
+	std::string path;
+	while (connection.ReadSyncRequest(id, path) && id == "STA2")
+	{
+		connection.Write(reply);
+	}
+}
+
+static void TestStatReadsSta2Reply(mloader::Logger& logger)
+{
+	StandInAdbServer server([](StandInAdbServer::Connection& connection, int)
+	{
+		if (OpenSync(connection))
+		{
+			ServeStat(connection, Sta2Reply(0, REGULAR_FILE_MODE, 1234567890123ULL, 1700000000));
+		}
+	});
+
+	mloader::AdbClient client(logger, "127.0.0.1", server.GetPort());
+	mloader::SyncStat stat{};
+	CHECK(client.Stat(SERIAL, "/sdcard/Android/obb/com.example/main.obb", stat));
+	CHECK(stat.Mode == REGULAR_FILE_MODE);
+	CHECK(stat.Size == 1234567890123ULL);
+	CHECK(stat.ModifiedTime == 1700000000);
+
+	// the session is pooled and reused
+	CHECK(client.Stat(SERIAL, "/sdcard/Android/obb/com.example/patch.obb", stat));
+	CHECK(server.GetConnectionCount() == 1);
+}
+
+static void TestStatOfMissingFile(mloader::Logger& logger)
+{
+	StandInAdbServer server([](StandInAdbServer::Connection& connection, int)
+	{
+		if (OpenSync(connection))
+		{
+			ServeStat(connection, Sta2Reply(2, 0, 0, 0));		// ENOENT
+		}
+	});
+
+	mloader::AdbClient client(logger, "127.0.0.1", server.GetPort());
+	mloader::SyncStat stat{};
+	CHECK(!client.Stat(SERIAL, "/sdcard/missing", stat));
+}
+
+static void TestShellOkay(mloader::Logger& logger)
+{
+	StandInAdbServer server([](StandInAdbServer::Connection& connection, int)
+	{
+		if (connection.ReadRequest() != std::string("host:transport:") + SERIAL)
+		{
+			return;
+		}
+		connection.Okay();
+
+		if (connection.ReadRequest() == "shell:getprop ro.product.model")
+		{
+			connection.Okay();
+			connection.Write("Quest 3\n");
+		}
+	});
+
+	mloader::AdbClient client(logger, "127.0.0.1", server.GetPort());
+	CHECK(client.ShellOutput(SERIAL, "getprop ro.product.model") == "Quest 3\n");
+}
+
+static void TestTransportFail(mloader::Logger& logger)
+{
+	StandInAdbServer server([](StandInAdbServer::Connection& connection, int)
+	{
+		connection.ReadRequest();
+		connection.Fail(std::string("device '") + SERIAL + "' not found");
+	});
+
+	mloader::AdbClient client(logger, "127.0.0.1", server.GetPort());
+	mloader::SyncStat stat{};
+	CHECK(!client.Stat(SERIAL, "/sdcard", stat));
+	CHECK(client.ShellOutput(SERIAL, "getprop ro.product.model").empty());
+
+	std::vector<mloader::SyncDirEntry> entries;
+	CHECK(!client.List(SERIAL, "/sdcard", entries));
+}
+
+static void TestPushRetriesStaleConnection(mloader::Logger& logger)
+{
+	// the first session is closed by the server after a stat, the push has to open a new one
+	std::promise<void> firstSessionClosed;
+	std::string pushedPath;
+	std::string pushedData;
+	{
+		StandInAdbServer server([&](StandInAdbServer::Connection& connection, int index)
+		{
+			if (!OpenSync(connection))
+			{
+				return;
+			}
+
+			std::string id;
+			std::string payload;
+			if (index == 0)
+			{
+				if (connection.ReadSyncRequest(id, payload) && id == "STA2")
+				{
+					connection.Write(Sta2Reply(0, REGULAR_FILE_MODE, 1, 1));
+				}
+				connection.Shutdown();
+				firstSessionClosed.set_value();
+				return;
+			}
+
+			if (!connection.ReadSyncRequest(id, payload) || id != "SEND")
+			{
+				return;
+			}
+			pushedPath = payload;
+
+			while (connection.ReadSyncRequest(id, payload) && id == "DATA")
+			{
+				pushedData += payload;
+			}
+
+			if (id == "DONE")
+			{
+				connection.Write("OKAY" + StandInAdbServer::LittleEndian(0, 4));
+			}
+
+			// a second push reuses this session
+			if (connection.ReadSyncRequest(id, payload) && id == "SEND")
+			{
+				while (connection.ReadSyncRequest(id, payload) && id == "DATA") { }
+				connection.Write("FAIL" + StandInAdbServer::LittleEndian(9, 4) + "read-only");
+			}
+		});
+
+		mloader::AdbClient client(logger, "127.0.0.1", server.GetPort());
+		mloader::SyncStat stat{};
+		CHECK(client.Stat(SERIAL, "/sdcard/a", stat));
+
+		firstSessionClosed.get_future().wait();
+
+		const std::string content = "obb contents";
+		auto producer = [&content](const mloader::StreamSink& sink)
+		{
+			return sink(content.data(), content.size());
+		};
+		CHECK(client.PushStream(SERIAL, "/sdcard/Android/obb/com.example/main.obb", producer));
+		CHECK(server.GetConnectionCount() == 2);
+
+		// adbd refusing the file is reported as a failed push
+		CHECK(!client.PushStream(SERIAL, "/system/main.obb", producer));
+		CHECK(server.GetConnectionCount() == 2);
+	}
+
+	CHECK(pushedPath == "/sdcard/Android/obb/com.example/main.obb," + std::to_string(REGULAR_FILE_MODE));
+	CHECK(pushedData == "obb contents");
+}
+
+int main(int argc, char** argv)
+{
+	const std::string filter = argc > 1 ? argv[1] : "";
+	const fs::path logFile = fs::temp_directory_path() / "mloader-tests.log";
+
+	struct Test
+	{
+		const char* Name;
+		void (*Run)(mloader::Logger&);
+	};
+	const Test tests[] =
+	{
+		{ "stat_sta2", TestStatReadsSta2Reply },
+		{ "stat_missing", TestStatOfMissingFile },
+		{ "shell_okay", TestShellOkay },
+		{ "transport_fail", TestTransportFail },
+		{ "push_stale_connection", TestPushRetriesStaleConnection },
+	};
+
+	{
+		mloader::Logger logger(logFile.string());
+		for (const Test& test : tests)
+		{
+			if (!filter.empty() && filter != test.Name)
+			{
+				continue;
+			}
+
+			const int failuresBefore = g_failures;
+			test.Run(logger);
+			std::cout << (g_failures == failuresBefore ? "PASS " : "FAIL ") << test.Name << std::endl;
+		}
+	}
+
+	return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#include "StandInAdbServer.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <unistd.h>
+
+StandInAdbServer::Connection::Connection(int socket)
+	:	m_socket(socket)
+{
+}
+
+std::string StandInAdbServer::Connection::ReadRequest()
+{
+	char header[5]{};
+	if (!ReadExact(header, 4))
+	{
+		return "";
+	}
+
+	std::string request(strtoul(header, nullptr, 16), '\0');
+	return ReadExact(request.data(), request.size()) ? request : "";
+}
+
+void StandInAdbServer::Connection::Okay()
+{
+	Write("OKAY");
+}
+
+void StandInAdbServer::Connection::Fail(const std::string& message)
+{
+	char length[5];
+	snprintf(length, sizeof(length), "%04zx", message.size());
+	Write("FAIL" + std::string(length) + message);
+}
+
+bool StandInAdbServer::Connection::ReadSyncRequest(std::string& id, std::string& payload)
+{
+	unsigned char header[8];
+	if (!ReadExact(header, sizeof(header)))
+	{
+		return false;
+	}
+
+	id.assign(reinterpret_cast<const char*>(header), 4);
+	payload.clear();
+	if (id == "DONE")
+	{
+		return true;		// carries a timestamp instead of a length
+	}
+
+	payload.resize(header[4] | header[5] << 8 | header[6] << 16 | static_cast<uint32_t>(header[7]) << 24);
+	return payload.empty() || ReadExact(payload.data(), payload.size());
+}
+
+bool StandInAdbServer::Connection::ReadExact(void* buffer, size_t size)
+{
+	char* data = static_cast<char*>(buffer);
+	while (size > 0)
+	{
+		const ssize_t received = recv(m_socket, data, size, 0);
+		if (received <= 0)
+		{
+			return false;
+		}
+		data += received;
+		size -= static_cast<size_t>(received);
+	}
+	return true;
+}
+
+void StandInAdbServer::Connection::Write(const std::string& data)
+{
+	size_t written = 0;
+	while (written < data.size())
+	{
+		const ssize_t sent = send(m_socket, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+		if (sent <= 0)
+		{
+			return;
+		}
+		written += static_cast<size_t>(sent);
+	}
+}
+
+void StandInAdbServer::Connection::Shutdown()
+{
+	shutdown(m_socket, SHUT_RDWR);
+}
+
+StandInAdbServer::StandInAdbServer(Script script)
+	:	m_script(std::move(script))
+{
+	m_listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	address.sin_port = 0;		// any free port
+
+	socklen_t addressLength = sizeof(address);
+	if (m_listenSocket == -1 || bind(m_listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(m_listenSocket, 8) != 0 ||
+		getsockname(m_listenSocket, reinterpret_cast<sockaddr*>(&address), &addressLength) != 0)
+	{
+		throw std::runtime_error("Unable to listen on a local port");
+	}
+
+	m_port = ntohs(address.sin_port);
+	m_acceptThread = std::thread(&StandInAdbServer::AcceptService, this);
+}
+
+StandInAdbServer::~StandInAdbServer()
+{
+	m_stop = true;
+	if (m_acceptThread.joinable())
+	{
+		m_acceptThread.join();
+	}
+
+	for (std::thread& thread : m_connectionThreads)
+	{
+		thread.join();
+	}
+	close(m_listenSocket);
+}
+
+uint16_t StandInAdbServer::GetPort() const
+{
+	return m_port;
+}
+
+int StandInAdbServer::GetConnectionCount() const
+{
+	return m_connectionCount;
+}
+
+std::string StandInAdbServer::LittleEndian(uint64_t value, size_t size)
+{
+	std::string data;
+	for (size_t i = 0; i < size; ++i)
+	{
+		data += static_cast<char>((value >> (i * 8)) & 0xFF);
+	}
+	return data;
+}
+
+void StandInAdbServer::AcceptService()
+{
+	while (!m_stop)
+	{
+		pollfd descriptor{ m_listenSocket, POLLIN, 0 };
+		if (poll(&descriptor, 1, 50) <= 0)
+		{
+			continue;
+		}
+
+		const int socket = accept(m_listenSocket, nullptr, nullptr);
+		if (socket == -1)
+		{
+			continue;
+		}
+
+		const int index = m_connectionCount++;
+		m_connectionThreads.emplace_back([this, socket, index]()
+		{
+			Connection connection(socket);
+			m_script(connection, index);
+			close(socket);
+		});
+	}
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2025 mlogic1
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program. If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef STAND_IN_ADB_SERVER_H
+#define STAND_IN_ADB_SERVER_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Listens on a free local port and answers like an adb server would. Every accepted connection is handed to the
+// script together with its number, the connection is closed once the script returns
+class StandInAdbServer
+{
+	public:
+		class Connection
+		{
+			public:
+				explicit Connection(int socket);
+
+				std::string ReadRequest();								// smart socket request, empty once the client is gone
+				void Okay();
+				void Fail(const std::string& message);
+				bool ReadSyncRequest(std::string& id, std::string& payload);	// id and little endian length prefixed payload
+				bool ReadExact(void* buffer, size_t size);
+				void Write(const std::string& data);
+				void Shutdown();		// the client sees the connection closed
+
+			private:
+				int m_socket;
+		};
+
+		using Script = std::function<void(Connection& connection, int index)>;
+
+		explicit StandInAdbServer(Script script);
+		~StandInAdbServer();
+		StandInAdbServer(const StandInAdbServer&) = delete;
+		StandInAdbServer& operator=(const StandInAdbServer&) = delete;
+
+		uint16_t GetPort() const;
+		int GetConnectionCount() const;
+
+		static std::string LittleEndian(uint64_t value, size_t size);
+
+	private:
+		void AcceptService();
+
+	private:
+		Script m_script;
+		int m_listenSocket = -1;
+		uint16_t m_port = 0;
+		std::atomic<int> m_connectionCount{0};
+		std::atomic<bool> m_stop{false};
+		std::thread m_acceptThread;
+		std::vector<std::thread> m_connectionThreads;
+};
+
+#endif // STAND_IN_ADB_SERVER_H